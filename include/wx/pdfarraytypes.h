@@ -25,4 +25,103 @@ WX_DEFINE_USER_EXPORTED_ARRAY_LONG(wxUint32, wxPdfArrayUint32, class WXDLLIMPEXP
 /// Sorted array types
 WX_DEFINE_SORTED_USER_EXPORTED_ARRAY_INT(int, wxPdfSortedArrayInt, WXDLLIMPEXP_PDFDOC);
 
+/// Class representing a set of glyph numbers as a bitmap (For internal use only)
+/**
+* Adding a glyph and checking whether a glyph is contained in the set take constant time.
+* The glyphs are enumerated in ascending order by scanning the bitmap.
+*/
+class WXDLLIMPEXP_PDFDOC wxPdfGlyphSet
+{
+public:
+  /// Constructor
+  /**
+  * \param numGlyphs the expected number of glyphs of the font; the set grows as needed
+  */
+  wxPdfGlyphSet(size_t numGlyphs = 0)
+    : m_count(0)
+  {
+    m_bits.Add(0, (numGlyphs + 31) / 32);
+  }
+
+  /// Check whether the set contains a glyph
+  /**
+  * \param glyph the glyph number
+  * \return @c true if the glyph is contained in the set, @c false otherwise
+  */
+  bool Contains(wxUint32 glyph) const
+  {
+    size_t word = glyph / 32;
+    return word < m_bits.GetCount() && (m_bits[word] & (1u << (glyph % 32))) != 0;
+  }
+
+  /// Add a glyph to the set
+  /**
+  * \param glyph the glyph number
+  * \return @c true if the glyph was added, @c false if it was already contained in the set
+  */
+  bool Add(wxUint32 glyph)
+  {
+    size_t word = glyph / 32;
+    if (word >= m_bits.GetCount())
+    {
+      m_bits.Add(0, word + 1 - m_bits.GetCount());
+    }
+    wxUint32 mask = 1u << (glyph % 32);
+    if ((m_bits[word] & mask) != 0)
+    {
+      return false;
+    }
+    m_bits[word] |= mask;
+    ++m_count;
+    return true;
+  }
+
+  /// Get the number of glyphs in the set
+  size_t GetCount() const { return m_count; }
+
+  /// Find the smallest glyph in the set not less than a given glyph number
+  /**
+  * Enumerate all glyphs in ascending order with
+  * <tt>for (int g = set.FindNext(0); g != wxNOT_FOUND; g = set.FindNext(g + 1))</tt>
+  * \param glyph the glyph number to start with
+  * \return the glyph number found, or wxNOT_FOUND if there is none
+  */
+  int FindNext(wxUint32 glyph) const
+  {
+    size_t word = glyph / 32;
+    size_t numWords = m_bits.GetCount();
+    if (word >= numWords)
+    {
+      return wxNOT_FOUND;
+    }
+    wxUint32 bits = m_bits[word] & (0xffffffffu << (glyph % 32));
+    while (bits == 0)
+    {
+      if (++word >= numWords)
+      {
+        return wxNOT_FOUND;
+      }
+      bits = m_bits[word];
+    }
+    int bit = 0;
+    while ((bits & 1u) == 0)
+    {
+      bits >>= 1;
+      ++bit;
+    }
+    return (int) (word * 32 + bit);
+  }
+
+  /// Remove all glyphs from the set
+  void Clear()
+  {
+    m_bits.Clear();
+    m_count = 0;
+  }
+
+private:
+  wxPdfArrayUint32 m_bits;  ///< bitmap of glyphs, bit j of word k represents glyph 32*k+j
+  size_t           m_count; ///< number of glyphs in the set
+};
+
 #endif
@@ -25,6 +25,7 @@ class wxGrid;
 #include <wx/dynarray.h>
 #include <wx/graphics.h>
 #include <wx/hashmap.h>
+#include <wx/longlong.h>
 #include <wx/mstream.h>
 #include <wx/string.h>
 #include <wx/xml/xml.h>
@@ -53,6 +54,10 @@ class wxGrid;
 
 #define wxPDF_EPSILON        1e-6
 
+// Maximum number and length of text strings in the text run cache of a document
+#define wxPDF_TEXTRUN_CACHE_SIZE 4096
+#define wxPDF_TEXTRUN_MAX_LENGTH 256
+
 class WXDLLIMPEXP_FWD_PDFDOC wxPdfCoonsPatchMesh;
 
 class WXDLLIMPEXP_FWD_PDFDOC wxPdfFont;
@@ -82,12 +87,20 @@ class WXDLLIMPEXP_FWD_PDFDOC wxPdfLayer;
 class WXDLLIMPEXP_FWD_PDFDOC wxPdfLayerMembership;
 class WXDLLIMPEXP_FWD_PDFDOC wxPdfLayerGroup;
 
+class WXDLLIMPEXP_FWD_PDFDOC wxPdfTextRun;
+
 /// Hashmap class for offset values
 WX_DECLARE_HASH_MAP_WITH_DECL(long, int, wxIntegerHash, wxIntegerEqual, wxPdfOffsetHashMap, class WXDLLIMPEXP_PDFDOC);
 
 /// Hashmap class for document pages
 WX_DECLARE_HASH_MAP_WITH_DECL(long, wxMemoryOutputStream*, wxIntegerHash, wxIntegerEqual, wxPdfPageHashMap, class WXDLLIMPEXP_PDFDOC);
 
+/// Hashmap class for object ids
+WX_DECLARE_HASH_MAP_WITH_DECL(long, int, wxIntegerHash, wxIntegerEqual, wxPdfObjIdHashMap, class WXDLLIMPEXP_PDFDOC);
+
+/// Hashmap class for positions of the page number alias
+WX_DECLARE_HASH_MAP_WITH_DECL(long, wxArrayInt*, wxIntegerHash, wxIntegerEqual, wxPdfAliasPositionsMap, class WXDLLIMPEXP_PDFDOC);
+
 /// Hashmap class for document pages
 WX_DECLARE_HASH_MAP_WITH_DECL(long, wxSize, wxIntegerHash, wxIntegerEqual, wxPdfPageSizeMap, class WXDLLIMPEXP_PDFDOC);
 
@@ -158,6 +171,9 @@ WX_DECLARE_STRING_HASH_MAP_WITH_DECL(wxPdfIndirectObject*, wxPdfRadioGroupMap, c
 /// Hash map class for parsers
 WX_DECLARE_STRING_HASH_MAP_WITH_DECL(wxPdfParser*, wxPdfParserMap, class WXDLLIMPEXP_PDFDOC);
 
+/// Hash map class for cached text runs
+WX_DECLARE_STRING_HASH_MAP_WITH_DECL(wxPdfTextRun*, wxPdfTextRunMap, class WXDLLIMPEXP_PDFDOC);
+
 /// Class representing a PDF document.
 #if WXPDFDOC_INHERIT_WXOBJECT
 class WXDLLIMPEXP_PDFDOC wxPdfDocument : public wxObject
@@ -417,6 +433,143 @@ public:
   */
   virtual void SetCompression(bool compress);
 
+  /// Sets the number of threads used for compressing content streams.
+  /**
+  * If more than one thread is requested, the content streams of pages, templates and
+  * form objects are compressed in parallel when the document is closed.
+  * Font programs of embedded fonts are subsetted and compressed in parallel as well.
+  * The resulting document is identical to the one created by sequential compression.
+  * Parallel compression is off by default.
+  * \param threads number of threads (values less than 2 disable parallel compression)
+  */
+  virtual void SetCompressionThreads(int threads);
+
+  /// Gets the number of threads used for compressing content streams.
+  /**
+  * \return the number of compression threads
+  */
+  int GetCompressionThreads() const { return m_compressionThreads; }
+
+  /// Gets the wall-clock time saved by parallel compression.
+  /**
+  * \return time in milliseconds saved compared to sequential compression
+  */
+  double GetCompressionTimeSaved() const { return m_compressionTimeSaved.ToDouble() / 1000.0; }
+
+  /// Activates or deactivates compact output.
+  /**
+  * When activated, objects without a stream are packed into compressed object streams
+  * and the cross-reference table is written as a binary cross-reference stream,
+  * which requires PDF version 1.5. For encrypted documents only the cross-reference
+  * stream is used. Compact output must be selected before the document is opened.
+  * Compact output is off by default.
+  * \param compact Boolean indicating if compact output must be enabled.
+  */
+  virtual void SetCompactOutput(bool compact);
+
+  /// Check whether compact output is enabled
+  /**
+  * \return @c true if compact output is enabled, @c false otherwise
+  * \see SetCompactOutput()
+  */
+  bool IsCompactOutput() const { return m_compactOutput; }
+
+  /// Sets the compression of images given as wxImage.
+  /**
+  * Images given as wxImage (unless JPEG format is requested) are encoded directly from
+  * their pixel data; the alpha channel becomes a separate soft mask image.
+  * Row predictors usually reduce the size of the compressed data considerably, at the cost
+  * of additional encoding time. By default the zlib default compression level is used
+  * and predictors are applied.
+  * \param deflateLevel zlib compression level from 0 (no compression) to 9 (best compression),
+  * or -1 for the zlib default
+  * \param predictors flag whether PNG row predictors are applied before compression
+  */
+  virtual void SetImageCompression(int deflateLevel, bool predictors = true);
+
+  /// Gets the compression level of images given as wxImage.
+  /**
+  * \return the zlib compression level
+  * \see SetImageCompression()
+  */
+  int GetImageDeflateLevel() const { return m_imageDeflateLevel; }
+
+  /// Check whether row predictors are applied to images given as wxImage.
+  /**
+  * \return @c true if row predictors are applied, @c false otherwise
+  * \see SetImageCompression()
+  */
+  bool GetImagePredictors() const { return m_imagePredictors; }
+
+  /// Sets whether the data of PNG and JPEG image files are loaded only when the document is written.
+  /**
+  * By default the image data of all images are kept in memory from the first use of an image
+  * until the document is closed. If deferred loading is enabled, images given as local file names
+  * are only parsed for their properties, and their data are read from the file when the image
+  * objects are written. The image files must then not be changed or removed before the
+  * document is closed. PNG images with alpha channel, images read from other streams and images
+  * held in the shared image cache are always loaded immediately.
+  *
+  * If an image file was changed or removed in the meantime, a blank image is written
+  * in place of the image, so that the document remains valid, and an error is logged.
+  * SaveAsFile() then returns @c false.
+  * \param deferred flag whether loading of image data is deferred
+  */
+  virtual void SetDeferredImageLoading(bool deferred);
+
+  /// Check whether loading of image data is deferred until the document is written.
+  /**
+  * \return @c true if loading of image data is deferred, @c false otherwise
+  * \see SetDeferredImageLoading()
+  */
+  bool IsDeferredImageLoading() const { return m_deferredImageLoading; }
+
+  /// Sets the policy for downsampling and recompressing images.
+  /**
+  * When the document is written, images whose resolution at their largest placement on a page
+  * exceeds the target resolution, or which have more pixels than allowed, are downsampled.
+  * JPEG images are encoded as JPEG again, all other images are Flate compressed.
+  * The placed size does not take transformations or template scaling into account.
+  * Only 8-bit greyscale and RGB images without colour key masking are handled.
+  * The downsampled data are only written, the images keep their original data, so that
+  * documents created after Reset() use the placements in the respective document.
+  * By default images are embedded unchanged.
+  * \param targetDpi target resolution in dots per inch, 0 to ignore the placed size
+  * \param maxPixels maximum number of pixels of an image, 0 for unlimited
+  * \param jpegQuality quality (0..100) for encoding downsampled JPEG images
+  * \param detectGreyscale flag whether RGB images containing only grey pixels are stored as greyscale images
+  * (not applicable to JPEG images)
+  */
+  virtual void SetImagePolicy(double targetDpi, int maxPixels = 0, int jpegQuality = 85, bool detectGreyscale = false);
+
+  /// Gets the target resolution of images.
+  /**
+  * \return the target resolution in dots per inch, 0 if not set
+  * \see SetImagePolicy()
+  */
+  double GetImageTargetDpi() const { return m_imageTargetDpi; }
+
+  /// Gets the maximum number of pixels of images.
+  /**
+  * \return the maximum number of pixels, 0 if unlimited
+  * \see SetImagePolicy()
+  */
+  int GetImageMaxPixels() const { return m_imageMaxPixels; }
+
+  /// Gets the quality for encoding downsampled JPEG images.
+  /**
+  * \return the JPEG quality
+  * \see SetImagePolicy()
+  */
+  int GetImageJpegQuality() const { return m_imageJpegQuality; }
+
+  /// Check whether RGB images containing only grey pixels are stored as greyscale images.
+  /**
+  * \return @c true if greyscale detection is enabled, @c false otherwise
+  * \see SetImagePolicy()
+  */
+  bool GetImageGreyscaleDetection() const { return m_imageDetectGreyscale; }
+
   /// Defines the viewer preferences.
   /**
   * \param preferences A set of viewer preferences options.
@@ -488,6 +641,9 @@ public:
   /// Defines an alias for the total number of pages.
   /**
   * It will be substituted as the document is closed.
+  * The positions of the alias are recorded as text is written, therefore the alias
+  * should be defined before the first page is added; pages written before have to be
+  * searched for the alias when the document is closed.
   * \param alias The alias. Default value: {nb}.
   * \see PageNo(), Footer()
   */
@@ -502,6 +658,31 @@ public:
   */
   virtual void Open();
 
+  /// This method begins the generation of the PDF document in streaming mode.
+  /**
+  * In streaming mode the document is written to the given output stream while it is created.
+  * Each page is written as soon as it is finished, so that memory usage stays bounded by
+  * the size of a single page plus the shared resources (fonts, images, templates), which
+  * are written when the document is closed.
+  *
+  * The method has to be called before the first page is added. The output stream must stay
+  * valid until Close() has been called. SaveAsFile() and CloseAndGetBuffer() can't be used
+  * for documents in streaming mode.
+  *
+  * Pages containing the alias for the total number of pages are kept in memory until
+  * the document is closed.
+  * \param outputStream stream to which the PDF document is written
+  * \see Open(), Close(), AliasNbPages()
+  */
+  virtual void Open(wxOutputStream& outputStream);
+
+  /// Check whether the document is written in streaming mode
+  /**
+  * \return @c true if the document is written in streaming mode, @c false otherwise
+  * \see Open(wxOutputStream&)
+  */
+  bool IsStreaming() const { return m_streaming; }
+
   /// Terminates the PDF document.
   /**
   * It is not necessary to call this method explicitly because SaveAsFile()
@@ -511,6 +692,26 @@ public:
   */
   virtual void Close();
 
+  /// Resets the document for generating a new document based on the same resources.
+  /**
+  * The content of the document is discarded: pages, links, annotations, bookmarks,
+  * form fields and the generated output. The object counter starts again.
+  * Fonts, images, templates, imported documents, spot colours, patterns, gradients,
+  * graphics states, layers, attachments and all document settings are kept, so that
+  * many similar documents can be produced by one instance without setting up the
+  * resources again. Typically Reset() is called after SaveAsFile() or CloseAndGetBuffer().
+  *
+  * A protected document gets a new document ID and a new encryption key,
+  * derived from the passwords given to SetProtection(). The PDF version is
+  * set back to the version required by the kept settings and resources.
+  *
+  * \note All kept resources are written to each following document, even if
+  * they are not used there. Subsets of embedded fonts contain the glyphs used in all
+  * documents generated so far, since existing templates may refer to them.
+  * \see Close()
+  */
+  virtual void Reset();
+
   /// Adds a new page to the document.
   /**
   * If a page is already present, the Footer() method is called first
@@ -1079,6 +1280,20 @@ public:
   */
   virtual double GetStringWidth(const wxString& s, double charSpacing = 0);
 
+  /// Get the advances of all characters of a string
+  /**
+  * The advances are determined in a single pass over the string, using the current font,
+  * font size and kerning setting. The sum of the first n advances is the width of the
+  * first n characters of the string, so that partial extents of a string can be
+  * computed without measuring each prefix separately.
+  * \param s the string for which the advances should be computed
+  * \param[out] advances the advances of the characters, one entry per character of the string
+  * \param charSpacing extra amount of spacing between characters (optional)
+  * \note Unlike GetStringWidth() no visual reordering is applied, so that the advances
+  * correspond to the characters of the given string.
+  */
+  virtual void GetCharAdvances(const wxString& s, wxPdfArrayDouble& advances, double charSpacing = 0);
+
   /// Defines the line width.
   /**
   * By default, the value equals 0.2 mm. The method can be called before the first page is created
@@ -2101,6 +2316,7 @@ public:
   /**
   * Prepares an image for use as an image mask
   * The image is given as the name of the file containing the image
+  * The image must be a gray scale image without alpha channel.
   * \param file Name of the file containing the image.
   * \param mimeType Image format. Possible values are: image/jpeg, image/png, image/gif, image/wmf.
   * \return id of the image mask, or 0 in case of an error
@@ -2119,6 +2335,7 @@ public:
   /**
   * Prepares an image for use as an image mask
   * The image is given by an wxInputStream-Object containing the raw image data.
+  * The image must be a gray scale image without alpha channel.
   * \param name Name of the image.
   * \param stream wxInputStream object containing the raw image data
   * \param mimeType Image format. Possible values are: image/jpeg, image/png, image/gif, image/wmf.
@@ -2232,6 +2449,8 @@ public:
   /// Closes the document and returns the memory buffer containing the document
   /**
   * The method first calls Close() if necessary to terminate the document.
+  * In streaming mode the document was written to the output stream given to Open(),
+  * an error is logged and an empty buffer owned by the document is returned.
   * \return const @c wxMemoryOutputStream reference to the buffer containing the PDF document.
   * \see Close()
   */
@@ -3250,6 +3469,17 @@ public:
   */
   virtual int SetSourceFile(const wxString& filename, const wxString& password = wxEmptyString);
 
+  /// Sets the memory budget for caching decoded object streams of external PDF documents.
+  /**
+  * Objects of external documents are parsed on demand. Decoded object streams are kept
+  * in a least recently used cache per source document, limited to the given number of bytes.
+  * The budget applies to all sources already opened and to sources opened later on.
+  *
+  * \param maxSize the cache budget in bytes (default: 16 MB), 0 disables caching
+  * \see SetSourceFile()
+  */
+  virtual void SetImportCacheSize(size_t maxSize);
+
   /// Gets the document information dictionary of the current external PDF document.
   /**
   * Gets the values of the Info dictionary of the current external document, if available.
@@ -3513,6 +3743,9 @@ protected:
   */
   virtual void Initialize(int orientation);
 
+  /// Delete the content of the document (pages, links, annotations, bookmarks and form fields)
+  void ClearContent();
+
   /// Pushes the current graphic state onto an internal stack
   /**
   * Saves the current values of:
@@ -3670,6 +3903,24 @@ protected:
   /// Replace page number aliases
   virtual void ReplaceNbPagesAlias();
 
+  /// Write a finished page to the output stream (streaming mode only)
+  virtual void PutPage(int n);
+
+  /// Write the content stream of a page (streaming mode only)
+  void PutPageContent(int n, int objId);
+
+  /// Write page contents and link annotations deferred until the end of the document (streaming mode only)
+  virtual void PutStreamedPages();
+
+  /// Add pages root
+  virtual void PutPagesRoot();
+
+  /// Get the object id of a page
+  int GetPageObjId(int page);
+
+  /// Check whether a page contains the alias for the total number of pages
+  bool HasNbPagesAlias(int n);
+
   /// Add resources
   virtual void PutResources();
 
@@ -3750,6 +4001,12 @@ protected:
   /// Add trailer
   virtual void PutTrailer();
 
+  /// Add the entries of the trailer dictionary
+  void PutTrailerEntries(int size, int rootId, int infoId);
+
+  /// Add object streams and cross-reference stream (compact output)
+  virtual void PutXRefStream();
+
   /// Calculate stream size
   size_t CalculateStreamLength(size_t len);
 
@@ -3762,6 +4019,9 @@ protected:
   /// Begin a new object
   void NewObj(int objId = 0);
 
+  /// Finish the object captured for compact output
+  void FlushObject();
+
   /// Decorate text
   wxString DoDecoration(double x, double y, const wxString& txt);
 
@@ -3774,9 +4034,25 @@ protected:
   /// Format a text string
   void TextEscape(const wxString& s, bool newline = true);
 
+  /// Format a text string not containing the alias for the total number of pages
+  void OutTextEscaped(const wxString& s);
+
+  /// Find or create the cached text run of a text string in the current font
+  /**
+  * \param s the text string
+  * \return the cached text run, or NULL if the text string is not cached
+  */
+  wxPdfTextRun* FindTextRun(const wxString& s);
+
+  /// Remove all cached text runs
+  void ClearTextRunCache();
+
   /// Add byte stream
   void PutStream(wxMemoryOutputStream& s);
 
+  /// Add byte stream given as a memory block
+  void PutStream(const char* data, size_t len);
+
   /// Add a text string to the document
   void OutTextstring(const wxString& s, bool newline = true);
 
@@ -3810,6 +4086,17 @@ protected:
   /// Add len characters
   void Out(const char* s, size_t len, bool newline = true);
 
+  /// Add a sequence of numbers with fixed precision followed by an operator
+  /**
+  * The numbers are formatted without allocating memory.
+  * \param values array of numbers
+  * \param count number of values in the array
+  * \param precision number of decimal places
+  * \param op operator appended after the numbers
+  * \param newline flag whether a newline should be appended
+  */
+  void OutNumbers(const double* values, size_t count, int precision, const char* op, bool newline = true);
+
   /// Sets a draw point
   void OutPoint(double x, double y);
 
@@ -3834,6 +4121,12 @@ protected:
   /// Add an indirect object to the document
   void OutIndirectObject(wxPdfIndirectObject* object);
 
+  /// Register the soft mask of an image parsed from a file or stream
+  void AddImageSoftMask(const wxString& name, wxPdfImage* currentImage);
+
+  /// Pass the largest placement sizes of images on to their soft masks and image masks
+  void UpdateMaskPlacedSizes();
+
   /// Add an image object to the document
   void OutImage(wxPdfImage* currentImage,
                 double x, double y, double w, double h, const wxPdfLink& link);
@@ -3911,8 +4204,38 @@ private:
   wxPdfPageHashMap*    m_pages;               ///< array containing pages
   int                  m_state;               ///< current document state
 
+  // Streaming mode
+  bool                 m_streaming;           ///< flag whether the document is written in streaming mode
+  wxMemoryOutputStream m_emptyBuffer;         ///< empty buffer returned by CloseAndGetBuffer() in streaming mode
+  wxString             m_streamVersion;       ///< PDF version written to the header in streaming mode
+  wxPdfObjIdHashMap*   m_pageObjIds;          ///< array of page object ids (streaming mode)
+  wxPdfObjIdHashMap*   m_contentObjIds;       ///< array of object ids of deferred page contents (streaming mode)
+  wxArrayPtrVoid       m_deferredLinks;       ///< array of deferred internal link annotations (streaming mode)
+  wxArrayInt           m_deferredLinkIds;     ///< array of object ids of deferred link annotations (streaming mode)
+
+  // Compact output
+  bool                  m_compactOutput;      ///< flag whether object streams and cross-reference stream are used
+  wxMemoryOutputStream* m_objBuffer;          ///< buffer capturing the current object (compact output)
+  wxOutputStream*       m_objOutput;          ///< document output while an object is captured (compact output)
+  int                   m_objId;              ///< id of the captured object (compact output)
+  bool                  m_objHasStream;       ///< flag whether the captured object contains a stream (compact output)
+  wxArrayPtrVoid        m_objStreams;         ///< array of object stream contents (compact output)
+  wxArrayInt            m_objStmIds;          ///< array of ids of objects in object streams (compact output)
+  wxArrayInt            m_objStmOffsets;      ///< array of offsets of objects in object streams (compact output)
+  wxPdfObjIdHashMap*    m_objStmIndex;        ///< map from object id to index in object streams (compact output)
+
   bool                 m_kerning;             ///< kerning flag
   bool                 m_compress;            ///< compression flag
+  int                  m_compressionThreads;  ///< number of threads for parallel compression
+  wxLongLong           m_compressionTimeSaved; ///< time in microseconds saved by parallel compression
+  int                  m_imageDeflateLevel;   ///< compression level of images given as wxImage
+  bool                 m_imagePredictors;     ///< flag whether row predictors are applied to images given as wxImage
+  bool                 m_deferredImageLoading; ///< flag whether image data are loaded when the document is written
+  bool                 m_writeError;           ///< flag whether data were missing when the document was written
+  double               m_imageTargetDpi;      ///< target resolution of images
+  int                  m_imageMaxPixels;      ///< maximum number of pixels of images
+  int                  m_imageJpegQuality;    ///< quality of downsampled JPEG images
+  bool                 m_imageDetectGreyscale; ///< flag whether grey RGB images are stored as greyscale images
   int                  m_defOrientation;      ///< default orientation
   int                  m_curOrientation;      ///< current orientation
   wxPdfBoolHashMap*    m_orientationChanges;  ///< array indicating orientation changes
@@ -3950,9 +4273,11 @@ private:
 
   int                  m_inTransform;         ///< flag for transformation state
   wxPdfFontHashMap*    m_fonts;               ///< array of used fonts
+  wxPdfTextRunMap*     m_textRuns;            ///< cache of measured and encoded text strings
   wxPdfStringHashMap*  m_diffs;               ///> array of encoding differences
   wxPdfBoolHashMap*    m_winansi;             ///> array of flags whether encoding differences are based on WinAnsi
   wxPdfImageHashMap*   m_images;              ///< array of used images
+  wxPdfImageHashMap*   m_imageDigests;        ///< images created from wxImage objects by content digest
   wxPdfPageLinksMap*   m_pageLinks;           ///< array of links in pages
   wxPdfLinkHashMap*    m_links;               ///< array of internal links
   wxPdfNamedLinksMap*  m_namedLinks;          ///< array of named internal links
@@ -4006,6 +4331,8 @@ private:
   wxString             m_keywords;            ///< keywords
   wxString             m_creator;             ///< creator
   wxString             m_aliasNbPages;        ///< alias for total number of pages
+  wxPdfAliasPositionsMap* m_aliasNbPagesPositions; ///< positions and lengths of the alias in the pages
+  int                  m_aliasNbPagesScan;    ///< number of pages which have to be searched for the alias
   wxString             m_PDFVersion;          ///< PDF version number
 
   double               m_img_rb_x;            ///< right-bottom corner X coordinate of inserted image
@@ -4015,6 +4342,11 @@ private:
   bool                 m_encrypted;           ///< flag whether document is protected
   wxPdfEncrypt*        m_encryptor;           ///< encryptor instance
   int                  m_encObjId;            ///< encrypted object id
+  int                  m_protectionPermissions;   ///< permissions of the protected document
+  wxString             m_protectionUserPassword;  ///< user password of the protected document
+  wxString             m_protectionOwnerPassword; ///< owner password of the protected document
+  wxPdfEncryptionMethod m_protectionMethod;       ///< encryption method of the protected document
+  int                  m_protectionKeyLength;     ///< encryption key length of the protected document
 
   // Javascript
   int                  m_nJS;                 ///< Javascript object number
@@ -4042,6 +4374,7 @@ private:
   wxPdfParser*         m_currentParser;       ///< current parser
   wxString             m_currentSource;       ///< current import source file name
   wxString             m_importVersion;       ///< highest PDF version of imported files
+  size_t               m_importCacheSize;     ///< object cache budget of import parsers
 
   // OCG / layer
   wxPdfOcgMap*         m_ocgs;                ///< array of OCGs
@@ -226,6 +226,15 @@ protected:
                    unsigned char* textin, unsigned int textlen,
                    unsigned char* textout);
 
+  /// Get the encryption key of an object (revision 4 and below)
+  /**
+  * The key of the most recently used object is cached.
+  * \param n object number
+  * \param g generation number
+  * \return the object key
+  */
+  unsigned char* GetObjectKey(int n, int g);
+
   /// Calculate the binary MD5 message digest of the given data
   static void GetMD5Binary(const unsigned char* data, unsigned int length, unsigned char* digest);
 
@@ -276,6 +285,9 @@ private:
   unsigned int   m_keyLength;          ///< Length of encryption key
   unsigned char  m_rc4key[16];         ///< last RC4 key
   unsigned char  m_rc4last[256];       ///< last RC4 state table
+  int            m_objectKeyN;         ///< object number of the cached object key
+  int            m_objectKeyG;         ///< generation number of the cached object key
+  unsigned char  m_objectKey[16];      ///< cached object key
 
   std::string m_u;
   std::string m_ue;
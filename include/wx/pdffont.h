@@ -17,6 +17,7 @@
 
 // wxPdfDocument headers
 #include "wx/pdfdocdef.h"
+#include "wx/pdfarraydouble.h"
 #include "wx/pdfarraytypes.h"
 #include "wx/pdffontdescription.h"
 #include "wx/pdfproperties.h"
@@ -90,6 +91,15 @@ public :
   */
   virtual double GetStringWidth(const wxString& s) const;
 
+  /// Get the advances of all characters of a string
+  /**
+  * The advances are determined in a single pass over the string. The sum of the
+  * first n advances is the width of the first n characters of the string.
+  * \param s string for which the advances are to be returned
+  * \param[out] advances the advances of the characters, one entry per character of the string
+  */
+  virtual void GetCharAdvances(const wxString& s, wxPdfArrayDouble& advances) const;
+
   /// Check whether the font embedding is required
   /**
   * \return @c true if embedding of this font is required, @c false otherwise
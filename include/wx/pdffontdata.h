@@ -13,6 +13,7 @@
 #define _PDF_FONT_DATA_H_
 
 // wxWidgets headers
+#include <wx/atomic.h>
 #include <wx/dynarray.h>
 #include <wx/hashmap.h>
 #include <wx/mstream.h>
@@ -21,11 +22,13 @@
 
 // wxPdfDocument headers
 #include "wx/pdfdocdef.h"
+#include "wx/pdfarraydouble.h"
 #include "wx/pdfarraytypes.h"
 #include "wx/pdffontdescription.h"
 
 class WXDLLIMPEXP_FWD_PDFDOC wxPdfEncoding;
 class WXDLLIMPEXP_FWD_PDFDOC wxPdfEncodingChecker;
+class WXDLLIMPEXP_FWD_PDFDOC wxPdfMappedFile;
 
 WX_DECLARE_HASH_MAP_WITH_DECL(wxUint32, int, wxIntegerHash, wxIntegerEqual, wxPdfKernWidthMap, class WXDLLIMPEXP_PDFDOC);
 WX_DECLARE_HASH_MAP_WITH_DECL(wxUint32, wxPdfKernWidthMap*, wxIntegerHash, wxIntegerEqual, wxPdfKernPairMap, class WXDLLIMPEXP_PDFDOC);
@@ -49,6 +52,170 @@ public:
 
 WX_DEFINE_SORTED_USER_EXPORTED_ARRAY(wxPdfGlyphListEntry*, wxPdfGlyphList, WXDLLIMPEXP_PDFDOC);
 
+/// Class representing compiled glyph metrics of a font. (For internal use only)
+/**
+* The widths, the character to glyph mapping and the kerning pairs of a font
+* are stored in dense arrays, one block of 256 entries for each populated
+* 256 character page. Lookups are therefore simple array accesses instead of
+* hash map lookups.
+* \internal
+*/
+class WXDLLIMPEXP_PDFDOC wxPdfFontMetricsTable
+{
+public:
+  /// Constructor
+  /**
+  * \param cw the mapping of character ids to character widths
+  * \param gn the mapping of character ids to glyph numbers (may be NULL)
+  * \param kp the kerning pair map (may be NULL)
+  */
+  wxPdfFontMetricsTable(const wxPdfGlyphWidthMap* cw, const wxPdfChar2GlyphMap* gn, const wxPdfKernPairMap* kp);
+
+  /// Check whether all map entries could be represented in the table
+  bool IsValid() const { return m_valid; }
+
+  /// Get the width of a character
+  /**
+  * \param ch the character id
+  * \return the width of the character, or -1 if the width is not known
+  */
+  int GetWidth(wxUint32 ch) const
+  {
+    return Find(m_widthPages, m_widths, ch);
+  }
+
+  /// Get the glyph number of a character
+  /**
+  * \param ch the character id
+  * \return the glyph number of the character, or the character id itself if no mapping exists
+  */
+  wxUint32 GetGlyph(wxUint32 ch) const
+  {
+    int glyph = Find(m_glyphPages, m_glyphs, ch);
+    return (glyph >= 0) ? (wxUint32) glyph : ch;
+  }
+
+  /// Check whether kerning pairs are available
+  bool HasKerning() const { return m_kernSeconds.GetCount() > 0; }
+
+  /// Get the kerning width of a glyph pair
+  /**
+  * \param first the first glyph of the pair
+  * \param second the second glyph of the pair
+  * \return the kerning width of the pair, or 0 if the pair has no kerning
+  */
+  int GetKerning(wxUint32 first, wxUint32 second) const;
+
+private:
+  /// Look up a value in a paged table
+  static int Find(const wxArrayInt& pages, const wxArrayInt& values, wxUint32 code)
+  {
+    size_t page = code >> 8;
+    if (page < pages.GetCount())
+    {
+      int offset = pages[page];
+      if (offset >= 0)
+      {
+        return values[offset + (code & 0xff)];
+      }
+    }
+    return -1;
+  }
+
+  /// Add a value to a paged table
+  static bool Add(wxArrayInt& pages, wxArrayInt& values, wxUint32 code, int value);
+
+  bool             m_valid;       ///< Flag whether all map entries are represented
+  wxArrayInt       m_widthPages;  ///< Offsets of the populated pages of character widths
+  wxArrayInt       m_widths;      ///< Character widths (-1 for unknown characters)
+  wxArrayInt       m_glyphPages;  ///< Offsets of the populated pages of glyph numbers
+  wxArrayInt       m_glyphs;      ///< Glyph numbers (-1 for unmapped characters)
+  wxArrayInt       m_kernPages;   ///< Offsets of the populated pages of first kerning glyphs
+  wxArrayInt       m_kernIndex;   ///< Index of the kerning pair range of a first glyph (-1 for none)
+  wxArrayInt       m_kernStart;   ///< Start of the kerning pair ranges
+  wxArrayInt       m_kernCount;   ///< Number of kerning pairs in the kerning pair ranges
+  wxPdfArrayUint32 m_kernSeconds; ///< Second glyphs of the kerning pairs, sorted per first glyph
+  wxArrayInt       m_kernWidths;  ///< Kerning widths of the kerning pairs
+};
+
+/// Class representing the persistent cache of font subsets
+/**
+* Subsetting and compressing large TrueType or OpenType fonts is expensive.
+* If a cache directory is set, the compressed font subsets created for embedding
+* are stored in this directory and reused by all documents and processes using the
+* same font with the same set of glyphs. Font files are identified by path,
+* modification time and size; font buffers by a digest of their content.
+* Cache files are written atomically, so that the directory may be shared by
+* several processes. Least recently used subsets are removed, if the size limit
+* is exceeded. The cache directory is scanned only when the first subset is stored
+* and when the size counted since then exceeds the limit, so subsets stored by other
+* processes are taken into account at the next scan. The cache is disabled by default.
+*/
+class WXDLLIMPEXP_PDFDOC wxPdfFontSubsetCache
+{
+public:
+  /// Set the cache directory
+  /**
+  * \param directory The cache directory, an empty string disables the cache
+  * \return @c true if the directory exists or could be created, @c false otherwise
+  */
+  static bool SetDirectory(const wxString& directory);
+
+  /// Get the cache directory
+  /**
+  * \return The cache directory or an empty string if the cache is disabled
+  */
+  static wxString GetDirectory();
+
+  /// Set the size limit of the cache
+  /**
+  * \param maxSize The maximum size of all cached font subsets in bytes (default 128 MB)
+  */
+  static void SetMaxSize(wxFileOffset maxSize);
+
+  /// Get the size limit of the cache
+  /**
+  * \return The maximum size of all cached font subsets in bytes
+  */
+  static wxFileOffset GetMaxSize();
+
+  /// Get the number of successful cache lookups
+  /**
+  * \return The number of cache hits
+  */
+  static size_t GetHitCount();
+
+  /// Get the number of failed cache lookups
+  /**
+  * \return The number of cache misses
+  */
+  static size_t GetMissCount();
+
+  /// Remove all font subsets from the cache directory and reset the statistics
+  static void Clear();
+
+  /// Load a compressed font subset from the cache (For internal use only)
+  /**
+  * \param key The key of the font subset
+  * \param fontData The stream receiving the compressed font subset
+  * \param[out] fontSize1 The uncompressed size of the font subset
+  * \param usedGlyphs The list of used glyphs, to which the glyphs of the subset are added
+  * \return @c true if the font subset was found, @c false otherwise
+  */
+  static bool Load(const wxString& key, wxOutputStream* fontData, size_t& fontSize1,
+                   wxPdfGlyphSet* usedGlyphs = NULL);
+
+  /// Store a compressed font subset in the cache (For internal use only)
+  /**
+  * \param key The key of the font subset
+  * \param fontData The compressed font subset
+  * \param fontSize1 The uncompressed size of the font subset
+  * \param usedGlyphs The list of glyphs contained in the subset
+  */
+  static void Store(const wxString& key, const wxMemoryOutputStream& fontData, size_t fontSize1,
+                    wxPdfGlyphSet* usedGlyphs = NULL);
+};
+
 /// Base class for all fonts. (For internal use only)
 /// \internal
 class WXDLLIMPEXP_PDFDOC wxPdfFontData
@@ -223,7 +390,7 @@ public:
   /**
   * \param fontBuffer the wxFont to be associated with the font
   */
-  void SetFontBuffer(const char* fontBuffer) { m_fontBuffer = fontBuffer; }
+  void SetFontBuffer(const char* fontBuffer) { m_fontBuffer = fontBuffer; m_fontDigest = wxEmptyString; }
 
   /// Get associated font data buffer
   /**
@@ -235,7 +402,7 @@ public:
   /**
   * \param fontBufferSize the size of the associated font data buffer
   */
-  void SetFontBufferSize(size_t fontBufferSize) { m_fontBufferSize = fontBufferSize; }
+  void SetFontBufferSize(size_t fontBufferSize) { m_fontBufferSize = fontBufferSize; m_fontDigest = wxEmptyString; }
 
   /// Get the size of the associated font data buffer
   /**
@@ -243,6 +410,15 @@ public:
   */
   size_t GetFontBufferSize() const { return m_fontBufferSize; }
 
+  /// Get a stream reading a memory mapped font file (For internal use only)
+  /**
+  * The font file is mapped on first use and stays mapped while the font data exist;
+  * the mapping is shared with all other font data referring to the same file.
+  * \param fileName the name of the font file
+  * \return a new stream reading the mapped file, or NULL if the file could not be mapped
+  */
+  wxMemoryInputStream* GetMappedFontStream(const wxString& fileName);
+
   /// Set fully qualified font file name
   /**
   * \param fontFileName the fully qualified name of the font file
@@ -553,6 +729,19 @@ public:
   */
   virtual double GetStringWidth(const wxString& s, const wxPdfEncoding* encoding = NULL, bool withKerning = false, double charSpacing = 0) const;
 
+  /// Get the advances of all characters of a string
+  /**
+  * \param s the string for which the advances should be calculated
+  * \param[out] advances the advances of the characters, one entry per character of the string
+  * \param encoding the character to glyph mapping
+  * \param withKerning flag indicating whether kerning should be taken into account
+  * \param charSpacing extra amount of spacing between characters (optional)
+  * \note The kerning correction of a character pair is included in the advance of the second character,
+  * so that the sum of the first n advances is the width of the first n characters.
+  */
+  virtual void GetCharAdvances(const wxString& s, wxPdfArrayDouble& advances,
+                               const wxPdfEncoding* encoding = NULL, bool withKerning = false, double charSpacing = 0) const;
+
   /// Check whether the font can show all characters of a given string
   /**
   * \param s the string to be checked
@@ -580,7 +769,7 @@ public:
   * \return the converted string
   */
   virtual wxString ConvertCID2GID(const wxString& s, const wxPdfEncoding* encoding = NULL,
-                                  wxPdfSortedArrayInt* usedGlyphs = NULL,
+                                  wxPdfGlyphSet* usedGlyphs = NULL,
                                   wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
 
   /// Convert glyph number to string
@@ -592,7 +781,7 @@ public:
   * \return the converted string
   */
   virtual wxString ConvertGlyph(wxUint32 glyph, const wxPdfEncoding* encoding = NULL,
-                                wxPdfSortedArrayInt* usedGlyphs = NULL,
+                                wxPdfGlyphSet* usedGlyphs = NULL,
                                 wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
 
   /// Get the character width array as string
@@ -603,7 +792,7 @@ public:
   * \return the string representation of the character widths
   */
   virtual wxString GetWidthsAsString(bool subset = false,
-                                     wxPdfSortedArrayInt* usedGlyphs = NULL,
+                                     wxPdfGlyphSet* usedGlyphs = NULL,
                                      wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
 
   /// Get list of glyph names supported by this font
@@ -621,7 +810,7 @@ public:
   * \return the size of the written font data
   */
   virtual size_t WriteFontData(wxOutputStream* fontData,
-                               wxPdfSortedArrayInt* usedGlyphs = NULL,
+                               wxPdfGlyphSet* usedGlyphs = NULL,
                                wxPdfChar2GlyphMap* subsetGlyphs = NULL);
 
   /// Write character/glyph to unicode mapping
@@ -634,7 +823,7 @@ public:
   */
   virtual size_t WriteUnicodeMap(wxOutputStream* mapData,
                                  const wxPdfEncoding* encoding = NULL,
-                                 wxPdfSortedArrayInt* usedGlyphs = NULL,
+                                 wxPdfGlyphSet* usedGlyphs = NULL,
                                  wxPdfChar2GlyphMap* subsetGlyphs = NULL);
 
   /// Write CID to GID mapping
@@ -647,7 +836,7 @@ public:
   */
   virtual size_t WriteCIDToGIDMap(wxOutputStream* mapData,
                                   const wxPdfEncoding* encoding = NULL,
-                                  wxPdfSortedArrayInt* usedGlyphs = NULL,
+                                  wxPdfGlyphSet* usedGlyphs = NULL,
                                   wxPdfChar2GlyphMap* subsetGlyphs = NULL);
 
   /// Write CID set
@@ -660,7 +849,7 @@ public:
   */
   virtual size_t WriteCIDSet(wxOutputStream* setData,
                              const wxPdfEncoding* encoding = NULL,
-                             wxPdfSortedArrayInt* usedGlyphs = NULL,
+                             wxPdfGlyphSet* usedGlyphs = NULL,
                              wxPdfChar2GlyphMap* subsetGlyphs = NULL);
 
   /// Set the font description
@@ -724,6 +913,47 @@ protected:
   /// Find the encoding map to be used for character to glyph conversion
   const wxPdfChar2GlyphMap* FindEncodingMap(const wxPdfEncoding* encoding) const;
 
+  /// Compile the width, glyph and kerning maps into a metrics table
+  /**
+  * Should be called whenever loading the font metrics has been completed.
+  * Until then the maps are used directly for measuring text.
+  */
+  void CreateMetricsTable();
+
+  /// Get the width of a character
+  /**
+  * \param ch the character id
+  * \return the width of the character, or -1 if the width is not known
+  */
+  int FindCharWidth(wxUint32 ch) const
+  {
+    if (m_metrics != NULL)
+    {
+      return m_metrics->GetWidth(ch);
+    }
+    wxPdfGlyphWidthMap::const_iterator charIter = m_cw->find(ch);
+    return (charIter != m_cw->end()) ? (int) charIter->second : -1;
+  }
+
+  /// Get the key of a font subset in the subset cache
+  /**
+  * \param usedGlyphs the list of used glyphs
+  * \param subsetGlyphs the mapping of glyphs to subset glyphs, if the subset renumbers the glyphs
+  * \return the key of the font subset, or an empty string if the subset can't be cached
+  */
+  wxString GetSubsetCacheKey(wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs = NULL);
+
+  /// Compress a font subset and write it to a stream
+  /**
+  * \param fontData the stream receiving the compressed font subset
+  * \param subsetStream the font subset
+  * \param cacheKey the key of the font subset in the subset cache, or an empty string
+  * \param usedGlyphs the list of glyphs contained in the subset
+  * \return the uncompressed size of the font subset
+  */
+  static size_t WriteSubsetData(wxOutputStream* fontData, wxMemoryOutputStream* subsetStream,
+                                const wxString& cacheKey, wxPdfGlyphSet* usedGlyphs);
+
   /// Determine font style from font name
   static int FindStyleFromName(const wxString& name);
 
@@ -753,10 +983,13 @@ protected:
   wxFont                m_font;            ///< Associated wxFont object (currently used by wxMSW only)
   const char*           m_fontBuffer;      ///< Associated font data buffer
   size_t                m_fontBufferSize;  ///< Size of the associated font data buffer
+  wxString              m_fontDigest;      ///< Digest of the font data buffer used by the subset cache
+  wxPdfMappedFile*      m_mappedFile;      ///< Memory mapped font file
 
   wxPdfGlyphWidthMap*   m_cw;    ///< Mapping of character ids to character widths
   wxPdfChar2GlyphMap*   m_gn;    ///< Mapping of character ids to glyph numbers
   wxPdfKernPairMap*     m_kp;    ///< Kerning pair map
+  wxPdfFontMetricsTable* m_metrics; ///< Compiled metrics table
 
   wxPdfFontDescription  m_desc;  ///< Font description
 
@@ -783,12 +1016,15 @@ protected:
 
 private:
   /// Thread safe increment of the reference count
-  int IncrementRefCount();
+  void IncrementRefCount();
 
   /// Thread safe decrement of the reference count
+  /**
+  * \return zero if no references remain, a non-zero value otherwise
+  */
   int DecrementRefCount();
 
-  int                   m_refCount;        ///< Reference count
+  wxAtomicInt           m_refCount;        ///< Reference count
 
   void SetEncoding(wxPdfEncoding* encoding);
   void SetEncodingChecker(wxPdfEncodingChecker* encodingChecker);
@@ -58,7 +58,7 @@ public :
   * \param subsetGlyphs the mapping of glyphs to subset glyphs
   * \return the string representation of the character widths
   */
-  virtual wxString GetWidthsAsString(bool subset = false, wxPdfSortedArrayInt* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
+  virtual wxString GetWidthsAsString(bool subset = false, wxPdfGlyphSet* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
 
   /// Get the width of a string
   /**
@@ -87,7 +87,7 @@ public :
   * \return the converted string
   */
   virtual wxString ConvertCID2GID(const wxString& s, const wxPdfEncoding* encoding = NULL,
-                                  wxPdfSortedArrayInt* usedGlyphs = NULL,
+                                  wxPdfGlyphSet* usedGlyphs = NULL,
                                   wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
 
 #if wxUSE_UNICODE
@@ -70,7 +70,7 @@ public:
   * \return the converted string
   */
   virtual wxString ConvertCID2GID(const wxString& s, const wxPdfEncoding* encoding = NULL,
-                                  wxPdfSortedArrayInt* usedGlyphs = NULL,
+                                  wxPdfGlyphSet* usedGlyphs = NULL,
                                   wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
 
   /// Convert glyph number to string
@@ -82,7 +82,7 @@ public:
   * \return the converted string
   */
   virtual wxString ConvertGlyph(wxUint32 glyph, const wxPdfEncoding* encoding = NULL,
-                                wxPdfSortedArrayInt* usedGlyphs = NULL,
+                                wxPdfGlyphSet* usedGlyphs = NULL,
                                 wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
 
   /// Get the character width array as string
@@ -92,7 +92,7 @@ public:
   * \param subsetGlyphs the mapping of glyphs to subset glyphs
   * \return the string representation of the character widths
   */
-  virtual wxString GetWidthsAsString(bool subset, wxPdfSortedArrayInt* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
+  virtual wxString GetWidthsAsString(bool subset, wxPdfGlyphSet* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
 
   /// Load the font metrics XML file
   /**
@@ -109,7 +109,7 @@ public:
   * \return the size of the written font data
   */
   virtual size_t WriteFontData(wxOutputStream* fontData,
-                               wxPdfSortedArrayInt* usedGlyphs = NULL,
+                               wxPdfGlyphSet* usedGlyphs = NULL,
                                wxPdfChar2GlyphMap* subsetGlyphs = NULL);
 
   /// Write character/glyph to unicode mapping
@@ -122,7 +122,7 @@ public:
   */
   virtual size_t WriteUnicodeMap(wxOutputStream* mapData,
                                  const wxPdfEncoding* encoding = NULL,
-                                 wxPdfSortedArrayInt* usedGlyphs = NULL,
+                                 wxPdfGlyphSet* usedGlyphs = NULL,
                                  wxPdfChar2GlyphMap* subsetGlyphs = NULL);
 
   /// Write CID set
@@ -135,7 +135,7 @@ public:
   */
   virtual size_t WriteCIDSet(wxOutputStream* setData,
                              const wxPdfEncoding* encoding = NULL,
-                             wxPdfSortedArrayInt* usedGlyphs = NULL,
+                             wxPdfGlyphSet* usedGlyphs = NULL,
                              wxPdfChar2GlyphMap* subsetGlyphs = NULL);
 
   /// Get the associated encoding converter
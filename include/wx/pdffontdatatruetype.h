@@ -63,7 +63,7 @@ public:
   * \return the converted string
   */
   virtual wxString ConvertCID2GID(const wxString& s, const wxPdfEncoding* encoding = NULL,
-                                  wxPdfSortedArrayInt* usedGlyphs = NULL,
+                                  wxPdfGlyphSet* usedGlyphs = NULL,
                                   wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
 
   /// Get the character width array as string
@@ -73,7 +73,7 @@ public:
   * \param subsetGlyphs the mapping of glyphs to subset glyphs
   * \return the string representation of the character widths
   */
-  virtual wxString GetWidthsAsString(bool subset = false, wxPdfSortedArrayInt* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
+  virtual wxString GetWidthsAsString(bool subset = false, wxPdfGlyphSet* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
 
   /// Load the font metrics XML file
   /**
@@ -89,7 +89,7 @@ public:
   * \param subsetGlyphs the mapping of glyphs to subset glyphs
   * \return the size of the written font data
   */
-  virtual size_t WriteFontData(wxOutputStream* fontData, wxPdfSortedArrayInt* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL);
+  virtual size_t WriteFontData(wxOutputStream* fontData, wxPdfGlyphSet* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL);
 
 #if wxUSE_UNICODE
   /// Get the associated encoding converter
@@ -166,7 +166,7 @@ public:
   * \return the converted string
   */
   virtual wxString ConvertCID2GID(const wxString& s, const wxPdfEncoding* encoding = NULL,
-                                  wxPdfSortedArrayInt* usedGlyphs = NULL,
+                                  wxPdfGlyphSet* usedGlyphs = NULL,
                                   wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
 
   /// Convert glyph number to string
@@ -178,7 +178,7 @@ public:
   * \return the converted string
   */
   virtual wxString ConvertGlyph(wxUint32 glyph, const wxPdfEncoding* encoding = NULL,
-                                wxPdfSortedArrayInt* usedGlyphs = NULL,
+                                wxPdfGlyphSet* usedGlyphs = NULL,
                                 wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
 
   /// Get the character width array as string
@@ -188,7 +188,7 @@ public:
   * \param subsetGlyphs the mapping of glyphs to subset glyphs
   * \return the string representation of the character widths
   */
-  virtual wxString GetWidthsAsString(bool subset, wxPdfSortedArrayInt* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
+  virtual wxString GetWidthsAsString(bool subset, wxPdfGlyphSet* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
 
   /// Load the font metrics XML file
   /**
@@ -204,7 +204,7 @@ public:
   * \param subsetGlyphs the mapping of glyphs to subset glyphs
   * \return the size of the written font data
   */
-  virtual size_t WriteFontData(wxOutputStream* fontData, wxPdfSortedArrayInt* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL);
+  virtual size_t WriteFontData(wxOutputStream* fontData, wxPdfGlyphSet* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL);
 
   /// Write character/glyph to unicode mapping
   /**
@@ -216,7 +216,7 @@ public:
   */
   virtual size_t WriteUnicodeMap(wxOutputStream* mapData,
                                  const wxPdfEncoding* encoding = NULL,
-                                 wxPdfSortedArrayInt* usedGlyphs = NULL,
+                                 wxPdfGlyphSet* usedGlyphs = NULL,
                                  wxPdfChar2GlyphMap* subsetGlyphs = NULL);
 
   /// Write CID to GID mapping
@@ -229,7 +229,7 @@ public:
   */
   virtual size_t WriteCIDToGIDMap(wxOutputStream* mapData,
                                   const wxPdfEncoding* encoding = NULL,
-                                  wxPdfSortedArrayInt* usedGlyphs = NULL,
+                                  wxPdfGlyphSet* usedGlyphs = NULL,
                                   wxPdfChar2GlyphMap* subsetGlyphs = NULL);
 
   /// Write CID set
@@ -242,7 +242,7 @@ public:
   */
   virtual size_t WriteCIDSet(wxOutputStream* setData,
                              const wxPdfEncoding* encoding = NULL,
-                             wxPdfSortedArrayInt* usedGlyphs = NULL,
+                             wxPdfGlyphSet* usedGlyphs = NULL,
                              wxPdfChar2GlyphMap* subsetGlyphs = NULL);
 
   /// Get the associated encoding converter
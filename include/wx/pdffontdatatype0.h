@@ -59,7 +59,7 @@ public:
   * \param subsetGlyphs the mapping of glyphs to subset glyphs
   * \return the string representation of the character widths
   */
-  virtual wxString GetWidthsAsString(bool subset, wxPdfSortedArrayInt* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
+  virtual wxString GetWidthsAsString(bool subset, wxPdfGlyphSet* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
 
   /// Get the width of a string
   /**
@@ -88,7 +88,7 @@ public:
   * \return the converted string
   */
   virtual wxString ConvertCID2GID(const wxString& s, const wxPdfEncoding* encoding = NULL,
-                                  wxPdfSortedArrayInt* usedGlyphs = NULL,
+                                  wxPdfGlyphSet* usedGlyphs = NULL,
                                   wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
 
   /// Load the font metrics XML file
@@ -63,7 +63,7 @@ public:
   * \return the converted string
   */
   virtual wxString ConvertCID2GID(const wxString& s, const wxPdfEncoding* encoding,
-                                  wxPdfSortedArrayInt* usedGlyphs = NULL,
+                                  wxPdfGlyphSet* usedGlyphs = NULL,
                                   wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
 
   /// Load the font metrics XML file
@@ -86,7 +86,7 @@ public:
   * \param subsetGlyphs the mapping of glyphs to subset glyphs
   * \return the string representation of the character widths
   */
-  virtual wxString GetWidthsAsString(bool subset = false, wxPdfSortedArrayInt* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
+  virtual wxString GetWidthsAsString(bool subset = false, wxPdfGlyphSet* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
 
 #if wxUSE_UNICODE
   /// Get the character width array as string
@@ -98,7 +98,7 @@ public:
   * \return the string representation of the character widths
   */
   virtual wxString GetWidthsAsString(const wxArrayString& glyphNames, bool subset = false,
-                                     wxPdfSortedArrayInt* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
+                                     wxPdfGlyphSet* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
 
   /// Get a list of glyph names available in the font
   /**
@@ -116,7 +116,7 @@ public:
   * \return the size of the written font data
   */
   virtual size_t WriteFontData(wxOutputStream* fontData,
-                               wxPdfSortedArrayInt* usedGlyphs = NULL,
+                               wxPdfGlyphSet* usedGlyphs = NULL,
                                wxPdfChar2GlyphMap* subsetGlyphs = NULL);
 
   /// Write character/glyph to unicode mapping
@@ -129,7 +129,7 @@ public:
   */
   virtual size_t WriteUnicodeMap(wxOutputStream* mapData,
                                  const wxPdfEncoding* encoding = NULL,
-                                 wxPdfSortedArrayInt* usedGlyphs = NULL,
+                                 wxPdfGlyphSet* usedGlyphs = NULL,
                                  wxPdfChar2GlyphMap* subsetGlyphs = NULL);
 
 #if wxUSE_UNICODE
@@ -12,6 +12,8 @@
 #ifndef _PDF_FONT_DETAILS_H_
 #define _PDF_FONT_DETAILS_H_
 
+#include <string>
+
 // wxWidgets headers
 
 // wxPdfDocument headers
@@ -165,6 +167,15 @@ public:
   */
   double GetStringWidth(const wxString& s, bool withKerning = false, double charSpacing = 0);
 
+  /// Get the advances of all characters of a string
+  /**
+  * \param s string for which the advances should be calculated
+  * \param[out] advances the advances of the characters, one entry per character of the string
+  * \param withKerning flag whether kerning should be taken into account
+  * \param charSpacing extra amount of spacing between characters (optional)
+  */
+  void GetCharAdvances(const wxString& s, wxPdfArrayDouble& advances, bool withKerning = false, double charSpacing = 0);
+
   /// Get kerning width array
   /**
   * \param s the string for which kerning information should be provided
@@ -238,7 +249,7 @@ protected:
   int                  m_ndiff; ///< Index of encoding differences object
 
   wxPdfFontExtended    m_font;         ///< Extended font for accessing font data
-  wxPdfSortedArrayInt* m_usedGlyphs;   ///< Array of used characters
+  wxPdfGlyphSet*       m_usedGlyphs;   ///< Set of used glyphs
   wxPdfChar2GlyphMap*  m_subsetGlyphs; ///< Glyph substitution map for font subsets
 
 private:
@@ -246,4 +257,74 @@ private:
   wxPdfFontDetails();
 };
 
+/// Class representing the accumulated advances of a text for line breaking. (For internal use only)
+/**
+* The advances of all characters and the kerning corrections of all adjacent
+* character pairs are determined in a single pass over the text. Afterwards
+* the width of any range of the text is available as the difference of two
+* prefix sums, instead of measuring the growing substring over and over again.
+*/
+class WXDLLIMPEXP_PDFDOC wxPdfLineBreaker
+{
+public:
+  /// Constructor
+  /**
+  * \param font the font used for measuring the text
+  * \param s the text to be broken into lines
+  * \param kerning flag whether kerning should be applied
+  * \param charSpacing the additional spacing between characters in user units
+  * \param fontSize the font size in user units
+  */
+  wxPdfLineBreaker(wxPdfFontDetails* font, const wxString& s, bool kerning, double charSpacing, double fontSize);
+
+  /// Get the width of a text range
+  /**
+  * \param from the index of the first character of the range
+  * \param to the index of the last character of the range
+  * \return the width of the text range in user units
+  */
+  double GetWidth(int from, int to) const
+  {
+    double width = 0;
+    if (from <= to)
+    {
+      width = m_widths[to+1] - m_widths[from];
+      if (m_kerning.GetCount() > 0)
+      {
+        width -= m_kerning[from];
+      }
+    }
+    return width;
+  }
+
+private:
+  wxPdfArrayDouble m_widths;  ///< Accumulated character advances
+  wxPdfArrayDouble m_kerning; ///< Kerning corrections between each character and its predecessor
+};
+
+/// Class representing the cached measurement and encoding of a text string (For internal use only)
+/**
+* A text run is cached per font. Since the glyphs used by a text string are recorded
+* for font subsetting when the string is encoded for the first time, and since the
+* glyph usage of a font is never reset, reusing the encoded string is safe.
+*/
+class WXDLLIMPEXP_PDFDOC wxPdfTextRun
+{
+public:
+  /// Default constructor
+  wxPdfTextRun()
+    : m_hasEscaped(false), m_hasKerning(false)
+  {
+    m_width[0] = m_width[1] = 0;
+    m_hasWidth[0] = m_hasWidth[1] = false;
+  }
+
+  std::string m_escaped;     ///< Encoded and escaped text string
+  bool        m_hasEscaped;  ///< Flag whether the encoded text string is available
+  wxArrayInt  m_kerning;     ///< Kerning width array
+  bool        m_hasKerning;  ///< Flag whether the kerning width array is available
+  double      m_width[2];    ///< Width in font units without and with kerning
+  bool        m_hasWidth[2]; ///< Flags whether the widths are available
+};
+
 #endif
@@ -176,7 +176,7 @@ public:
   * \param subsetGlyphs the mapping of glyphs to subset glyphs
   * \return the string representation of the character widths
   */
-  wxString GetWidthsAsString(bool subset = false, wxPdfSortedArrayInt* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
+  wxString GetWidthsAsString(bool subset = false, wxPdfGlyphSet* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL) const;
 
   /// Get the width of a string
   /**
@@ -187,6 +187,15 @@ public:
   */
   double GetStringWidth(const wxString& s, bool withKerning = false, double charSpacing = 0);
 
+  /// Get the advances of all characters of a string
+  /**
+  * \param s the string for which the advances should be calculated
+  * \param[out] advances the advances of the characters, one entry per character of the string
+  * \param withKerning flag indicating whether kerning should be taken into account
+  * \param charSpacing extra amount of spacing between characters (optional)
+  */
+  void GetCharAdvances(const wxString& s, wxPdfArrayDouble& advances, bool withKerning = false, double charSpacing = 0);
+
   /// Get kerning width array
   /**
   * \param s the string for which kerning information should be provided
@@ -211,7 +220,7 @@ public:
   * \param subsetGlyphs the mapping of glyphs to subset glyphs
   * \return the converted string
   */
-  wxString ConvertCID2GID(const wxString& s, wxPdfSortedArrayInt* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL);
+  wxString ConvertCID2GID(const wxString& s, wxPdfGlyphSet* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL);
 
   /// Convert glyph number to string
   /**
@@ -220,7 +229,7 @@ public:
   * \param subsetGlyphs the mapping of glyphs to subset glyphs
   * \return the converted string
   */
-  wxString ConvertGlyph(wxUint32 glyph, wxPdfSortedArrayInt* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL);
+  wxString ConvertGlyph(wxUint32 glyph, wxPdfGlyphSet* usedGlyphs = NULL, wxPdfChar2GlyphMap* subsetGlyphs = NULL);
 
   /// Check whether the font will be embedded
   /**
@@ -241,7 +250,7 @@ public:
   * \param subsetGlyphs the mapping of glyphs to subset glyphs
   * \return the size of the written font data
   */
-  size_t WriteFontData(wxOutputStream* fontData, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs);
+  size_t WriteFontData(wxOutputStream* fontData, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs);
 
   /// Write character/glyph to unicode mapping
   /**
@@ -250,7 +259,7 @@ public:
   * \param subsetGlyphs the mapping of glyphs to subset glyphs
   * \return the size of the written data
   */
-  size_t WriteUnicodeMap(wxOutputStream* mapData, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs);
+  size_t WriteUnicodeMap(wxOutputStream* mapData, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs);
 
   /// Write CID to GID mapping
   /**
@@ -259,7 +268,7 @@ public:
   * \param subsetGlyphs the mapping of glyphs to subset glyphs
   * \return the size of the written data
   */
-  size_t WriteCIDToGIDMap(wxOutputStream* mapData, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs);
+  size_t WriteCIDToGIDMap(wxOutputStream* mapData, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs);
 
   /// Write CID set
   /**
@@ -268,7 +277,7 @@ public:
   * \param subsetGlyphs the mapping of glyphs to subset glyphs
   * \return the size of the written data
   */
-  size_t WriteCIDSet(wxOutputStream* setData, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs);
+  size_t WriteCIDSet(wxOutputStream* setData, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs);
 
   /// Get the font description
   const wxPdfFontDescription& GetDescription() const;
@@ -309,6 +318,19 @@ public:
   */
   wxString ApplyVoltData(const wxString& txt) const;
 
+  /// Get the underlying font data (For internal use only)
+  /**
+  * Fonts sharing the same font data must not write their font data concurrently.
+  * \return the font data shared by all fonts based on the same font file
+  */
+  const wxPdfFontData* GetFontData() const { return m_fontData; }
+
+  /// Check whether the font data is read via the operating system font API
+  /**
+  * \return @c true if the font program is retrieved from a native font object, @c false otherwise
+  */
+  bool UsesSystemFont() const;
+
 protected:
 
 private:
@@ -165,6 +165,53 @@ public:
   */
   int RegisterFontDirectory(const wxString& directory, bool recursive = false);
 
+  /// Set the persistent font index file
+  /**
+  * The font index remembers the family, style and names of TrueType and OpenType font files
+  * identified by RegisterFont(), RegisterFontCollection(), RegisterFontDirectory() and
+  * RegisterSystemFonts(), keyed by file path, size and modification time. Registering a font
+  * file contained in the index requires only a single file status query instead of reading
+  * the font file; the full font metrics are loaded only when the font is used for the first time.
+  *
+  * If the index file exists, it is loaded immediately. The index is written back by
+  * SaveFontIndex(), after registering a font directory or the system fonts, and when the
+  * font manager is destroyed.
+  *
+  * \param indexFileName the name of the index file (empty to disable the persistent index)
+  * \return @c true if the index file could be loaded or does not exist yet, @c false otherwise
+  */
+  bool SetFontIndexFile(const wxString& indexFileName);
+
+  /// Get the persistent font index file
+  /**
+  * \return the name of the index file, or an empty string if no persistent index is used
+  */
+  wxString GetFontIndexFile() const;
+
+  /// Save the persistent font index
+  /**
+  * Entries of font files, which were not used in this session and no longer exist, are removed.
+  * \return @c true if the index file was written successfully or was unchanged, @c false otherwise
+  */
+  bool SaveFontIndex();
+
+  /// Set the number of threads used to identify font files
+  /**
+  * RegisterFontDirectory() and RegisterSystemFonts() identify font files not yet contained in the
+  * font index using the given number of threads, before the fonts are registered. This speeds up
+  * the first registration of a large number of fonts.
+  *
+  * \param numThreads the number of threads (1 = identify fonts sequentially, default)
+  * \return the number of threads prior to this call
+  */
+  int SetFontScanThreads(int numThreads);
+
+  /// Get the number of threads used to identify font files
+  /**
+  * \return the number of threads
+  */
+  int GetFontScanThreads() const;
+
   /// Get a font by name and style
   /**
   * Based on the given name and style the list of registered fonts is searched for a matching font.
@@ -36,12 +36,12 @@ public:
   /// Create subset of a font
   /**
   * \param inFont stream containing the font data
-  * \param glyphsUsed a list of used glyphs
+  * \param glyphsUsed the set of used glyphs, components of composite glyphs are added
   * \param includeCmap flag whether to include the CMap table
   * \return the stream containing the font subset
   */
   wxMemoryOutputStream* CreateSubset(wxInputStream* inFont,
-                                     wxPdfSortedArrayInt* glyphsUsed,
+                                     wxPdfGlyphSet* glyphsUsed,
                                      bool includeCmap = false);
 #if defined(__WXMAC__)
 #if wxPDFMACOSX_HAS_CORE_TEXT
@@ -58,7 +58,11 @@ protected:
   bool CheckGlyphs();
 
   /// Find the components of a glyph
-  void FindGlyphComponents(int glyph);
+  /**
+  * \param glyph the glyph number
+  * \param pendingGlyphs list of glyphs to be checked, components not used so far are appended
+  */
+  void FindGlyphComponents(int glyph, wxPdfArrayUint32& pendingGlyphs);
 
   /// Create a new table
   void CreateNewTables();
@@ -84,7 +88,7 @@ protected:
 private:
   wxMemoryOutputStream* m_outFont;    ///< Subset output stream
 
-  wxPdfSortedArrayInt*  m_usedGlyphs; ///< list of used glyphs
+  wxPdfGlyphSet*        m_usedGlyphs; ///< set of used glyphs
 
   int    m_fontIndex;                 ///< Index of font in font collection
   bool   m_includeCmap;               ///< Flag whether to include the CMap
@@ -18,6 +18,9 @@
 #include <wx/stream.h>
 #include <wx/string.h>
 
+#include <utility>
+#include <vector>
+
 // wxPdfDocument headers
 #include "wx/pdfdocdef.h"
 
@@ -32,8 +35,17 @@ public:
   wxPdfImage(wxPdfDocument* document, int index, const wxString& name, const wxString& type);
 
   /// Constructor
+  /**
+  * Unless JPEG format is requested, the pixel data of the image are encoded directly.
+  * \param document Document this image belongs to
+  * \param index Image index
+  * \param name Image name
+  * \param image The image
+  * \param jpegFormat Flag whether the image is encoded as JPEG
+  * \param alphaMask Flag whether the alpha channel of the image is encoded as a greyscale soft mask
+  */
   wxPdfImage(wxPdfDocument* document, int index, const wxString& name, const wxImage& image,
-             bool jpegFormat = false);
+             bool jpegFormat = false, bool alphaMask = false);
 
   /// Constructor
   wxPdfImage(wxPdfDocument* document, int index, const wxString& name, wxInputStream& stream, const wxString& mimeType);
@@ -191,12 +203,119 @@ public:
   */
   char* GetData() { return m_data; }
 
+  /// Check whether the image has a soft mask
+  /**
+  * A soft mask is extracted from the alpha channel of PNG images.
+  * \return @c true if the image has a soft mask, @c false otherwise
+  */
+  bool HasSoftMask() { return m_smask != NULL; }
+
+  /// Create an image object for the soft mask of this image
+  /**
+  * The soft mask data are transferred to the new image, i.e. the image has no soft mask afterwards.
+  * \param index Image index of the soft mask
+  * \param name Image name of the soft mask
+  * \return The soft mask image, or NULL if the image has no soft mask
+  */
+  wxPdfImage* CreateSoftMask(int index, const wxString& name);
+
+  /// Discard the soft mask of this image
+  /**
+  * Used if the image is drawn with an explicitly given mask instead of its alpha channel.
+  */
+  void DiscardSoftMask();
+
+  /// Write the image data to a stream
+  /**
+  * If loading the image data was deferred, the data are read from the image file.
+  * \param stream The output stream
+  * \return @c true if the data could be written, @c false otherwise
+  */
+  bool WriteData(wxOutputStream& stream);
+
+  /// Check whether loading the image data was deferred until output
+  /**
+  * \return @c true if the image data are read from the image file on output, @c false otherwise
+  */
+  bool IsDeferred() { return !m_deferredFile.IsEmpty(); }
+
+  /// Record the size of a placement of the image
+  /**
+  * Only the largest placement size is kept.
+  * \param width Placed width in points
+  * \param height Placed height in points
+  */
+  void UpdatePlacedSize(double width, double height);
+
+  /// Get the largest placed width
+  /**
+  * \return Placed width in points, 0 if the image was not placed
+  */
+  double GetPlacedWidth() { return m_placedWidth; }
+
+  /// Get the largest placed height
+  /**
+  * \return Placed height in points, 0 if the image was not placed
+  */
+  double GetPlacedHeight() { return m_placedHeight; }
+
+  /// Forget the placement sizes, e.g. when the document is reset
+  void ResetPlacedSize() { m_placedWidth = 0; m_placedHeight = 0; }
+
+  /// Create a downsampled and recompressed copy of the image according to an image policy
+  /**
+  * The image is downsampled if its resolution at its largest placement exceeds the target
+  * resolution or if it has more pixels than allowed. JPEG images are encoded as JPEG again,
+  * all other images are Flate compressed. Only 8-bit greyscale and RGB images are handled.
+  * The image itself is not changed, so that it can be used again in full resolution
+  * after the document was reset.
+  * \param targetDpi Target resolution in dots per inch, 0 to ignore the placed size
+  * \param maxPixels Maximum number of pixels, 0 for unlimited
+  * \param jpegQuality Quality for encoding JPEG images
+  * \param detectGreyscale Flag whether Flate compressed RGB images containing only grey pixels are converted to greyscale
+  * \return The image holding the data to be written instead, which the caller has to delete,
+  * or NULL if the image is written unchanged
+  */
+  wxPdfImage* CreatePolicyImage(double targetDpi, int maxPixels, int jpegQuality, bool detectGreyscale);
+
   /// Parse image file
   bool Parse();
 
+  /// Calculate a digest of the content of a wxImage
+  /**
+  * The digest covers the pixel data, the alpha channel, the mask colour
+  * and the image options relevant for encoding the image.
+  * \param image The image
+  * \param jpegFormat Flag whether the image is encoded as JPEG
+  * \param jpegQuality The JPEG quality
+  * \param maskImage ID of the associated image mask
+  * \return The hexadecimal digest string
+  */
+  static wxString GetDigest(const wxImage& image, bool jpegFormat, int jpegQuality = 0, int maskImage = 0);
+
 protected:
+  /// Constructor for an image whose data are set directly
+  wxPdfImage(wxPdfDocument* document, int index, const wxString& name);
+
   /// Extract info from a wxImage
-  bool ConvertWxImage(const wxImage& image, bool jpegFormat);
+  bool ConvertWxImage(const wxImage& image, bool jpegFormat, bool alphaMask);
+
+  /// Encode the pixel data of a wxImage as Flate compressed image data
+  /**
+  * The RGB data (or the alpha channel, if an alpha mask is requested) are compressed in a single pass,
+  * optionally applying PNG row predictors. The image option wxIMAGE_OPTION_PNG_FORMAT selects
+  * greyscale output like for PNG encoding.
+  */
+  bool EncodeWxImage(const wxImage& image, bool alphaMask);
+
+  /// Decode the image data into a wxImage
+  bool DecodeImage(wxImage& image);
+
+  /// Get the image data from the shared image cache
+  bool LoadFromCache(const wxString& key);
+
+  /// Put the image data into the shared image cache
+  void StoreInCache(const wxString& key);
 
   /// Extract info from a JPEG file
   bool ParseJPG(wxInputStream* imageStream);
@@ -204,6 +323,15 @@ protected:
   /// Extract info from a PNG file
   bool ParsePNG(wxInputStream* imageStream);
 
+  /// Split the image data of a PNG file with alpha channel into colour data and soft mask
+  /**
+  * The image data are inflated and unfiltered row by row; colour and alpha samples are
+  * compressed separately.
+  * \param colors Number of colour components
+  * \param bytesPerSample Number of bytes per sample (1 or 2)
+  */
+  bool SplitAlphaPNG(int colors, int bytesPerSample);
+
   /// Extract info from a GIF file
   bool ParseGIF(wxInputStream* imageStream);
 
@@ -257,18 +385,74 @@ protected:
   char*          m_trns;      ///< Transparency colour data
   unsigned int   m_dataSize;  ///< Image data size
   char*          m_data;      ///< Image data
+  unsigned int   m_smaskSize; ///< Soft mask data size
+  char*          m_smask;     ///< Soft mask data
 
   bool           m_isFormObj; ///< Flag whether image must be treated as form object
   int            m_x;         ///< Offset in X direction
   int            m_y;         ///< Offset in Y direction
+  double         m_placedWidth;  ///< Largest placed width in points
+  double         m_placedHeight; ///< Largest placed height in points
 
   bool           m_fromWxImage;  ///< Flag whether image originated from wxImage
   bool           m_validWxImage; ///< Flag whether wxImage conversion went ok
 
+  wxString       m_cacheKey;     ///< Key of the image in the shared image cache
   wxFSFile*      m_imageFile;    ///< File system file of image
   wxInputStream* m_imageStream;  ///< Stream containing the image data
 
+  wxString       m_deferredFile;     ///< Image file from which the image data are read on output
+  wxFileOffset   m_deferredFileSize; ///< Size of the image file at parse time
+  wxLongLong     m_deferredModTime;  ///< Modification time of the image file at parse time
+  std::vector< std::pair<wxFileOffset, unsigned int> > m_deferredBlocks; ///< Offsets and sizes of the image data blocks
+
   static wxFileSystem* ms_fileSystem; ///< File system for accessing image files
 };
 
+/// Class representing the process-wide cache of parsed images
+/**
+* Images loaded from local files or created from wxImage objects are parsed
+* respectively encoded only once per process, if the cache is enabled.
+* Image files are identified by path, modification time and size; wxImage
+* objects by a digest of their content. The cache is shared by all documents
+* and is thread-safe. Least recently used images are dropped, if the
+* memory limit is exceeded.
+*/
+class WXDLLIMPEXP_PDFDOC wxPdfImageCache
+{
+public:
+  /// Set the memory limit of the cache
+  /**
+  * \param maxSize The memory limit in bytes, 0 disables the cache (default)
+  */
+  static void SetMaxSize(size_t maxSize);
+
+  /// Get the memory limit of the cache
+  /**
+  * \return The memory limit in bytes
+  */
+  static size_t GetMaxSize();
+
+  /// Get the memory currently used by the cache
+  /**
+  * \return The size of all cached images in bytes
+  */
+  static size_t GetSize();
+
+  /// Get the number of successful cache lookups
+  /**
+  * \return The number of cache hits
+  */
+  static size_t GetHitCount();
+
+  /// Get the number of failed cache lookups
+  /**
+  * \return The number of cache misses
+  */
+  static size_t GetMissCount();
+
+  /// Remove all images from the cache and reset the statistics
+  static void Clear();
+};
+
 #endif
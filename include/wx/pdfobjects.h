@@ -493,9 +493,42 @@ public:
 
   /// Get the stream data buffer
   /**
+  * If only a view of the stream data is available, the data are copied into a buffer.
   * \return The memory output stream containing the data
   */
-  wxMemoryOutputStream* GetBuffer() { return m_buffer; }
+  wxMemoryOutputStream* GetBuffer();
+
+  /// Set a view of the raw stream data
+  /**
+  * The data are owned by the parser and must stay valid for the lifetime of the stream.
+  * \param data Pointer to the stream data
+  * \param length The length of the stream data
+  */
+  void SetDataView(const char* data, size_t length) { m_viewData = data; m_viewLength = length; }
+
+  /// Check whether a view of the raw stream data is available
+  /**
+  * \return @c true if a view is available, @c false otherwise
+  */
+  bool HasDataView() const { return m_viewData != NULL; }
+
+  /// Get the view of the raw stream data
+  /**
+  * \return Pointer to the stream data
+  */
+  const char* GetDataView() const { return m_viewData; }
+
+  /// Get the length of the view of the raw stream data
+  /**
+  * \return The length of the stream data
+  */
+  size_t GetDataViewLength() const { return m_viewLength; }
+
+  /// Release the stream data
+  /**
+  * The stream data buffer is deleted and the view of the raw stream data is dropped.
+  */
+  void ReleaseData();
 
   /// Get a value identified by the given key from the associated dictionary
   /**
@@ -533,6 +566,8 @@ private:
   off_t                 m_offset;        ///< Offset of the stream data
   wxPdfDictionary*      m_dictionary;    ///< Associated stream dictionary
   wxMemoryOutputStream* m_buffer;        ///< Stream data buffer
+  const char*           m_viewData;      ///< View of the raw stream data
+  size_t                m_viewLength;    ///< Length of the view of the raw stream data
   bool                  m_hasObjOffsets; ///< Flag whether the stream is an object stream
   wxArrayInt            m_objOffsets;    ///< Object offsets in object stream
 };
@@ -25,6 +25,7 @@
 
 class WXDLLIMPEXP_FWD_PDFDOC wxPdfEncrypt;
 class WXDLLIMPEXP_FWD_PDFDOC wxPdfInfo;
+class WXDLLIMPEXP_FWD_PDFDOC wxPdfMappedFile;
 
 /// Permissions required for import of a document
 // Permission bit  3: Print
@@ -62,6 +63,15 @@ public:
   */
   wxPdfTokenizer(wxInputStream* inputStream);
 
+  /// Constructor
+  /**
+  * The tokenizer scans the given memory block directly, without copying it.
+  * The memory block must stay valid for the lifetime of the tokenizer.
+  * \param data The data to tokenize
+  * \param length The length of the data in bytes
+  */
+  wxPdfTokenizer(const char* data, size_t length);
+
   /// Destructor
   virtual ~wxPdfTokenizer();
 
@@ -103,6 +113,15 @@ public:
   */
   wxMemoryOutputStream* ReadBuffer(size_t size);
 
+  /// Get a view of size bytes of the data
+  /**
+  * A view is only available if the tokenizer scans a memory block.
+  * \param pos The offset of the first byte
+  * \param size The number of bytes
+  * \return A pointer to the data, or NULL if no view is available
+  */
+  const char* GetData(off_t pos, size_t size) const;
+
   /// Find the offset of the startxref tag
   /**
   * \return The byte offset of the cross-reference table
@@ -199,7 +218,13 @@ public:
   static int GetHex(int v);
 
 private:
+  /// Read size bytes into a buffer
+  size_t ReadBytes(char* buffer, size_t size);
+
   wxInputStream* m_inputStream; ///< Stream of document data
+  const char*    m_data;        ///< Document data, if a memory block is scanned
+  size_t         m_dataLength;  ///< Length of document data
+  size_t         m_position;    ///< Current position in document data
   int            m_type;        ///< Type of last token
   wxString       m_stringValue; ///< Value of last token
   int            m_reference;   ///< Reference number of object
@@ -229,6 +254,97 @@ public:
 
 WX_DECLARE_USER_EXPORTED_OBJARRAY(wxPdfXRefEntry, wxPdfXRef, WXDLLIMPEXP_PDFDOC);
 
+/// Default byte budget of the parser object cache
+#define WXPDF_OBJECT_CACHE_SIZE (16*1024*1024)
+
+/// Class representing an entry of the parser object cache (for internal use only)
+class WXDLLIMPEXP_PDFDOC wxPdfObjectCacheEntry
+{
+public:
+  /// Constructor
+  wxPdfObjectCacheEntry(long objNum, wxPdfObject* object, size_t size);
+
+  long                   m_objNum; ///< Object number
+  wxPdfObject*           m_object; ///< Cached object
+  size_t                 m_size;   ///< Estimated memory size of the object
+  wxPdfObjectCacheEntry* m_prev;   ///< Previous (more recently used) entry
+  wxPdfObjectCacheEntry* m_next;   ///< Next (less recently used) entry
+};
+
+/// Hashmap class for object cache entries (For internal use only)
+WX_DECLARE_HASH_MAP_WITH_DECL(long, wxPdfObjectCacheEntry*, wxIntegerHash, wxIntegerEqual, wxPdfObjectCacheMap, class WXDLLIMPEXP_PDFDOC);
+
+/// Class representing a least recently used cache of parsed objects (for internal use only)
+/**
+* The cache owns the objects added to it. If the total size of the cached objects
+* exceeds the byte budget, the least recently used objects are deleted. The most
+* recently used object is always kept, even if it exceeds the budget on its own.
+*/
+class WXDLLIMPEXP_PDFDOC wxPdfObjectCache
+{
+public:
+  /// Constructor
+  /**
+  * \param maxSize The byte budget of the cache
+  */
+  wxPdfObjectCache(size_t maxSize = WXPDF_OBJECT_CACHE_SIZE);
+
+  /// Destructor
+  virtual ~wxPdfObjectCache();
+
+  /// Set the byte budget of the cache
+  /**
+  * \param maxSize The byte budget of the cache
+  */
+  void SetMaxSize(size_t maxSize);
+
+  /// Get the byte budget of the cache
+  /**
+  * \return The byte budget of the cache
+  */
+  size_t GetMaxSize() const { return m_maxSize; }
+
+  /// Get the total size of the cached objects
+  /**
+  * \return The estimated memory size of all cached objects
+  */
+  size_t GetSize() const { return m_size; }
+
+  /// Add an object to the cache
+  /**
+  * The cache takes ownership of the object. An object cached under the same number is deleted.
+  * \param objNum The object number
+  * \param object The object to be cached
+  * \param size The estimated memory size of the object
+  */
+  void Add(long objNum, wxPdfObject* object, size_t size);
+
+  /// Remove an object from the cache without deleting it
+  /**
+  * The caller takes ownership of the object and may add it again after use,
+  * which marks it as most recently used.
+  * \param objNum The object number
+  * \return The cached object, or NULL if the object is not in the cache
+  */
+  wxPdfObject* Detach(long objNum);
+
+  /// Delete all cached objects
+  void Clear();
+
+private:
+  /// Unlink an entry from the usage list
+  void Unlink(wxPdfObjectCacheEntry* entry);
+
+  /// Delete least recently used objects until the budget is met
+  void Shrink();
+
+  size_t                 m_maxSize; ///< Byte budget
+  size_t                 m_size;    ///< Total size of cached objects
+  wxPdfObjectCacheMap    m_entries; ///< Map of cache entries
+  wxPdfObjectCacheEntry* m_first;   ///< Most recently used entry
+  wxPdfObjectCacheEntry* m_last;    ///< Least recently used entry
+};
+
 /// Class representing a PDF parser. (For internal use only)
 /**
 * The parser uses a tokenizer to read the PDF file, identifies all indirect objects
@@ -294,6 +410,12 @@ public:
   */
   void AppendObject(int originalObjectId, int actualObjectId, wxPdfObject* obj);
 
+  /// Remove all referenced objects from the queue
+  /**
+  * Used when the objects are written to a new destination document.
+  */
+  void ClearObjectQueue();
+
   /// Get the resources of a specific page
   /**
   * \param pageno The page number (1-based)
@@ -370,6 +492,26 @@ public:
   */
   bool GetUseRawStream() const { return m_useRawStream; }
 
+  /// Load the content of a stream object
+  /**
+  * Stream data are not read while parsing an object, but on demand.
+  * Depending on the raw stream flag the data are decoded or not.
+  * \param stream The stream object
+  */
+  void GetStreamBytes(wxPdfStream* stream);
+
+  /// Set the byte budget of the cache for decoded object streams
+  /**
+  * \param maxSize The byte budget, 0 disables caching
+  */
+  void SetObjectCacheSize(size_t maxSize);
+
+  /// Get the byte budget of the cache for decoded object streams
+  /**
+  * \return The byte budget
+  */
+  size_t GetObjectCacheSize() const { return m_objStmCache->GetMaxSize(); }
+
 protected:
   /// Get the resources of a specific page identified by a page object
   wxPdfObject* GetPageResources(wxPdfObject* page);
@@ -419,9 +561,6 @@ protected:
   /// Parse an object from an object stream
   wxPdfObject* ParseObjectStream(wxPdfStream* stream, int idx);
 
-  /// Parse the content of a stream object
-  void GetStreamBytes(wxPdfStream* stream);
-
   /// Parse the raw content of a stream object
   void GetStreamBytesRaw(wxPdfStream* stream);
 
@@ -469,6 +608,7 @@ private:
   wxString          m_password;        ///<
   wxString          m_pdfVersion;      ///< Version of PDF document
   wxFSFile*         m_pdfFile;         ///< File system file object of PDF document
+  wxPdfMappedFile*  m_mappedFile;      ///< Memory mapped PDF document
   wxPdfTokenizer*   m_tokens;          ///< Tokenizer
   wxPdfDictionary*  m_trailer;         ///< Trailer dictionary
   wxPdfDictionary*  m_root;            ///< Root object
@@ -483,7 +623,7 @@ private:
   wxPdfObjectQueue* m_objectQueue;     ///< Queue of referenced objects
   wxPdfObjectQueue* m_objectQueueLast; ///< Pointer to last queue element
   wxPdfObjectMap*   m_objectMap;       ///< Map for object queue elements
-  wxPdfObjStmMap*   m_objStmCache;     ///< Cache for object streams
+  wxPdfObjectCache* m_objStmCache;     ///< Cache for decoded object streams
   bool              m_cacheObjects;    ///< Flag whether object streams should be cached
 
   int               m_objNum;          ///< Number of current object
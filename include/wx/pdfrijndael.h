@@ -7,7 +7,7 @@
 // Licence:     wxWindows licence
 //
 // Class renamed to wxPdfRijndael for use in wxPdfDocument (U. Telle)
-// Otherwise the code is unchanged
+// Added reuse of the expanded key and support for AES instructions of the CPU
 ///////////////////////////////////////////////////////////////////////////////
 
 /// \file pdfrijndael.h Interface of the Rijndael cipher
@@ -122,6 +122,12 @@ protected:
   UINT8     m_initVector[MAX_IV_SIZE];
   UINT32    m_uRounds;
   UINT8     m_expandedKey[_MAX_ROUNDS+1][4][4];
+  // Key and direction of the expanded key, to skip the key schedule if init() is called with the same key
+  UINT8     m_key[32];
+  UINT32    m_keyLenInBytes;
+  Direction m_keyDirection;
+  // Use AES instructions of the CPU
+  bool      m_hardware;
 public:
   //////////////////////////////////////////////////////////////////////////////////////////
   // API
@@ -166,6 +172,16 @@ public:
   // outBuffer must be at least inputLen bytes long
   // Returns the decrypted buffer length in BYTES and an error code < 0 in case of error
   int padDecrypt(const UINT8 *input, int inputOctets, UINT8 *outBuffer);
+
+  // Checks whether the CPU provides AES instructions (AES-NI or ARMv8 Cryptography Extensions)
+  // Blocks are then encrypted and decrypted using these instructions instead of the lookup tables.
+  // Define WXPDF_NO_HARDWARE_AES to always use the lookup tables.
+  static bool hasHardwareSupport();
+  // Enables or disables the use of the AES instructions for cipher objects created afterwards
+  // (enabled by default). Disabling them allows to compare the lookup tables with the instructions.
+  static void setHardwareEnabled(bool enable);
+  // Checks whether the use of the AES instructions is enabled
+  static bool isHardwareEnabled();
 protected:
   void keySched(UINT8 key[_MAX_KEY_COLUMNS][4]);
   void keyEncToDec();
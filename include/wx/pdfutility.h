@@ -20,6 +20,9 @@
 #include "wx/pdfdocdef.h"
 #include "wx/pdfproperties.h"
 
+/// Minimal size of a character buffer passed to wxPdfUtility::Double2Ascii
+#define wxPDF_DOUBLE_BUFFER_SIZE 32
+
 /// Class implementing several static utility methods
 class WXDLLIMPEXP_PDFDOC wxPdfUtility
 {
@@ -39,6 +42,19 @@ public:
   */
   static wxString Double2String(double value, int precision = 0);
 
+  /// Formats a floating point number with a fixed precision into a character buffer
+  /**
+  * The result is identical to that of Double2String, but no memory is allocated.
+  * Only values whose scaled magnitude is below 2^52 and precisions up to 9 are supported.
+  * \param value the value to be formatted
+  * \param precision the number of decimal places
+  * \param buffer the character buffer receiving the result, it must have room
+  * for at least wxPDF_DOUBLE_BUFFER_SIZE characters
+  * \return the number of characters written to the buffer,
+  * 0 if the value can't be formatted by this method
+  */
+  static size_t Double2Ascii(double value, int precision, char* buffer);
+
   /// Parses a floating point number
   /**
   * \param str the string to be parsed
@@ -150,4 +166,73 @@ private:
   static int  ms_s2;      ///< Random number generator seed 2
 };
 
+/// Class representing a read-only memory mapped file (For internal use only)
+/**
+* The content of the file is accessible as a contiguous block of memory
+* without copying it. Memory mapping is supported on Windows and Unix-like systems;
+* on other platforms opening a file always fails.
+*/
+class WXDLLIMPEXP_PDFDOC wxPdfMappedFile
+{
+public:
+  /// Default constructor
+  wxPdfMappedFile();
+
+  /// Destructor
+  virtual ~wxPdfMappedFile();
+
+  /// Map a file into memory
+  /**
+  * \param fileName the name of the file to be mapped
+  * \return @c true if the file could be mapped, @c false otherwise
+  */
+  bool Open(const wxString& fileName);
+
+  /// Release the mapping of the file
+  void Close();
+
+  /// Check whether a file is mapped
+  /**
+  * \return @c true if a file is mapped, @c false otherwise
+  */
+  bool IsOk() const { return m_data != NULL; }
+
+  /// Get the content of the mapped file
+  /**
+  * \return pointer to the first byte of the file
+  */
+  const char* GetData() const { return m_data; }
+
+  /// Get the length of the mapped file
+  /**
+  * \return the length of the file in bytes
+  */
+  size_t GetLength() const { return m_length; }
+
+  /// Get a mapping of a file shared within the process
+  /**
+  * Each file is mapped only once, the mapping is reference counted and
+  * has to be released by calling Release(). This method is thread-safe.
+  * \param fileName the name of the file to be mapped
+  * \return the shared mapping, or NULL if the file could not be mapped
+  */
+  static wxPdfMappedFile* Acquire(const wxString& fileName);
+
+  /// Release a mapping obtained by Acquire()
+  /**
+  * The file is unmapped when the last reference is released.
+  * \param mappedFile the shared mapping
+  */
+  static void Release(wxPdfMappedFile* mappedFile);
+
+private:
+  const char* m_data;         ///< start of the mapped file content
+  size_t      m_length;       ///< length of the mapped file content
+  wxString    m_sharedName;   ///< name of the file, if the mapping is shared
+  int         m_refCount;     ///< number of references to a shared mapping
+#ifdef __WXMSW__
+  void*       m_mapping;      ///< handle of the file mapping object
+#endif
+};
+
 #endif
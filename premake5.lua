@@ -94,6 +94,33 @@ project "minimal"
   characterset "Unicode"
   links { "wxpdfdoc" }
   
+-- Benchmark program
+project "benchmark"
+  location(BUILDDIR)
+  language "C++"
+  cppdialect "C++11"
+  kind "ConsoleApp"
+
+  if (is_msvc) then
+    local prj = project()
+    prj.filename = "wxpdfdoc_" .. vc_with_ver .. "_benchmark"
+  end
+  if wxMonolithic then
+    local prj = project()
+    prj.filename = "benchmark_mono"
+  end
+
+  use_filters( "PDFDOC", "samples/benchmark", "core,xml" )
+
+  files { "samples/benchmark/*.cpp", "samples/benchmark/*.h" }
+  vpaths {
+    ["Header Files"] = { "**.h" },
+    ["Source Files"] = { "**.cpp" }
+  }
+  includedirs { "samples/benchmark", "include" }
+  characterset "Unicode"
+  links { "wxpdfdoc" }
+
 -- wxPdfDC sample
 project "dcsample"
   location(BUILDDIR)
@@ -0,0 +1,137 @@
+///////////////////////////////////////////////////////////////////////////////
+// Name:        benchmark.cpp
+// Purpose:     Benchmark program for performance critical parts of wxPdfDocument
+// Author:      Ulrich Telle
+// Created:     2026-10-17
+// Copyright:   (c) Ulrich Telle
+// Licence:     wxWindows licence
+///////////////////////////////////////////////////////////////////////////////
+
+// For compilers that support precompilation, includes "wx/wx.h".
+#include "wx/wxprec.h"
+
+#ifdef __BORLANDC__
+#pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+#include "wx/wx.h"
+#endif
+
+#include <wx/cmdline.h>
+
+#include "wx/pdfdoc.h"
+#include "wx/pdffontmanager.h"
+
+#include "benchmark.h"
+
+// Each benchmark returns the number of failed consistency checks
+static const wxPdfBenchmarkEntry gs_benchmarks[] =
+{
+  { "numformat", "Number formatting for content stream operators", BenchmarkNumberFormatting },
+  { "fontmanager", "Font manager lookups from concurrent threads", BenchmarkFontManager },
+  { "encryption", "Stream encryption of the revisions 2 to 6", BenchmarkEncryption },
+  { NULL, NULL, NULL }
+};
+
+wxString
+FormatThroughput(double count, wxLongLong micros, const wxString& unit)
+{
+  double seconds = micros.ToDouble() / 1e6;
+  if (seconds <= 0)
+  {
+    seconds = 1e-6;
+  }
+  return wxString::Format(wxS("%10.3f s %14.0f %s/s"), seconds, count / seconds, unit);
+}
+
+class PdfDocBenchmark : public wxAppConsole
+{
+public:
+  bool OnInit();
+  int OnRun();
+
+  wxString m_selection;
+  wxString m_fontDirectory;
+  long     m_scale;
+  bool     m_list;
+  int      m_rc;
+};
+
+static const wxCmdLineEntryDesc cmdLineDesc[] =
+{
+  { wxCMD_LINE_OPTION, "b", "benchmark", "Benchmark to run (default: all)",        wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL },
+  { wxCMD_LINE_OPTION, "n", "scale",     "Workload scale factor (default: 1)",      wxCMD_LINE_VAL_NUMBER, wxCMD_LINE_PARAM_OPTIONAL },
+  { wxCMD_LINE_OPTION, "f", "fontdir",   "wxPdfDocument font directory",            wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL },
+  { wxCMD_LINE_SWITCH, "l", "list",      "List the available benchmarks",           wxCMD_LINE_VAL_NONE,   wxCMD_LINE_PARAM_OPTIONAL },
+  { wxCMD_LINE_SWITCH, "h", "help",      "Display help",                            wxCMD_LINE_VAL_NONE,   wxCMD_LINE_OPTION_HELP },
+  { wxCMD_LINE_NONE, NULL, NULL, NULL, wxCMD_LINE_VAL_NONE, 0 }
+};
+
+bool
+PdfDocBenchmark::OnInit()
+{
+  wxCmdLineParser parser(cmdLineDesc, argc, argv);
+  parser.SetLogo(wxS("wxPdfDocument Benchmark\n"));
+  m_rc = 0;
+  m_scale = 1;
+  if (parser.Parse() != 0)
+  {
+    m_rc = -1;
+    return false;
+  }
+
+  m_list = parser.Found(wxS("list"));
+  parser.Found(wxS("benchmark"), &m_selection);
+  parser.Found(wxS("scale"), &m_scale);
+  if (m_scale < 1)
+  {
+    m_scale = 1;
+  }
+  if (!parser.Found(wxS("fontdir"), &m_fontDirectory))
+  {
+    m_fontDirectory = wxS("../../lib/fonts");
+  }
+  wxPdfFontManager::GetFontManager()->AddSearchPath(m_fontDirectory);
+  return true;
+}
+
+int
+PdfDocBenchmark::OnRun()
+{
+  const wxPdfBenchmarkEntry* entry;
+  if (m_list)
+  {
+    for (entry = gs_benchmarks; entry->m_name != NULL; ++entry)
+    {
+      wxPrintf(wxS("%-12s %s\n"), entry->m_name, entry->m_description);
+    }
+    return m_rc;
+  }
+
+  int failed = 0;
+  bool found = false;
+  for (entry = gs_benchmarks; entry->m_name != NULL; ++entry)
+  {
+    if (m_selection.IsEmpty() || m_selection.IsSameAs(entry->m_name))
+    {
+      found = true;
+      wxPrintf(wxS("*** %s ***\n"), entry->m_description);
+      failed += entry->m_function(m_scale);
+      wxPrintf(wxS("\n"));
+    }
+  }
+  if (!found)
+  {
+    wxLogError(wxS("Unknown benchmark '%s'."), m_selection.c_str());
+    m_rc = -2;
+  }
+  else if (failed > 0)
+  {
+    wxLogError(wxS("%d consistency check(s) failed."), failed);
+    m_rc = 1;
+  }
+  return m_rc;
+}
+
+IMPLEMENT_APP_CONSOLE(PdfDocBenchmark)
@@ -0,0 +1,38 @@
+///////////////////////////////////////////////////////////////////////////////
+// Name:        benchmark.h
+// Purpose:     Declarations shared by the wxPdfDocument benchmarks
+// Author:      Ulrich Telle
+// Created:     2026-10-17
+// Copyright:   (c) Ulrich Telle
+// Licence:     wxWindows licence
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _PDF_BENCHMARK_H_
+#define _PDF_BENCHMARK_H_
+
+#include <wx/longlong.h>
+#include <wx/string.h>
+
+/// Signature of a benchmark function
+/**
+* \param scale workload scale factor given on the command line
+* \return the number of failed consistency checks
+*/
+typedef int (*wxPdfBenchmarkFunction)(long scale);
+
+/// Description of a benchmark
+struct wxPdfBenchmarkEntry
+{
+  const char*            m_name;        ///< Name used to select the benchmark
+  const char*            m_description; ///< Description shown in the output
+  wxPdfBenchmarkFunction m_function;    ///< Benchmark function
+};
+
+/// Format the elapsed time and the number of processed items per second
+wxString FormatThroughput(double count, wxLongLong micros, const wxString& unit);
+
+int BenchmarkNumberFormatting(long scale);
+int BenchmarkFontManager(long scale);
+int BenchmarkEncryption(long scale);
+
+#endif
@@ -0,0 +1,222 @@
+///////////////////////////////////////////////////////////////////////////////
+// Name:        encryption.cpp
+// Purpose:     Throughput benchmark of the encryption methods
+// Author:      Ulrich Telle
+// Created:     2026-10-17
+// Copyright:   (c) Ulrich Telle
+// Licence:     wxWindows licence
+///////////////////////////////////////////////////////////////////////////////
+
+// For compilers that support precompilation, includes "wx/wx.h".
+#include "wx/wxprec.h"
+
+#ifdef __BORLANDC__
+#pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+#include "wx/wx.h"
+#endif
+
+#include <wx/stopwatch.h>
+
+#include <string.h>
+#include <vector>
+
+#include "wx/pdfdoc.h"
+#include "wx/pdfencrypt.h"
+#include "wx/pdfrijndael.h"
+
+#include "benchmark.h"
+
+/**
+* Measures the stream encryption of the revisions 2 to 6 of the standard security
+* handler, as wxPdfDocument::PutStream uses it: each stream is copied to a buffer
+* with room for the initialization vector and the padding and encrypted in place.
+* The AES based revisions are measured with the AES instructions of the CPU
+* (AES-NI or ARMv8 Cryptography Extensions), if available, and with the lookup tables.
+* Each run decrypts the streams again and compares them with the original data.
+* Finally the raw cipher is checked with the FIPS-197 example vectors, and both
+* implementations must produce the same CBC ciphertext.
+*/
+
+static const size_t gs_streamSize = 64 * 1024;
+
+static void
+FillStream(std::vector<unsigned char>& data)
+{
+  wxUint32 seed = 4711;
+  size_t j;
+  for (j = 0; j < data.size(); ++j)
+  {
+    seed = seed * 1103515245 + 12345;
+    data[j] = (unsigned char) (seed >> 16);
+  }
+}
+
+static int
+RunEncryption(const wxString& name, int revision, int keyLength,
+              const std::vector<unsigned char>& plain, size_t streams)
+{
+  wxPdfEncrypt encryptor(revision, keyLength);
+  encryptor.GenerateEncryptionKey(wxS("user"), wxS("owner"), wxPDF_PERMISSION_PRINT | wxPDF_PERMISSION_COPY,
+                                  wxPdfEncrypt::CreateDocumentId());
+
+  size_t len = plain.size();
+  size_t lenbuf = encryptor.CalculateStreamLength(len);
+  size_t ofs = encryptor.CalculateStreamOffset();
+  std::vector<unsigned char> buffer(lenbuf);
+  int failures = 0;
+  size_t j;
+
+  wxStopWatch sw;
+  for (j = 0; j < streams; ++j)
+  {
+    memcpy(&buffer[ofs], &plain[0], len);
+    encryptor.Encrypt((int) j + 1, 0, &buffer[0], (unsigned int) len);
+  }
+  wxLongLong elapsed = sw.TimeInMicro();
+
+  // Decrypt the last stream to check the round trip
+  int realLen = encryptor.Decrypt((int) streams, 0, &buffer[0], (unsigned int) ((revision >= 4) ? lenbuf : len));
+  if (realLen != (int) len || memcmp(&buffer[ofs], &plain[0], len) != 0)
+  {
+    wxPrintf(wxS("FAILED: %s did not restore the original stream\n"), name);
+    ++failures;
+  }
+
+  wxPrintf(wxS("%-26s %s\n"), name, FormatThroughput((double) (len * streams) / (1024 * 1024), elapsed, wxS("MB")));
+  return failures;
+}
+
+static int
+CheckCipher()
+{
+  // FIPS-197, appendix C.1 and C.3
+  static const UINT8 plain[16] =
+  {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+  };
+  static const UINT8 expected128[16] =
+  {
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+  };
+  static const UINT8 expected256[16] =
+  {
+    0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf, 0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89
+  };
+  UINT8 key[32];
+  UINT8 iv[16];
+  UINT8 out[16];
+  int failures = 0;
+  int j;
+  for (j = 0; j < 32; ++j)
+  {
+    key[j] = (UINT8) j;
+  }
+  for (j = 0; j < 16; ++j)
+  {
+    iv[j] = (UINT8) (0xa5 ^ j);
+  }
+
+  std::vector<unsigned char> data(gs_streamSize);
+  FillStream(data);
+  std::vector<unsigned char> cipher[2];
+  bool hardware = wxPdfRijndael::hasHardwareSupport();
+  bool enabled = wxPdfRijndael::isHardwareEnabled();
+  int pass;
+  for (pass = 0; pass < 2; ++pass)
+  {
+    wxPdfRijndael::setHardwareEnabled(pass == 0);
+    const wxChar* path = (pass == 0 && hardware) ? wxS("instructions") : wxS("lookup tables");
+    {
+      wxPdfRijndael aes;
+      aes.init(wxPdfRijndael::ECB, wxPdfRijndael::Encrypt, key, wxPdfRijndael::Key16Bytes);
+      aes.blockEncrypt(plain, 16, out);
+      if (memcmp(out, expected128, 16) != 0)
+      {
+        wxPrintf(wxS("FAILED: AES-128 with %s does not match FIPS-197\n"), path);
+        ++failures;
+      }
+      aes.init(wxPdfRijndael::ECB, wxPdfRijndael::Encrypt, key, wxPdfRijndael::Key32Bytes);
+      aes.blockEncrypt(plain, 16, out);
+      if (memcmp(out, expected256, 16) != 0)
+      {
+        wxPrintf(wxS("FAILED: AES-256 with %s does not match FIPS-197\n"), path);
+        ++failures;
+      }
+      aes.init(wxPdfRijndael::ECB, wxPdfRijndael::Decrypt, key, wxPdfRijndael::Key32Bytes);
+      aes.blockDecrypt(expected256, 16, out);
+      if (memcmp(out, plain, 16) != 0)
+      {
+        wxPrintf(wxS("FAILED: AES-256 decryption with %s does not match FIPS-197\n"), path);
+        ++failures;
+      }
+    }
+    {
+      wxPdfRijndael aes;
+      cipher[pass].resize(data.size() + 16);
+      aes.init(wxPdfRijndael::CBC, wxPdfRijndael::Encrypt, key, wxPdfRijndael::Key32Bytes, iv);
+      int len = aes.padEncrypt(&data[0], (int) data.size(), &cipher[pass][0]);
+      cipher[pass].resize((len > 0) ? len : 0);
+    }
+  }
+  wxPdfRijndael::setHardwareEnabled(enabled);
+
+  if (cipher[0].empty() || cipher[0] != cipher[1])
+  {
+    wxPrintf(wxS("FAILED: AES instructions and lookup tables produce different ciphertext\n"));
+    ++failures;
+  }
+  return failures;
+}
+
+int
+BenchmarkEncryption(long scale)
+{
+  static const struct
+  {
+    const wxChar* m_name;
+    int           m_revision;
+    int           m_keyLength;
+    bool          m_aes;
+  } modes[] =
+  {
+    { wxS("R2 RC4 40 bit"),    2,  40, false },
+    { wxS("R3 RC4 128 bit"),   3, 128, false },
+    { wxS("R4 AES 128 bit"),   4, 128, true },
+    { wxS("R5 AES 256 bit"),   5, 256, true },
+    { wxS("R6 AES 256 bit"),   6, 256, true }
+  };
+
+  std::vector<unsigned char> plain(gs_streamSize);
+  FillStream(plain);
+  // 256 MB per mode
+  size_t streams = 4096 * (size_t) scale;
+  bool hardware = wxPdfRijndael::hasHardwareSupport();
+  bool enabled = wxPdfRijndael::isHardwareEnabled();
+  int failed = 0;
+  size_t j;
+
+  wxPrintf(wxS("AES instructions: %s\n"), hardware ? wxS("available") : wxS("not available"));
+  for (j = 0; j < WXSIZEOF(modes); ++j)
+  {
+    if (modes[j].m_aes && hardware)
+    {
+      wxPdfRijndael::setHardwareEnabled(true);
+      failed += RunEncryption(wxString(modes[j].m_name) + wxS(" (instructions)"),
+                              modes[j].m_revision, modes[j].m_keyLength, plain, streams);
+      wxPdfRijndael::setHardwareEnabled(false);
+      failed += RunEncryption(wxString(modes[j].m_name) + wxS(" (tables)"),
+                              modes[j].m_revision, modes[j].m_keyLength, plain, streams);
+      wxPdfRijndael::setHardwareEnabled(enabled);
+    }
+    else
+    {
+      failed += RunEncryption(modes[j].m_name, modes[j].m_revision, modes[j].m_keyLength, plain, streams);
+    }
+  }
+
+  failed += CheckCipher();
+  return failed;
+}
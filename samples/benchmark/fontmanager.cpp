@@ -0,0 +1,192 @@
+///////////////////////////////////////////////////////////////////////////////
+// Name:        fontmanager.cpp
+// Purpose:     Contention benchmark of the font manager lookups
+// Author:      Ulrich Telle
+// Created:     2026-10-17
+// Copyright:   (c) Ulrich Telle
+// Licence:     wxWindows licence
+///////////////////////////////////////////////////////////////////////////////
+
+// For compilers that support precompilation, includes "wx/wx.h".
+#include "wx/wxprec.h"
+
+#ifdef __BORLANDC__
+#pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+#include "wx/wx.h"
+#endif
+
+#include <wx/stopwatch.h>
+#include <wx/thread.h>
+
+#include <atomic>
+#include <vector>
+
+#include "wx/pdfdoc.h"
+#include "wx/pdffontmanager.h"
+
+#include "benchmark.h"
+
+/**
+* Measures the throughput of font manager lookups with 1 to 32 threads, as in a
+* renderer whose worker threads build documents concurrently. Each lookup copies
+* the resulting wxPdfFont, so the reference counting of the font data is included.
+* The second run adds a thread which toggles the default embedding and subsetting
+* modes all the time. Each run checks that every lookup found its font.
+*/
+
+#if wxUSE_THREADS
+
+class FontLookupThread : public wxThread
+{
+public:
+  FontLookupThread(long iterations, std::atomic<long>& failures)
+    : wxThread(wxTHREAD_JOINABLE), m_iterations(iterations), m_failures(failures)
+  {
+  }
+
+protected:
+  virtual ExitCode Entry()
+  {
+    static const wxStringCharType* families[] = { wxS("Helvetica"), wxS("Times"), wxS("Courier") };
+    static const int styles[] = { wxPDF_FONTSTYLE_REGULAR, wxPDF_FONTSTYLE_BOLD,
+                                  wxPDF_FONTSTYLE_ITALIC, wxPDF_FONTSTYLE_BOLDITALIC };
+    wxPdfFontManager* fontManager = wxPdfFontManager::GetFontManager();
+    long failures = 0;
+    long j;
+    for (j = 0; j < m_iterations; ++j)
+    {
+      wxPdfFont font = fontManager->GetFont(families[j % 3], styles[j % 4]);
+      if (!font.IsValid())
+      {
+        ++failures;
+      }
+      if (fontManager->GetEncoding(wxS("winansi")) == NULL)
+      {
+        ++failures;
+      }
+    }
+    m_failures += failures;
+    return 0;
+  }
+
+private:
+  long               m_iterations;
+  std::atomic<long>& m_failures;
+};
+
+class FontSettingsThread : public wxThread
+{
+public:
+  FontSettingsThread(std::atomic<bool>& stop)
+    : wxThread(wxTHREAD_JOINABLE), m_stop(stop)
+  {
+  }
+
+protected:
+  virtual ExitCode Entry()
+  {
+    wxPdfFontManager* fontManager = wxPdfFontManager::GetFontManager();
+    bool embed = fontManager->GetDefaultEmbed();
+    bool subset = fontManager->GetDefaultSubset();
+    long toggle = 0;
+    while (!m_stop)
+    {
+      fontManager->SetDefaultEmbed((toggle & 1) == 0);
+      fontManager->SetDefaultSubset((toggle & 2) == 0);
+      ++toggle;
+    }
+    fontManager->SetDefaultEmbed(embed);
+    fontManager->SetDefaultSubset(subset);
+    return 0;
+  }
+
+private:
+  std::atomic<bool>& m_stop;
+};
+
+static int
+RunFontLookups(int numThreads, long iterations, bool withSettings)
+{
+  std::atomic<long> failures(0);
+  std::atomic<bool> stop(false);
+  std::vector<FontLookupThread*> threads;
+  FontSettingsThread* settings = NULL;
+  int j;
+
+  if (withSettings)
+  {
+    settings = new FontSettingsThread(stop);
+    settings->Run();
+  }
+  wxStopWatch sw;
+  for (j = 0; j < numThreads; ++j)
+  {
+    FontLookupThread* thread = new FontLookupThread(iterations, failures);
+    if (thread->Run() == wxTHREAD_NO_ERROR)
+    {
+      threads.push_back(thread);
+    }
+    else
+    {
+      delete thread;
+    }
+  }
+  for (j = 0; j < (int) threads.size(); ++j)
+  {
+    threads[j]->Wait();
+    delete threads[j];
+  }
+  wxLongLong elapsed = sw.TimeInMicro();
+  if (settings != NULL)
+  {
+    stop = true;
+    settings->Wait();
+    delete settings;
+  }
+
+  // Each iteration performs two lookups
+  double lookups = 2.0 * iterations * threads.size();
+  wxPrintf(wxS("%2d thread(s)%s %s\n"), (int) threads.size(),
+           withSettings ? wxS(" + settings") : wxS("           "),
+           FormatThroughput(lookups, elapsed, wxS("lookups")));
+  if (failures > 0)
+  {
+    wxPrintf(wxS("FAILED: %ld lookup(s) found no font or encoding\n"), (long) failures);
+  }
+  return (failures > 0 || (int) threads.size() != numThreads) ? 1 : 0;
+}
+
+int
+BenchmarkFontManager(long scale)
+{
+  static const int threadCounts[] = { 1, 2, 4, 8, 16, 32 };
+  long iterations = 200000 * scale;
+  int failed = 0;
+  size_t j;
+
+  wxPrintf(wxS("Hardware threads: %d\n"), wxThread::GetCPUCount());
+  for (j = 0; j < WXSIZEOF(threadCounts); ++j)
+  {
+    failed += RunFontLookups(threadCounts[j], iterations, false);
+  }
+  for (j = 0; j < WXSIZEOF(threadCounts); ++j)
+  {
+    failed += RunFontLookups(threadCounts[j], iterations, true);
+  }
+  return failed;
+}
+
+#else
+
+int
+BenchmarkFontManager(long scale)
+{
+  wxUnusedVar(scale);
+  wxPrintf(wxS("Skipped: wxWidgets was built without thread support.\n"));
+  return 0;
+}
+
+#endif
@@ -0,0 +1,138 @@
+///////////////////////////////////////////////////////////////////////////////
+// Name:        numformat.cpp
+// Purpose:     Benchmark of the number formatting for content stream operators
+// Author:      Ulrich Telle
+// Created:     2026-10-17
+// Copyright:   (c) Ulrich Telle
+// Licence:     wxWindows licence
+///////////////////////////////////////////////////////////////////////////////
+
+// For compilers that support precompilation, includes "wx/wx.h".
+#include "wx/wxprec.h"
+
+#ifdef __BORLANDC__
+#pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+#include "wx/wx.h"
+#endif
+
+#include <wx/mstream.h>
+#include <wx/stopwatch.h>
+
+#include <vector>
+
+#include "wx/pdfdoc.h"
+#include "wx/pdfutility.h"
+
+#include "benchmark.h"
+
+/**
+* Compares the allocation-free formatter wxPdfUtility::Double2Ascii with the
+* former path of the Out* methods: wxPdfUtility::Double2String, which calls
+* wxString::FromCDouble, concatenation of temporary strings and conversion
+* back with ToAscii. Both variants produce "x y l" line operators for the
+* same coordinates; the generated streams must be identical.
+* Finally Line() is timed on a real document.
+*/
+
+static void
+LegacyLineTo(wxMemoryOutputStream& out, double x, double y)
+{
+  wxString s = wxPdfUtility::Double2String(x, 2) + wxString(wxS(" ")) +
+               wxPdfUtility::Double2String(y, 2) + wxString(wxS(" l"));
+  const wxCharBuffer ascii = s.ToAscii();
+  out.Write((const char*) ascii, strlen(ascii));
+  out.Write("\n", 1);
+}
+
+static void
+DirectLineTo(wxMemoryOutputStream& out, double x, double y)
+{
+  char buffer[2 * wxPDF_DOUBLE_BUFFER_SIZE + 4];
+  size_t len = wxPdfUtility::Double2Ascii(x, 2, buffer);
+  buffer[len++] = ' ';
+  len += wxPdfUtility::Double2Ascii(y, 2, buffer + len);
+  buffer[len++] = ' ';
+  buffer[len++] = 'l';
+  buffer[len++] = '\n';
+  out.Write(buffer, len);
+}
+
+static bool
+SameContent(wxMemoryOutputStream& a, wxMemoryOutputStream& b)
+{
+  wxStreamBuffer* bufA = a.GetOutputStreamBuffer();
+  wxStreamBuffer* bufB = b.GetOutputStreamBuffer();
+  size_t lenA = (size_t) a.TellO();
+  size_t lenB = (size_t) b.TellO();
+  return lenA == lenB && memcmp(bufA->GetBufferStart(), bufB->GetBufferStart(), lenA) == 0;
+}
+
+int
+BenchmarkNumberFormatting(long scale)
+{
+  int failed = 0;
+  size_t count = 1000000 * (size_t) scale;
+
+  // Chart-like coordinates with a random fraction, including negative values
+  // and values close to the rounding boundaries
+  std::vector<double> values(2 * count);
+  wxUint32 seed = 12345;
+  size_t j;
+  for (j = 0; j < values.size(); ++j)
+  {
+    seed = seed * 1103515245 + 12345;
+    double v = (seed >> 8) / 16777216.0 * 1200.0 - 300.0;
+    if (j % 7 == 0)
+    {
+      v = (double) ((long) (v * 100)) / 100 + 0.005;
+    }
+    values[j] = v;
+  }
+
+  wxMemoryOutputStream legacyOut;
+  wxMemoryOutputStream directOut;
+
+  wxStopWatch sw;
+  for (j = 0; j < count; ++j)
+  {
+    LegacyLineTo(legacyOut, values[2*j], values[2*j+1]);
+  }
+  wxLongLong legacyTime = sw.TimeInMicro();
+
+  sw.Start();
+  for (j = 0; j < count; ++j)
+  {
+    DirectLineTo(directOut, values[2*j], values[2*j+1]);
+  }
+  wxLongLong directTime = sw.TimeInMicro();
+
+  wxPrintf(wxS("Double2String + ToAscii %s\n"), FormatThroughput((double) count, legacyTime, wxS("ops")));
+  wxPrintf(wxS("Double2Ascii            %s\n"), FormatThroughput((double) count, directTime, wxS("ops")));
+  if (directTime > 0)
+  {
+    wxPrintf(wxS("Speedup                 %10.2fx\n"), legacyTime.ToDouble() / directTime.ToDouble());
+  }
+
+  if (!SameContent(legacyOut, directOut))
+  {
+    wxPrintf(wxS("FAILED: the formatters produced different output\n"));
+    ++failed;
+  }
+
+  // Line() on a document, uncompressed to time the formatting only
+  wxPdfDocument pdf;
+  pdf.SetCompression(false);
+  pdf.AddPage();
+  sw.Start();
+  for (j = 0; j < count; ++j)
+  {
+    pdf.Line(values[2*j] / 5, values[2*j+1] / 5, values[2*j+1] / 5, values[2*j] / 5);
+  }
+  wxLongLong lineTime = sw.TimeInMicro();
+  wxPrintf(wxS("wxPdfDocument::Line     %s\n"), FormatThroughput((double) count, lineTime, wxS("ops")));
+
+  return failed;
+}
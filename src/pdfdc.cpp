@@ -1469,29 +1469,25 @@ wxPdfDCImpl::DoGetPartialTextExtents(const wxString& text, wxArrayInt& widths) c
 {
   wxCHECK_MSG( m_pdfDocument, false, wxS("wxPdfDCImpl::DoGetPartialTextExtents - invalid DC") );
 
-  /// very slow - but correct ??
-
   const size_t len = text.length();
   if (len == 0)
   {
     return true;
   }
 
-  widths.Empty();
-  widths.Add(0, len);
-  int w, h;
-
-  wxString buffer;
-  buffer.Alloc(len);
+  // Measure all characters in a single pass instead of measuring each prefix
+  const_cast<wxPdfDCImpl*>(this)->SetFont(m_font);
+  wxPdfArrayDouble advances;
+  m_pdfDocument->GetCharAdvances(text, advances);
 
+  widths.Empty();
+  widths.Alloc(len);
+  double w = 0;
   for ( size_t i = 0; i < len; ++i )
   {
-    buffer.Append(text.Mid( i, 1));
-    DoGetTextExtent(buffer, &w, &h);
-    widths[i] = w;
+    w += advances[i];
+    widths.Add(ScalePdfToFontMetric(w));
   }
-
-  buffer.Clear();
   return true;
 }
 
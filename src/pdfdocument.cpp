@@ -31,6 +31,7 @@
 #include <wx/paper.h>
 #include <wx/wfstream.h>
 
+#include "wx/pdfannotation.h"
 #include "wx/pdfbookmark.h"
 #include "wx/pdfdocument.h"
 #include "wx/pdffont.h"
@@ -151,12 +152,25 @@ wxPdfDocument::Initialize(int orientation)
   m_offsets = new wxPdfOffsetHashMap();
 
   m_pages = new wxPdfPageHashMap();
+  m_streaming = false;
+  m_pageObjIds = new wxPdfObjIdHashMap();
+  m_contentObjIds = new wxPdfObjIdHashMap();
+  m_aliasNbPagesPositions = new wxPdfAliasPositionsMap();
+  m_aliasNbPagesScan = 0;
+  m_compactOutput = false;
+  m_objBuffer = NULL;
+  m_objOutput = NULL;
+  m_objId = 0;
+  m_objHasStream = false;
+  m_objStmIndex = new wxPdfObjIdHashMap();
   m_pageSizes = new wxPdfPageSizeMap();
   m_orientationChanges = new wxPdfBoolHashMap();
 
   m_state            = 0;
   m_fonts            = new wxPdfFontHashMap();
+  m_textRuns         = new wxPdfTextRunMap();
   m_images           = new wxPdfImageHashMap();
+  m_imageDigests     = new wxPdfImageHashMap();
   m_pageLinks        = new wxPdfPageLinksMap();
   m_links            = new wxPdfLinkHashMap();
   m_namedLinks       = new wxPdfNamedLinksMap();
@@ -261,6 +275,16 @@ wxPdfDocument::Initialize(int orientation)
 
   // Enable compression
   SetCompression(true);
+  m_compressionThreads = 1;
+  m_compressionTimeSaved = 0;
+  m_imageDeflateLevel = -1;
+  m_imagePredictors = true;
+  m_deferredImageLoading = false;
+  m_writeError = false;
+  m_imageTargetDpi = 0;
+  m_imageMaxPixels = 0;
+  m_imageJpegQuality = 85;
+  m_imageDetectGreyscale = false;
 
   // Set default PDF version number
   m_PDFVersion = wxS("1.3");
@@ -268,6 +292,9 @@ wxPdfDocument::Initialize(int orientation)
 
   m_encrypted = false;
   m_encryptor = NULL;
+  m_protectionPermissions = 0;
+  m_protectionMethod = wxPDF_ENCRYPTION_AESV3R6;
+  m_protectionKeyLength = 0;
 
   m_javascript = wxEmptyString;
 
@@ -277,6 +304,7 @@ wxPdfDocument::Initialize(int orientation)
 
   m_currentParser = NULL;
   m_currentSource = wxEmptyString;
+  m_importCacheSize = WXPDF_OBJECT_CACHE_SIZE;
 
   m_isPdfA1 = false;
 
@@ -297,6 +325,9 @@ wxPdfDocument::~wxPdfDocument()
   }
   delete m_fonts;
 
+  ClearTextRunCache();
+  delete m_textRuns;
+
   wxPdfImageHashMap::iterator image = m_images->begin();
   for (image = m_images->begin(); image != m_images->end(); image++)
   {
@@ -306,46 +337,18 @@ wxPdfDocument::~wxPdfDocument()
     }
   }
   delete m_images;
+  delete m_imageDigests;
 
-  wxPdfPageHashMap::iterator page = m_pages->begin();
-  for (page = m_pages->begin(); page != m_pages->end(); page++)
-  {
-    if (page->second != NULL)
-    {
-      delete page->second;
-    }
-  }
+  ClearContent();
   delete m_pages;
-
-  wxPdfPageLinksMap::iterator pageLinks = m_pageLinks->begin();
-  for (pageLinks = m_pageLinks->begin(); pageLinks != m_pageLinks->end(); pageLinks++)
-  {
-    if (pageLinks->second != NULL)
-    {
-      delete pageLinks->second;
-    }
-  }
+  delete m_pageObjIds;
+  delete m_contentObjIds;
+  delete m_aliasNbPagesPositions;
+  delete m_objStmIndex;
   delete m_pageLinks;
-
-  wxPdfLinkHashMap::iterator link = m_links->begin();
-  for (link = m_links->begin(); link != m_links->end(); link++)
-  {
-    if (link->second != NULL)
-    {
-      delete link->second;
-    }
-  }
   delete m_links;
-
   delete m_namedLinks;
 
-  size_t j;
-  for (j = 0; j < m_outlines.GetCount(); j++)
-  {
-    wxPdfBookmark* bookmark = (wxPdfBookmark*) m_outlines[j];
-    delete bookmark;
-  }
-
   wxPdfStringHashMap::iterator diff = m_diffs->begin();
   for (diff = m_diffs->begin(); diff != m_diffs->end(); diff++)
   {
@@ -380,44 +383,9 @@ wxPdfDocument::~wxPdfDocument()
   }
   delete m_gradients;
 
-  wxPdfAnnotationsMap::iterator annotation = m_annotations->begin();
-  for (annotation = m_annotations->begin(); annotation != m_annotations->end(); annotation++)
-  {
-    if (annotation->second != NULL)
-    {
-      delete annotation->second;
-    }
-  }
   delete m_annotations;
-
-  wxPdfFormAnnotsMap::iterator formAnnotation = m_formAnnotations->begin();
-  for (formAnnotation = m_formAnnotations->begin(); formAnnotation != m_formAnnotations->end(); formAnnotation++)
-  {
-    if (formAnnotation->second != NULL)
-    {
-      delete formAnnotation->second;
-    }
-  }
   delete m_formAnnotations;
-
-  wxPdfFormFieldsMap::iterator formField = m_formFields->begin();
-  for (formField = m_formFields->begin(); formField != m_formFields->end(); formField++)
-  {
-    if (formField->second != NULL)
-    {
-      delete formField->second;
-    }
-  }
   delete m_formFields;
-
-  wxPdfRadioGroupMap::iterator radioGroup = m_radioGroups->begin();
-  for (radioGroup = m_radioGroups->begin(); radioGroup != m_radioGroups->end(); radioGroup++)
-  {
-    if (radioGroup->second != NULL)
-    {
-      delete radioGroup->second;
-    }
-  }
   delete m_radioGroups;
 
   wxPdfTemplatesMap::iterator templateIter = m_templates->begin();
@@ -511,6 +479,146 @@ wxPdfDocument::~wxPdfDocument()
   }
 }
 
+void
+wxPdfDocument::ClearContent()
+{
+  size_t j;
+  wxPdfPageHashMap::iterator page = m_pages->begin();
+  for (page = m_pages->begin(); page != m_pages->end(); page++)
+  {
+    if (page->second != NULL)
+    {
+      delete page->second;
+    }
+  }
+  m_pages->clear();
+  m_pageObjIds->clear();
+  m_contentObjIds->clear();
+  m_pageSizes->clear();
+  m_orientationChanges->clear();
+
+  wxPdfAliasPositionsMap::iterator aliasPositions;
+  for (aliasPositions = m_aliasNbPagesPositions->begin(); aliasPositions != m_aliasNbPagesPositions->end(); aliasPositions++)
+  {
+    delete aliasPositions->second;
+  }
+  m_aliasNbPagesPositions->clear();
+
+  for (j = 0; j < m_deferredLinks.GetCount(); j++)
+  {
+    wxPdfPageLink* pageLink = (wxPdfPageLink*) m_deferredLinks[j];
+    delete pageLink;
+  }
+  m_deferredLinks.Clear();
+  m_deferredLinkIds.Clear();
+
+  if (m_objBuffer != NULL)
+  {
+    m_buffer = m_objOutput;
+    delete m_objBuffer;
+    m_objBuffer = NULL;
+    m_objOutput = NULL;
+  }
+  for (j = 0; j < m_objStreams.GetCount(); j++)
+  {
+    wxMemoryOutputStream* objStm = (wxMemoryOutputStream*) m_objStreams[j];
+    delete objStm;
+  }
+  m_objStreams.Clear();
+  m_objStmIds.Clear();
+  m_objStmOffsets.Clear();
+  m_objStmIndex->clear();
+
+  wxPdfPageLinksMap::iterator pageLinks = m_pageLinks->begin();
+  for (pageLinks = m_pageLinks->begin(); pageLinks != m_pageLinks->end(); pageLinks++)
+  {
+    if (pageLinks->second != NULL)
+    {
+      wxArrayPtrVoid* pageLinkArray = pageLinks->second;
+      for (j = 0; j < pageLinkArray->GetCount(); j++)
+      {
+        wxPdfPageLink* pageLink = (wxPdfPageLink*) (*pageLinkArray)[j];
+        if (pageLink != NULL)
+        {
+          delete pageLink;
+        }
+      }
+      delete pageLinkArray;
+    }
+  }
+  m_pageLinks->clear();
+
+  wxPdfLinkHashMap::iterator link = m_links->begin();
+  for (link = m_links->begin(); link != m_links->end(); link++)
+  {
+    if (link->second != NULL)
+    {
+      delete link->second;
+    }
+  }
+  m_links->clear();
+  m_namedLinks->clear();
+
+  for (j = 0; j < m_outlines.GetCount(); j++)
+  {
+    wxPdfBookmark* bookmark = (wxPdfBookmark*) m_outlines[j];
+    delete bookmark;
+  }
+  m_outlines.Clear();
+  m_outlineRoot = -1;
+  m_maxOutlineLevel = 0;
+
+  wxPdfAnnotationsMap::iterator annotation = m_annotations->begin();
+  for (annotation = m_annotations->begin(); annotation != m_annotations->end(); annotation++)
+  {
+    if (annotation->second != NULL)
+    {
+      wxArrayPtrVoid* annotationArray = annotation->second;
+      for (j = 0; j < annotationArray->GetCount(); j++)
+      {
+        wxPdfAnnotation* pageAnnotation = (wxPdfAnnotation*) (*annotationArray)[j];
+        if (pageAnnotation != NULL)
+        {
+          delete pageAnnotation;
+        }
+      }
+      delete annotationArray;
+    }
+  }
+  m_annotations->clear();
+
+  // Form field annotations are owned by the form fields
+  wxPdfFormAnnotsMap::iterator formAnnotation = m_formAnnotations->begin();
+  for (formAnnotation = m_formAnnotations->begin(); formAnnotation != m_formAnnotations->end(); formAnnotation++)
+  {
+    if (formAnnotation->second != NULL)
+    {
+      delete formAnnotation->second;
+    }
+  }
+  m_formAnnotations->clear();
+
+  wxPdfFormFieldsMap::iterator formField = m_formFields->begin();
+  for (formField = m_formFields->begin(); formField != m_formFields->end(); formField++)
+  {
+    if (formField->second != NULL)
+    {
+      delete formField->second;
+    }
+  }
+  m_formFields->clear();
+
+  wxPdfRadioGroupMap::iterator radioGroup = m_radioGroups->begin();
+  for (radioGroup = m_radioGroups->begin(); radioGroup != m_radioGroups->end(); radioGroup++)
+  {
+    if (radioGroup->second != NULL)
+    {
+      delete radioGroup->second;
+    }
+  }
+  m_radioGroups->clear();
+}
+
 // --- Public methods
 
 bool
@@ -582,6 +690,13 @@ wxPdfDocument::SetProtection(int permissions,
     {
       m_encrypted = true;
       m_encryptor->GenerateEncryptionKey(userPassword, ownerPswd, protection);
+
+      // Keep the parameters for the next document after Reset()
+      m_protectionPermissions = permissions;
+      m_protectionUserPassword = userPassword;
+      m_protectionOwnerPassword = ownerPassword;
+      m_protectionMethod = encryptionMethod;
+      m_protectionKeyLength = keyLength;
     }
   }
   else
@@ -645,6 +760,9 @@ wxPdfDocument::AliasNbPages(const wxString& alias)
 {
   // Define an alias for total number of pages
   m_aliasNbPages = alias;
+  // Positions of the alias are recorded when text is written,
+  // pages written so far have to be searched for the alias
+  m_aliasNbPagesScan = m_page;
 }
 
 void
@@ -654,6 +772,64 @@ wxPdfDocument::Open()
   m_state = 1;
 }
 
+/// Output stream keeping track of the number of bytes written to the underlying stream
+class wxPdfCountingOutputStream : public wxFilterOutputStream
+{
+public:
+  /// Constructor
+  wxPdfCountingOutputStream(wxOutputStream& stream)
+    : wxFilterOutputStream(stream), m_count(0)
+  {
+  }
+
+protected:
+  /// Write data to the underlying stream
+  virtual size_t OnSysWrite(const void* buffer, size_t size) wxOVERRIDE
+  {
+    size_t written = m_parent_o->Write(buffer, size).LastWrite();
+    m_count += written;
+    return written;
+  }
+
+  /// Get the number of bytes written so far
+  virtual wxFileOffset OnSysTell() const wxOVERRIDE
+  {
+    return m_count;
+  }
+
+private:
+  wxFileOffset m_count; ///< number of bytes written
+};
+
+void
+wxPdfDocument::Open(wxOutputStream& outputStream)
+{
+  if (m_state != 0)
+  {
+    wxLogError(wxString(wxS("wxPdfDocument::Open: ")) +
+               wxString(_("Streaming mode can only be activated before the document is opened.")));
+    return;
+  }
+
+  // Begin document in streaming mode
+  if (m_buffer != NULL)
+  {
+    delete m_buffer;
+  }
+  m_buffer = new wxPdfCountingOutputStream(outputStream);
+  m_streaming = true;
+  Open();
+  if (m_compactOutput && m_PDFVersion < wxS("1.5"))
+  {
+    m_PDFVersion = wxS("1.5");
+  }
+
+  // The header is written immediately, a higher PDF version required
+  // by the document content is given in the document catalog.
+  m_streamVersion = m_PDFVersion;
+  PutHeader();
+}
+
 void
 wxPdfDocument::AddPage(int orientation, bool useDefaultPageSize)
 {
@@ -1025,11 +1201,46 @@ wxPdfDocument::DoGetStringWidth(const wxString& s, double charSpacing)
   double w = 0;
   if (m_currentFont != 0)
   {
-    w = m_currentFont->GetStringWidth(s, m_kerning, charSpacing / m_fontSize) * m_fontSize;
+    // The width in font units does not depend on the font size unless character spacing is applied
+    wxPdfTextRun* run = (charSpacing == 0) ? FindTextRun(s) : NULL;
+    if (run != NULL)
+    {
+      int k = (m_kerning) ? 1 : 0;
+      if (!run->m_hasWidth[k])
+      {
+        run->m_width[k] = m_currentFont->GetStringWidth(s, m_kerning, 0);
+        run->m_hasWidth[k] = true;
+      }
+      w = run->m_width[k] * m_fontSize;
+    }
+    else
+    {
+      w = m_currentFont->GetStringWidth(s, m_kerning, charSpacing / m_fontSize) * m_fontSize;
+    }
   }
   return w;
 }
 
+void
+wxPdfDocument::GetCharAdvances(const wxString& s, wxPdfArrayDouble& advances, double charSpacing)
+{
+  if (m_currentFont != 0)
+  {
+    m_currentFont->GetCharAdvances(s, advances, m_kerning, charSpacing / m_fontSize);
+    size_t n = advances.GetCount();
+    size_t k;
+    for (k = 0; k < n; ++k)
+    {
+      advances[k] *= m_fontSize;
+    }
+  }
+  else
+  {
+    advances.Empty();
+    advances.Add(0, s.length());
+  }
+}
+
 void
 wxPdfDocument::Text(double x, double y, const wxString& txt)
 {
@@ -1333,6 +1544,7 @@ wxPdfDocument::MultiCell(double w, double h, const wxString& txt, int border, in
       b = (border & wxPDF_BORDER_TOP) ? b2 | wxPDF_BORDER_TOP : b2;
     }
   }
+  wxPdfLineBreaker lineBreaker(m_currentFont, s, m_kerning, m_charSpacing, m_fontSize);
   int sep = -1;
   int i = 0;
   int j = 0;
@@ -1376,7 +1588,7 @@ wxPdfDocument::MultiCell(double w, double h, const wxString& txt, int border, in
       ls = len;
       ns++;
     }
-    len = DoGetStringWidth(s.SubString(j, i), m_charSpacing);
+    len = lineBreaker.GetWidth(j, i);
 
     if (len > wmax)
     {
@@ -1460,6 +1672,7 @@ wxPdfDocument::LineCount(double w, const wxString& txt)
     nb--;
   }
 
+  wxPdfLineBreaker lineBreaker(m_currentFont, s, m_kerning, m_charSpacing, m_fontSize);
   int sep = -1;
   int i = 0;
   int j = 0;
@@ -1484,7 +1697,7 @@ wxPdfDocument::LineCount(double w, const wxString& txt)
     {
       sep = i;
     }
-    len = DoGetStringWidth(s.SubString(j, i), m_charSpacing);
+    len = lineBreaker.GetWidth(j, i);
 
     if (len > wmax)
     {
@@ -1582,6 +1795,7 @@ wxPdfDocument::WriteCell(double h, const wxString& txt, int border, int fill, co
   double w = m_w - m_rMargin - m_x;
   double wmax = (w - 2 * m_cMargin) + wxPDF_EPSILON;
 
+  wxPdfLineBreaker lineBreaker(m_currentFont, s, m_kerning, m_charSpacing, m_fontSize);
   int sep = -1;
   int i = 0;
   int j = 0;
@@ -1613,7 +1827,7 @@ wxPdfDocument::WriteCell(double h, const wxString& txt, int border, int fill, co
     {
       sep = i;
     }
-    len = DoGetStringWidth(s.SubString(j, i), m_charSpacing);
+    len = lineBreaker.GetWidth(j, i);
     if (len > wmax)
     {
       // Automatic line break
@@ -1817,6 +2031,7 @@ wxPdfDocument::Image(const wxString& file, double x, double y, double w, double
       currentImage->SetMaskImage(maskImage);
     }
     (*m_images)[file] = currentImage;
+    AddImageSoftMask(file, currentImage);
   }
   else
   {
@@ -1837,49 +2052,66 @@ wxPdfDocument::Image(const wxString& name, const wxImage& img, double x, double
   bool isValid = false;
   if (img.Ok())
   {
-    wxImage tempImage = img.Copy();
     wxPdfImage* currentImage = NULL;
     // Put an image on the page
     wxPdfImageHashMap::iterator image = (*m_images).find(name);
     if (image == (*m_images).end())
     {
-      if (tempImage.HasAlpha())
+      // Images with identical content are embedded only once, regardless of their name
+      wxString digest = wxPdfImage::GetDigest(img, jpegFormat, jpegQuality, maskImage);
+      wxPdfImageHashMap::iterator imageDigest = m_imageDigests->find(digest);
+      if (imageDigest != m_imageDigests->end())
       {
-        if (maskImage <= 0)
+        currentImage = imageDigest->second;
+      }
+      else
+      {
+        if (img.HasAlpha())
         {
-          maskImage = ImageMask(name+wxString(wxS(".mask")), tempImage);
+          if (maskImage <= 0)
+          {
+            maskImage = ImageMask(name+wxString(wxS(".mask")), img);
+          }
         }
-        if(!tempImage.ConvertAlphaToMask(0))
+        else if (img.HasMask() && maskImage <= 0)
         {
+          // Extract the mask
+          wxImage mask = img.ConvertToMono(img.GetMaskRed(), img.GetMaskGreen(), img.GetMaskBlue());
+          // Invert the mask
+          mask = mask.ConvertToMono(0, 0, 0);
+          maskImage = ImageMask(name+wxString(wxS(".mask")), mask);
+        }
+        // First use of image, get info
+        int i = (int) (*m_images).size() + 1;
+        if (jpegFormat)
+        {
+          // The JPEG encoder requires an image without alpha channel and mask
+          wxImage tempImage = img.Copy();
+          if (tempImage.HasAlpha() && !tempImage.ConvertAlphaToMask(0))
+          {
+            return false;
+          }
+          tempImage.SetMask(false);
+          tempImage.SetOption(wxIMAGE_OPTION_QUALITY, jpegQuality);
+          currentImage = new wxPdfImage(this, i, name, tempImage, jpegFormat);
+        }
+        else
+        {
+          // The pixel data are encoded directly, the alpha channel and the mask are ignored
+          currentImage = new wxPdfImage(this, i, name, img);
+        }
+        if (!currentImage->Parse())
+        {
+          delete currentImage;
           return false;
         }
+        if (maskImage > 0)
+        {
+          currentImage->SetMaskImage(maskImage);
+        }
+        (*m_images)[name] = currentImage;
+        (*m_imageDigests)[digest] = currentImage;
       }
-      else if (tempImage.HasMask() && maskImage <= 0)
-      {
-        // Extract the mask
-        wxImage mask = tempImage.ConvertToMono(tempImage.GetMaskRed(), tempImage.GetMaskGreen(), tempImage.GetMaskBlue());
-        // Invert the mask
-        mask = mask.ConvertToMono(0, 0, 0);
-        maskImage = ImageMask(name+wxString(wxS(".mask")), mask);
-      }
-      // First use of image, get info
-      tempImage.SetMask(false);
-      if (jpegFormat)
-      {
-        tempImage.SetOption(wxIMAGE_OPTION_QUALITY, jpegQuality);
-      }
-      int i = (int) (*m_images).size() + 1;
-      currentImage = new wxPdfImage(this, i, name, tempImage, jpegFormat);
-      if (!currentImage->Parse())
-      {
-        delete currentImage;
-        return false;
-      }
-      if (maskImage > 0)
-      {
-        currentImage->SetMaskImage(maskImage);
-      }
-      (*m_images)[name] = currentImage;
     }
     else
     {
@@ -1931,6 +2163,7 @@ wxPdfDocument::Image(const wxString& name, wxInputStream& stream,
       currentImage->SetMaskImage(maskImage);
     }
     (*m_images)[name] = currentImage;
+    AddImageSoftMask(name, currentImage);
   }
   else
   {
@@ -1945,6 +2178,42 @@ wxPdfDocument::Image(const wxString& name, wxInputStream& stream,
   return isValid;
 }
 
+void
+wxPdfDocument::AddImageSoftMask(const wxString& name, wxPdfImage* currentImage)
+{
+  if (currentImage->GetBitsPerComponent() == 16 && m_PDFVersion < wxS("1.5"))
+  {
+    // 16 bits per component require PDF 1.5
+    m_PDFVersion = wxS("1.5");
+  }
+  // An explicitly given mask takes precedence over the alpha channel
+  if (currentImage->HasSoftMask() && currentImage->GetMaskImage() <= 0)
+  {
+    wxString maskName = name + wxString(wxS(".smask"));
+    int n = 0;
+    wxPdfImageHashMap::iterator image = (*m_images).find(maskName);
+    if (image == (*m_images).end())
+    {
+      n = (int) (*m_images).size() + 1;
+      (*m_images)[maskName] = currentImage->CreateSoftMask(n, maskName);
+    }
+    else
+    {
+      n = image->second->GetIndex();
+    }
+    currentImage->SetMaskImage(n);
+    if (m_PDFVersion < wxS("1.4"))
+    {
+      m_PDFVersion = wxS("1.4");
+    }
+  }
+  else
+  {
+    // The explicitly given mask replaces the alpha channel; the image cache keeps it for other uses
+    currentImage->DiscardSoftMask();
+  }
+}
+
 int
 wxPdfDocument::ImageMask(const wxString& file, const wxString& type)
 {
@@ -1968,6 +2237,14 @@ wxPdfDocument::ImageMask(const wxString& file, const wxString& type)
       delete currentImage;
       return 0;
     }
+    // The alpha channel of a gray scale image with alpha would be lost
+    if (currentImage->HasSoftMask())
+    {
+      wxLogError(wxString(wxS("wxPdfDocument::ImageMask: ")) +
+                 wxString::Format(_("Image '%s' has an alpha channel and can't be used as a mask."), file.c_str()));
+      delete currentImage;
+      return 0;
+    }
     (*m_images)[file] = currentImage;
   }
   else
@@ -1979,6 +2256,11 @@ wxPdfDocument::ImageMask(const wxString& file, const wxString& type)
   {
     m_PDFVersion = wxS("1.4");
   }
+  if (currentImage->GetBitsPerComponent() == 16 && m_PDFVersion < wxS("1.5"))
+  {
+    // 16 bits per component require PDF 1.5
+    m_PDFVersion = wxS("1.5");
+  }
   return n;
 }
 
@@ -1993,33 +2275,19 @@ wxPdfDocument::ImageMask(const wxString& name, const wxImage& img)
     wxPdfImageHashMap::iterator image = (*m_images).find(name);
     if (image == (*m_images).end())
     {
-      wxImage tempImage;
+      // First use of image, get info
+      n = (int) (*m_images).size() + 1;
       if (img.HasAlpha())
       {
-        int x, y;
-        int w = img.GetWidth();
-        int h = img.GetHeight();
-        tempImage = wxImage(w, h);
-        unsigned char alpha;
-        for (x = 0; x < w; x++)
-        {
-          for (y = 0; y < h; y++)
-          {
-            alpha = img.GetAlpha(x, y);
-            tempImage.SetRGB(x, y, alpha, alpha, alpha);
-          }
-        }
-        tempImage.SetOption(wxIMAGE_OPTION_PNG_FORMAT, wxPNG_TYPE_GREY_RED);
+        // The alpha channel is encoded directly as greyscale image
+        currentImage = new wxPdfImage(this, n, name, img, false, true);
       }
       else
       {
-        tempImage = img.ConvertToGreyscale();
+        wxImage tempImage = img.ConvertToGreyscale();
         tempImage.SetOption(wxIMAGE_OPTION_PNG_FORMAT, wxPNG_TYPE_GREY_RED);
+        currentImage = new wxPdfImage(this, n, name, tempImage);
       }
-      tempImage.SetMask(false);
-      // First use of image, get info
-      n = (int) (*m_images).size() + 1;
-      currentImage = new wxPdfImage(this, n, name, tempImage);
       if (!currentImage->Parse())
       {
         delete currentImage;
@@ -2063,6 +2331,14 @@ wxPdfDocument::ImageMask(const wxString& name, wxInputStream& stream, const wxSt
       delete currentImage;
       return 0;
     }
+    // The alpha channel of a gray scale image with alpha would be lost
+    if (currentImage->HasSoftMask())
+    {
+      wxLogError(wxString(wxS("wxPdfDocument::ImageMask: ")) +
+                 wxString::Format(_("Image '%s' has an alpha channel and can't be used as a mask."), name.c_str()));
+      delete currentImage;
+      return 0;
+    }
     (*m_images)[name] = currentImage;
   }
   else
@@ -2074,6 +2350,11 @@ wxPdfDocument::ImageMask(const wxString& name, wxInputStream& stream, const wxSt
   {
     m_PDFVersion = wxS("1.4");
   }
+  if (currentImage->GetBitsPerComponent() == 16 && m_PDFVersion < wxS("1.5"))
+  {
+    // 16 bits per component require PDF 1.5
+    m_PDFVersion = wxS("1.5");
+  }
   return n;
 }
 
@@ -2120,6 +2401,13 @@ wxPdfDocument::Ln(double h)
 bool
 wxPdfDocument::SaveAsFile(const wxString& name)
 {
+  if (m_streaming)
+  {
+    wxLogError(wxString(wxS("wxPdfDocument::SaveAsFile: ")) +
+               wxString(_("Document is written in streaming mode, use Close() instead.")));
+    return false;
+  }
+
   wxString fileName = name;
   // Normalize parameters
   if(fileName.Length() == 0)
@@ -2151,6 +2439,8 @@ wxPdfDocument::SaveAsFile(const wxString& name)
       outfile.Write(tmp);
     }
     outfile.Close();
+    // Data of a deferred image could not be read
+    ok = !m_writeError;
   }
   return ok;
 }
@@ -2158,6 +2448,17 @@ wxPdfDocument::SaveAsFile(const wxString& name)
 const wxMemoryOutputStream&
 wxPdfDocument::CloseAndGetBuffer()
 {
+  if (m_streaming)
+  {
+    wxLogError(wxString(wxS("wxPdfDocument::CloseAndGetBuffer: ")) +
+               wxString(_("Document is written in streaming mode, no buffer available.")));
+    if (m_state < 3)
+    {
+      Close();
+    }
+    return m_emptyBuffer;
+  }
+
   if (m_state < 3)
   {
     Close();
@@ -2396,6 +2697,97 @@ wxPdfDocument::Close()
   EndDoc();
 }
 
+void
+wxPdfDocument::Reset()
+{
+  if (m_inTemplate)
+  {
+    wxLogError(wxString(wxS("wxPdfDocument::Reset: ")) +
+               wxString(_("Document can't be reset while a template is defined.")));
+    return;
+  }
+
+  ClearContent();
+  m_offsets->clear();
+  m_aliasNbPagesScan = 0;
+
+  // Objects of imported documents are written again to the next document
+  wxPdfParserMap::iterator parser = m_parsers->begin();
+  for (parser = m_parsers->begin(); parser != m_parsers->end(); parser++)
+  {
+    if (parser->second != NULL)
+    {
+      parser->second->ClearObjectQueue();
+    }
+  }
+
+  if (m_buffer != NULL)
+  {
+    delete m_buffer;
+  }
+  m_buffer = new wxMemoryOutputStream();
+  m_streaming = false;
+
+  m_state = 0;
+  m_page = 0;
+  m_n = 2;
+  m_compressionTimeSaved = 0;
+  m_writeError = false;
+
+  // Restore the PDF version required by the kept settings and resources
+  m_PDFVersion = wxS("1.3");
+  SetViewerPreferences(m_viewerPrefs);
+  SetPaperHandling(m_paperHandling);
+  wxPdfImageHashMap::iterator image;
+  for (image = m_images->begin(); image != m_images->end(); image++)
+  {
+    wxPdfImage* currentImage = image->second;
+    // The image policy is applied according to the placements in the next document
+    currentImage->ResetPlacedSize();
+    if (currentImage->GetBitsPerComponent() == 16 && m_PDFVersion < wxS("1.5"))
+    {
+      m_PDFVersion = wxS("1.5");
+    }
+    if (currentImage->GetMaskImage() > 0 && m_PDFVersion < wxS("1.4"))
+    {
+      m_PDFVersion = wxS("1.4");
+    }
+  }
+
+  // A protected document gets a new document ID and encryption key,
+  // object keys must not be reused across documents
+  if (m_encryptor != NULL)
+  {
+    delete m_encryptor;
+    m_encryptor = NULL;
+    m_encrypted = false;
+    SetProtection(m_protectionPermissions, m_protectionUserPassword, m_protectionOwnerPassword,
+                  m_protectionMethod, m_protectionKeyLength);
+  }
+
+  m_inFooter = false;
+  m_inTransform = 0;
+  m_currentExtGState = 0;
+  m_layerDepth.Clear();
+
+  // Page format and orientation
+  m_curPageSize = m_defPageSize;
+  m_curOrientation = m_defOrientation;
+  if (m_defOrientation == wxLANDSCAPE)
+  {
+    m_wPt = m_fhPt;
+    m_hPt = m_fwPt;
+  }
+  else
+  {
+    m_wPt = m_fwPt;
+    m_hPt = m_fhPt;
+  }
+  m_w = m_wPt / m_k;
+  m_h = m_hPt / m_k;
+  m_pageBreakTrigger = (m_yAxisOriginTop) ? m_h - m_bMargin : m_bMargin;
+}
+
 void
 wxPdfDocument::Header()
 {
@@ -2484,6 +2876,48 @@ wxPdfDocument::SetCompression(bool compress)
   m_compress = compress;
 }
 
+void
+wxPdfDocument::SetCompactOutput(bool compact)
+{
+  if (m_state == 0)
+  {
+    m_compactOutput = compact;
+  }
+  else
+  {
+    wxLogError(wxString(wxS("wxPdfDocument::SetCompactOutput: ")) +
+               wxString(_("Compact output can only be selected before the document is opened.")));
+  }
+}
+
+void
+wxPdfDocument::SetCompressionThreads(int threads)
+{
+  m_compressionThreads = (threads > 1) ? threads : 1;
+}
+
+void
+wxPdfDocument::SetImageCompression(int deflateLevel, bool predictors)
+{
+  m_imageDeflateLevel = (deflateLevel >= 0 && deflateLevel <= 9) ? deflateLevel : -1;
+  m_imagePredictors = predictors;
+}
+
+void
+wxPdfDocument::SetDeferredImageLoading(bool deferred)
+{
+  m_deferredImageLoading = deferred;
+}
+
+void
+wxPdfDocument::SetImagePolicy(double targetDpi, int maxPixels, int jpegQuality, bool detectGreyscale)
+{
+  m_imageTargetDpi = (targetDpi > 0) ? targetDpi : 0;
+  m_imageMaxPixels = (maxPixels > 0) ? maxPixels : 0;
+  m_imageJpegQuality = (jpegQuality < 0) ? 0 : ((jpegQuality > 100) ? 100 : jpegQuality);
+  m_imageDetectGreyscale = detectGreyscale;
+}
+
 void
 wxPdfDocument::AppendJavascript(const wxString& javascript)
 {
@@ -2569,15 +3003,12 @@ wxPdfDocument::AddPattern(const wxString& patternName, const wxImage& image, dou
       {
         // Prepare new image
         int maskImage = 0;
-        wxImage tempImage = image.Copy();
-        if (tempImage.HasAlpha())
+        if (image.HasAlpha())
         {
-          maskImage = ImageMask(imageName+wxString(wxS(".mask")), tempImage);
-          tempImage.ConvertAlphaToMask(0);
+          maskImage = ImageMask(imageName+wxString(wxS(".mask")), image);
         }
-        tempImage.SetMask(false);
         int i = (*m_images).size() + 1;
-        currentImage = new wxPdfImage(this, i, imageName, tempImage);
+        currentImage = new wxPdfImage(this, i, imageName, image);
         currentImage->Parse();
         if (maskImage > 0)
         {
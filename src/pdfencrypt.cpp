@@ -392,6 +392,9 @@ wxPdfEncrypt::wxPdfEncrypt(int revision, int keyLength)
     m_rc4key[j] = 0;
   }
 
+  m_objectKeyN = -1;
+  m_objectKeyG = -1;
+
   m_encryptMetaData = true;
 }
 
@@ -981,6 +984,7 @@ wxPdfEncrypt::ComputeEncryptionKey(const wxString& documentId,
   }
 
   memcpy(m_encryptionKey, digest, m_keyLength);
+  m_objectKeyN = -1;
 
   // Setup user key
   if (revision == 3 || revision == 4)
@@ -1063,12 +1067,12 @@ wxPdfEncrypt::Decrypt(int n, int g, wxString& str)
   delete[] data;
 }
 
-void
-wxPdfEncrypt::Encrypt(int n, int g, unsigned char* str, unsigned int len)
+unsigned char*
+wxPdfEncrypt::GetObjectKey(int n, int g)
 {
-  if (m_rValue <= 4)
+  // All strings and streams of an object share the object key
+  if (n != m_objectKeyN || g != m_objectKeyG)
   {
-    unsigned char objkey[MD5_HASHBYTES];
     unsigned char nkey[MD5_HASHBYTES + 5 + 4];
     unsigned int nkeylen = m_keyLength + 5;
     unsigned int j;
@@ -1092,7 +1096,19 @@ wxPdfEncrypt::Encrypt(int n, int g, unsigned char* str, unsigned int len)
       nkey[m_keyLength + 8] = 0x54;
     }
 
-    GetMD5Binary(nkey, nkeylen, objkey);
+    GetMD5Binary(nkey, nkeylen, m_objectKey);
+    m_objectKeyN = n;
+    m_objectKeyG = g;
+  }
+  return m_objectKey;
+}
+
+void
+wxPdfEncrypt::Encrypt(int n, int g, unsigned char* str, unsigned int len)
+{
+  if (m_rValue <= 4)
+  {
+    unsigned char* objkey = GetObjectKey(n, g);
     int keylen = (m_keyLength <= 11) ? m_keyLength + 5 : 16;
     switch (m_rValue)
     {
@@ -1120,31 +1136,7 @@ wxPdfEncrypt::Decrypt(int n, int g, unsigned char* str, unsigned int len)
   int realLen = len;
   if (m_rValue <= 4)
   {
-    unsigned char objkey[MD5_HASHBYTES];
-    unsigned char nkey[MD5_HASHBYTES + 5 + 4];
-    unsigned int nkeylen = m_keyLength + 5;
-    unsigned int j;
-    for (j = 0; j < m_keyLength; j++)
-    {
-      nkey[j] = m_encryptionKey[j];
-    }
-    nkey[m_keyLength + 0] = 0xff & n;
-    nkey[m_keyLength + 1] = 0xff & (n >> 8);
-    nkey[m_keyLength + 2] = 0xff & (n >> 16);
-    nkey[m_keyLength + 3] = 0xff & g;
-    nkey[m_keyLength + 4] = 0xff & (g >> 8);
-
-    if (m_rValue == 4)
-    {
-      // AES encryption needs some 'salt'
-      nkeylen += 4;
-      nkey[m_keyLength + 5] = 0x73;
-      nkey[m_keyLength + 6] = 0x41;
-      nkey[m_keyLength + 7] = 0x6c;
-      nkey[m_keyLength + 8] = 0x54;
-    }
-
-    GetMD5Binary(nkey, nkeylen, objkey);
+    unsigned char* objkey = GetObjectKey(n, g);
     int keylen = (m_keyLength <= 11) ? m_keyLength + 5 : 16;
     switch (m_rValue)
     {
@@ -1233,7 +1225,7 @@ wxPdfEncrypt::AESEncrypt(unsigned char* key, unsigned int keylen,
                   unsigned char* textout)
 {
   wxUnusedVar(keylen);
-  GenerateInitialVector(textout);
+  m_rbg->GetRandomBytes(textout, 16);
   m_aes->init(wxPdfRijndael::CBC, wxPdfRijndael::Encrypt, key, wxPdfRijndael::Key16Bytes, textout);
   size_t offset = CalculateStreamOffset();
   int len = m_aes->padEncrypt(&textin[offset], textlen, &textout[offset]);
@@ -1271,7 +1263,7 @@ wxPdfEncrypt::AESV3Encrypt(const unsigned char* key, unsigned int keylen,
                     unsigned char* textout)
 {
   wxUnusedVar(keylen);
-  GenerateInitialVector(textout);
+  m_rbg->GetRandomBytes(textout, 16);
   m_aes->init(wxPdfRijndael::CBC, wxPdfRijndael::Encrypt, key, wxPdfRijndael::Key32Bytes, textout);
   size_t offset = CalculateStreamOffset();
   int len = m_aes->padEncrypt(&textin[offset], textlen, &textout[offset]);
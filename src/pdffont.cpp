@@ -266,6 +266,22 @@ wxPdfFont::GetStringWidth(const wxString& s) const
   return width;
 }
 
+void
+wxPdfFont::GetCharAdvances(const wxString& s, wxPdfArrayDouble& advances) const
+{
+  if (m_fontData != NULL && wxPdfFontManager::GetFontManager()->InitializeFontData(*this))
+  {
+    m_fontData->GetCharAdvances(s, advances);
+  }
+  else
+  {
+    advances.Empty();
+    advances.Add(0, s.length());
+    wxLogError(wxString(wxS("wxPdfFont::GetCharAdvances: ")) +
+               wxString(_("Error on initializing the font.")));
+  }
+}
+
 bool
 wxPdfFont::EmbedRequired() const
 {
@@ -21,13 +21,23 @@
 #endif
 
 // includes
+#include <wx/dir.h>
+#include <wx/file.h>
+#include <wx/filename.h>
+#include <wx/thread.h>
 #include <wx/tokenzr.h>
+#include <wx/zstream.h>
+
+#include <algorithm>
+#include <vector>
 
 #include "wx/pdfencoding.h"
 #include "wx/pdffontdata.h"
 #include "wx/pdffont.h"
 #include "wx/pdfutility.h"
 
+#include "crypto/sha256.h"
+
 wxString
 wxPdfFontData::GetNodeContent(const wxXmlNode *node)
 {
@@ -172,6 +182,116 @@ wxPdfFontData::GetFontDescription(const wxXmlNode *node, wxPdfFontDescription& f
           bUnderlinePosition && bUnderlineThickness);
 }
 
+WX_DECLARE_HASH_MAP(wxUint32, double, wxIntegerHash, wxIntegerEqual, wxPdfCharAdvanceMap);
+
+static int
+CompareUint32(wxUint32* item1, wxUint32* item2)
+{
+  return (*item1 < *item2) ? -1 : ((*item1 > *item2) ? 1 : 0);
+}
+
+wxPdfFontMetricsTable::wxPdfFontMetricsTable(const wxPdfGlyphWidthMap* cw, const wxPdfChar2GlyphMap* gn, const wxPdfKernPairMap* kp)
+{
+  m_valid = true;
+  if (cw != NULL)
+  {
+    wxPdfGlyphWidthMap::const_iterator charIter;
+    for (charIter = cw->begin(); charIter != cw->end(); ++charIter)
+    {
+      m_valid = Add(m_widthPages, m_widths, charIter->first, charIter->second) && m_valid;
+    }
+  }
+  if (gn != NULL)
+  {
+    wxPdfChar2GlyphMap::const_iterator glyphIter;
+    for (glyphIter = gn->begin(); glyphIter != gn->end(); ++glyphIter)
+    {
+      m_valid = glyphIter->second <= 0x7fffffff &&
+                Add(m_glyphPages, m_glyphs, glyphIter->first, (int) glyphIter->second) && m_valid;
+    }
+  }
+  if (kp != NULL)
+  {
+    wxPdfKernPairMap::const_iterator kpIter;
+    for (kpIter = kp->begin(); kpIter != kp->end(); ++kpIter)
+    {
+      const wxPdfKernWidthMap* kwMap = kpIter->second;
+      if (kwMap != NULL && !kwMap->empty())
+      {
+        wxPdfArrayUint32 seconds;
+        seconds.Alloc(kwMap->size());
+        wxPdfKernWidthMap::const_iterator kwIter;
+        for (kwIter = kwMap->begin(); kwIter != kwMap->end(); ++kwIter)
+        {
+          seconds.Add(kwIter->first);
+        }
+        seconds.Sort(CompareUint32);
+        m_valid = Add(m_kernPages, m_kernIndex, kpIter->first, (int) m_kernStart.GetCount()) && m_valid;
+        m_kernStart.Add((int) m_kernSeconds.GetCount());
+        m_kernCount.Add((int) seconds.GetCount());
+        size_t j;
+        for (j = 0; j < seconds.GetCount(); ++j)
+        {
+          m_kernSeconds.Add(seconds[j]);
+          m_kernWidths.Add(kwMap->find(seconds[j])->second);
+        }
+      }
+    }
+  }
+}
+
+int
+wxPdfFontMetricsTable::GetKerning(wxUint32 first, wxUint32 second) const
+{
+  int index = Find(m_kernPages, m_kernIndex, first);
+  if (index >= 0)
+  {
+    // Binary search for the second glyph within the pairs of the first glyph
+    int lo = m_kernStart[index];
+    int hi = lo + m_kernCount[index] - 1;
+    while (lo <= hi)
+    {
+      int mid = (lo + hi) / 2;
+      wxUint32 glyph = m_kernSeconds[mid];
+      if (glyph < second)
+      {
+        lo = mid + 1;
+      }
+      else if (glyph > second)
+      {
+        hi = mid - 1;
+      }
+      else
+      {
+        return m_kernWidths[mid];
+      }
+    }
+  }
+  return 0;
+}
+
+bool
+wxPdfFontMetricsTable::Add(wxArrayInt& pages, wxArrayInt& values, wxUint32 code, int value)
+{
+  // Only codes within the Unicode range are supported
+  if (code > 0x10ffff)
+  {
+    return false;
+  }
+  size_t page = code >> 8;
+  if (page >= pages.GetCount())
+  {
+    pages.Add(-1, page + 1 - pages.GetCount());
+  }
+  if (pages[page] < 0)
+  {
+    pages[page] = (int) values.GetCount();
+    values.Add(-1, 256);
+  }
+  values[pages[page] + (code & 0xff)] = value;
+  return true;
+}
+
 wxPdfFontData::wxPdfFontData()
 {
   m_refCount = 0;
@@ -185,6 +305,8 @@ wxPdfFontData::wxPdfFontData()
   m_fontIndex = 0;
   m_fontBuffer = nullptr;
   m_fontBufferSize = 0;
+  m_fontDigest = wxEmptyString;
+  m_mappedFile = NULL;
 
   m_cff = false;
   m_cffOffset = 0;
@@ -193,6 +315,7 @@ wxPdfFontData::wxPdfFontData()
   m_cw = NULL;
   m_gn = NULL;
   m_kp = NULL;
+  m_metrics = NULL;
 
   m_enc   = wxEmptyString;
   m_diffs = wxEmptyString;
@@ -229,6 +352,27 @@ wxPdfFontData::~wxPdfFontData()
     delete m_gn;
   }
   delete m_cw;
+  delete m_metrics;
+  wxPdfMappedFile::Release(m_mappedFile);
+}
+
+#if wxUSE_THREADS
+static wxCriticalSection gs_csMappedFontFile;
+#endif
+
+wxMemoryInputStream*
+wxPdfFontData::GetMappedFontStream(const wxString& fileName)
+{
+  // The font data refer to a single font file, which is mapped only once,
+  // even if documents in several threads write the font at the same time
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csMappedFontFile);
+#endif
+  if (m_mappedFile == NULL)
+  {
+    m_mappedFile = wxPdfMappedFile::Acquire(fileName);
+  }
+  return (m_mappedFile != NULL) ? new wxMemoryInputStream(m_mappedFile->GetData(), m_mappedFile->GetLength()) : NULL;
 }
 
 void
@@ -252,6 +396,29 @@ wxPdfFontData::FindEncodingMap(const wxPdfEncoding* encoding) const
   return convMap;
 }
 
+void
+wxPdfFontData::CreateMetricsTable()
+{
+  if (m_metrics != NULL)
+  {
+    delete m_metrics;
+    m_metrics = NULL;
+  }
+  if (m_cw != NULL)
+  {
+    // Kerning pairs refer to glyph numbers only for Unicode TrueType/OpenType fonts
+    bool translateChar2Glyph = m_type.IsSameAs(wxS("TrueTypeUnicode")) ||
+                               m_type.IsSameAs(wxS("OpenTypeUnicode"));
+    m_metrics = new wxPdfFontMetricsTable(m_cw, (translateChar2Glyph) ? m_gn : NULL, m_kp);
+    if (!m_metrics->IsValid())
+    {
+      // Fall back to the maps
+      delete m_metrics;
+      m_metrics = NULL;
+    }
+  }
+}
+
 void
 wxPdfFontData::SetEncodingChecker(wxPdfEncodingChecker* encodingChecker)
 {
@@ -542,6 +709,11 @@ void
 wxPdfFontData::SetGlyphWidthMap(wxPdfGlyphWidthMap* cw)
 {
   m_cw = cw;
+  if (m_metrics != NULL)
+  {
+    delete m_metrics;
+    m_metrics = NULL;
+  }
 }
 
 const wxPdfGlyphWidthMap*
@@ -554,6 +726,11 @@ void
 wxPdfFontData::SetChar2GlyphMap(wxPdfChar2GlyphMap* gn)
 {
   m_gn = gn;
+  if (m_metrics != NULL)
+  {
+    delete m_metrics;
+    m_metrics = NULL;
+  }
 }
 
 const wxPdfChar2GlyphMap*
@@ -566,6 +743,11 @@ void
 wxPdfFontData::SetKernPairMap(wxPdfKernPairMap* kp)
 {
   m_kp = kp;
+  if (m_metrics != NULL)
+  {
+    delete m_metrics;
+    m_metrics = NULL;
+  }
 }
 
 const wxPdfKernPairMap*
@@ -580,7 +762,21 @@ wxPdfFontData::GetKerningWidth(const wxString& s) const
   bool translateChar2Glyph = m_type.IsSameAs(wxS("TrueTypeUnicode")) ||
                              m_type.IsSameAs(wxS("OpenTypeUnicode"));
   int width = 0;
-  if (m_kp != NULL && s.length())
+  if (m_metrics != NULL)
+  {
+    if (m_metrics->HasKerning() && s.length())
+    {
+      wxString::const_iterator ch = s.begin();
+      wxUint32 ch1 = m_metrics->GetGlyph((wxUint32) (*ch));
+      for (++ch; ch != s.end(); ++ch)
+      {
+        wxUint32 ch2 = m_metrics->GetGlyph((wxUint32) (*ch));
+        width += m_metrics->GetKerning(ch1, ch2);
+        ch1 = ch2;
+      }
+    }
+  }
+  else if (m_kp != NULL && s.length())
   {
     wxPdfKernPairMap::const_iterator kpIter;
     wxPdfKernWidthMap::const_iterator kwIter;
@@ -630,7 +826,27 @@ wxPdfFontData::GetKerningWidthArray(const wxString& s) const
                              m_type.IsSameAs(wxS("OpenTypeUnicode"));
   wxArrayInt widths;
   int pos = 0;
-  if (m_kp != NULL && s.length())
+  if (m_metrics != NULL)
+  {
+    if (m_metrics->HasKerning() && s.length())
+    {
+      wxString::const_iterator ch = s.begin();
+      wxUint32 ch1 = m_metrics->GetGlyph((wxUint32) (*ch));
+      for (++ch; ch != s.end(); ++ch)
+      {
+        wxUint32 ch2 = m_metrics->GetGlyph((wxUint32) (*ch));
+        int kerning = m_metrics->GetKerning(ch1, ch2);
+        if (kerning != 0)
+        {
+          widths.Add(pos);
+          widths.Add(-kerning);
+        }
+        ch1 = ch2;
+        ++pos;
+      }
+    }
+  }
+  else if (m_kp != NULL && s.length())
   {
     wxPdfKernPairMap::const_iterator kpIter;
     wxPdfKernWidthMap::const_iterator kwIter;
@@ -688,7 +904,7 @@ wxPdfFontData::SetInitialized(bool initialized)
 }
 
 wxString
-wxPdfFontData::GetWidthsAsString(bool subset, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs) const
+wxPdfFontData::GetWidthsAsString(bool subset, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs) const
 {
   wxUnusedVar(subset);
   wxUnusedVar(usedGlyphs);
@@ -706,6 +922,44 @@ wxPdfFontData::GetStringWidth(const wxString& s, const wxPdfEncoding* encoding,
   return 0;
 }
 
+void
+wxPdfFontData::GetCharAdvances(const wxString& s, wxPdfArrayDouble& advances,
+                               const wxPdfEncoding* encoding, bool withKerning, double charSpacing) const
+{
+  advances.Empty();
+  advances.Alloc(s.length());
+
+  // Measure each distinct character only once
+  wxPdfCharAdvanceMap charAdvances;
+  wxPdfCharAdvanceMap::const_iterator advance;
+  wxString::const_iterator ch;
+  for (ch = s.begin(); ch != s.end(); ++ch)
+  {
+    wxUint32 c = (wxUint32) (*ch);
+    advance = charAdvances.find(c);
+    if (advance != charAdvances.end())
+    {
+      advances.Add(advance->second);
+    }
+    else
+    {
+      double charAdvance = GetStringWidth(wxString(*ch), encoding, false, charSpacing);
+      charAdvances[c] = charAdvance;
+      advances.Add(charAdvance);
+    }
+  }
+  if (withKerning)
+  {
+    // The kerning width array contains pairs of character index and negated kerning value
+    wxArrayInt kerning = GetKerningWidthArray(s);
+    size_t k;
+    for (k = 0; k + 1 < kerning.GetCount(); k += 2)
+    {
+      advances[kerning[k] + 1] -= kerning[k+1] / 1000.0;
+    }
+  }
+}
+
 bool
 wxPdfFontData::GetGlyphNames(wxArrayString& glyphNames) const
 {
@@ -714,7 +968,7 @@ wxPdfFontData::GetGlyphNames(wxArrayString& glyphNames) const
 }
 
 size_t
-wxPdfFontData::WriteFontData(wxOutputStream* fontData, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
+wxPdfFontData::WriteFontData(wxOutputStream* fontData, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
 {
   wxUnusedVar(fontData);
   wxUnusedVar(usedGlyphs);
@@ -724,7 +978,7 @@ wxPdfFontData::WriteFontData(wxOutputStream* fontData, wxPdfSortedArrayInt* used
 
 size_t
 wxPdfFontData::WriteUnicodeMap(wxOutputStream* mapData,
-                               const wxPdfEncoding* encoding, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
+                               const wxPdfEncoding* encoding, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
 {
   wxUnusedVar(mapData);
   wxUnusedVar(encoding);
@@ -735,7 +989,7 @@ wxPdfFontData::WriteUnicodeMap(wxOutputStream* mapData,
 
 size_t
 wxPdfFontData::WriteCIDToGIDMap(wxOutputStream* mapData,
-                                const wxPdfEncoding* encoding, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
+                                const wxPdfEncoding* encoding, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
 {
   wxUnusedVar(mapData);
   wxUnusedVar(encoding);
@@ -746,7 +1000,7 @@ wxPdfFontData::WriteCIDToGIDMap(wxOutputStream* mapData,
 
 size_t
 wxPdfFontData::WriteCIDSet(wxOutputStream* setData,
-                           const wxPdfEncoding* encoding, wxPdfSortedArrayInt* usedGlyphs,  wxPdfChar2GlyphMap* subsetGlyphs)
+                           const wxPdfEncoding* encoding, wxPdfGlyphSet* usedGlyphs,  wxPdfChar2GlyphMap* subsetGlyphs)
 {
   wxUnusedVar(setData);
   wxUnusedVar(encoding);
@@ -820,7 +1074,7 @@ wxPdfFontData::ConvertToValid(const wxString& s, wxUniChar replace) const
 wxString
 wxPdfFontData::ConvertCID2GID(const wxString& s,
                               const wxPdfEncoding* encoding,
-                              wxPdfSortedArrayInt* usedGlyphs,
+                              wxPdfGlyphSet* usedGlyphs,
                               wxPdfChar2GlyphMap* subsetGlyphs) const
 {
   // No conversion from cid to gid
@@ -833,7 +1087,7 @@ wxPdfFontData::ConvertCID2GID(const wxString& s,
 wxString
 wxPdfFontData::ConvertGlyph(wxUint32 glyph,
                             const wxPdfEncoding* encoding,
-                            wxPdfSortedArrayInt* usedGlyphs,
+                            wxPdfGlyphSet* usedGlyphs,
                             wxPdfChar2GlyphMap* subsetGlyphs) const
 {
   wxUnusedVar(glyph);
@@ -949,3 +1203,565 @@ wxPdfFontData::WriteToUnicode(wxPdfGlyphList& glyphs, wxMemoryOutputStream& toUn
   WriteStreamBuffer(toUnicode, "CMapName currentdict /CMap defineresource pop\n");
   WriteStreamBuffer(toUnicode, "end end\n");
 }
+
+// ----------------------------------------------------------------------------
+// wxPdfFontSubsetCache: persistent cache of compressed font subsets
+// ----------------------------------------------------------------------------
+
+#if wxUSE_THREADS
+static wxCriticalSection gs_csSubsetCache;
+static wxCriticalSection gs_csFontDigest;
+#endif
+
+static wxString     gs_subsetCacheDirectory;
+static wxFileOffset gs_subsetCacheMaxSize = 128 * 1024 * 1024;
+static size_t       gs_subsetCacheHits = 0;
+static size_t       gs_subsetCacheMisses = 0;
+// Estimated total size of the cache files, -1 if unknown. Files stored by other
+// processes are not counted until the next scan of the cache directory.
+static wxFileOffset gs_subsetCacheSize = -1;
+
+// A cache file consists of a header (magic, uncompressed size, compressed size and
+// number of glyphs as 64-bit little endian numbers), the glyphs contained in the
+// subset (as 32-bit little endian numbers) and the compressed font subset
+static const char   gs_subsetCacheMagic[8] = { 'w', 'x', 'P', 'd', 'f', 'S', 'C', '2' };
+static const size_t gs_subsetCacheHeaderSize = 32;
+
+// Stale temporary files of crashed processes are removed after one hour
+static const time_t gs_subsetCacheTempAge = 3600;
+
+static wxString
+SubsetCacheFileName(const wxString& directory, const wxString& key)
+{
+  return directory + wxFILE_SEP_PATH + key + wxS(".wxpdfsub");
+}
+
+static void
+SubsetCachePutUint64(unsigned char* buffer, wxUint64 value)
+{
+  int j;
+  for (j = 0; j < 8; ++j)
+  {
+    buffer[j] = (unsigned char) ((value >> (8 * j)) & 0xff);
+  }
+}
+
+static wxUint64
+SubsetCacheGetUint64(const unsigned char* buffer)
+{
+  wxUint64 value = 0;
+  int j;
+  for (j = 7; j >= 0; --j)
+  {
+    value = (value << 8) | buffer[j];
+  }
+  return value;
+}
+
+// Entry of the cache directory listing
+struct wxPdfSubsetCacheFile
+{
+  wxString     m_name;
+  time_t       m_modTime;
+  wxFileOffset m_size;
+};
+
+static bool
+SubsetCacheFileOlder(const wxPdfSubsetCacheFile& file1, const wxPdfSubsetCacheFile& file2)
+{
+  return file1.m_modTime < file2.m_modTime;
+}
+
+// Remove least recently used cache files until the size limit is met and
+// return the total size of the remaining cache files.
+// Several processes may do this concurrently; failing to remove a file
+// that is in use or was already removed is harmless.
+static wxFileOffset
+SubsetCacheShrink(const wxString& directory, wxFileOffset maxSize)
+{
+  wxArrayString fileNames;
+  wxDir::GetAllFiles(directory, &fileNames, wxS("*.wxpdfsub"), wxDIR_FILES);
+
+  std::vector<wxPdfSubsetCacheFile> files;
+  wxFileOffset totalSize = 0;
+  size_t j;
+  for (j = 0; j < fileNames.GetCount(); ++j)
+  {
+    wxFileName fileName(fileNames[j]);
+    wxDateTime modTime;
+    if (fileName.GetTimes(NULL, &modTime, NULL))
+    {
+      wxPdfSubsetCacheFile file;
+      file.m_name = fileNames[j];
+      file.m_modTime = modTime.GetTicks();
+      file.m_size = (wxFileOffset) fileName.GetSize().GetValue();
+      totalSize += file.m_size;
+      files.push_back(file);
+    }
+  }
+
+  if (totalSize > maxSize)
+  {
+    std::sort(files.begin(), files.end(), SubsetCacheFileOlder);
+    for (j = 0; j < files.size() && totalSize > maxSize; ++j)
+    {
+      if (wxRemoveFile(files[j].m_name))
+      {
+        totalSize -= files[j].m_size;
+      }
+    }
+  }
+
+  wxArrayString tempFileNames;
+  wxDir::GetAllFiles(directory, &tempFileNames, wxS("wxpdfsub_*"), wxDIR_FILES);
+  time_t now = wxDateTime::Now().GetTicks();
+  for (j = 0; j < tempFileNames.GetCount(); ++j)
+  {
+    wxDateTime modTime;
+    if (wxFileName(tempFileNames[j]).GetTimes(NULL, &modTime, NULL) &&
+        now - modTime.GetTicks() > gs_subsetCacheTempAge)
+    {
+      wxRemoveFile(tempFileNames[j]);
+    }
+  }
+  return totalSize;
+}
+
+// Record the scanned cache size, unless the cache directory was changed meanwhile
+static void
+SubsetCacheSetSize(const wxString& directory, wxFileOffset size)
+{
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csSubsetCache);
+#endif
+  if (gs_subsetCacheDirectory == directory)
+  {
+    gs_subsetCacheSize = size;
+  }
+}
+
+bool
+wxPdfFontSubsetCache::SetDirectory(const wxString& directory)
+{
+  wxString cacheDirectory = wxEmptyString;
+  bool ok = true;
+  if (!directory.IsEmpty())
+  {
+    wxFileName dirName = wxFileName::DirName(directory);
+    dirName.MakeAbsolute();
+    ok = dirName.DirExists() || dirName.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+    if (ok)
+    {
+      cacheDirectory = dirName.GetPath();
+    }
+    else
+    {
+      wxLogError(wxString(wxS("wxPdfFontSubsetCache::SetDirectory: ")) +
+                 wxString::Format(_("Cache directory '%s' could not be created."), directory.c_str()));
+    }
+  }
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csSubsetCache);
+#endif
+  gs_subsetCacheDirectory = cacheDirectory;
+  gs_subsetCacheSize = -1;
+  return ok;
+}
+
+wxString
+wxPdfFontSubsetCache::GetDirectory()
+{
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csSubsetCache);
+#endif
+  return gs_subsetCacheDirectory;
+}
+
+void
+wxPdfFontSubsetCache::SetMaxSize(wxFileOffset maxSize)
+{
+  wxString directory;
+  {
+#if wxUSE_THREADS
+    wxCriticalSectionLocker locker(gs_csSubsetCache);
+#endif
+    gs_subsetCacheMaxSize = (maxSize > 0) ? maxSize : 0;
+    directory = gs_subsetCacheDirectory;
+  }
+  if (!directory.IsEmpty())
+  {
+    wxLogNull logNull;
+    SubsetCacheSetSize(directory, SubsetCacheShrink(directory, (maxSize > 0) ? maxSize : 0));
+  }
+}
+
+wxFileOffset
+wxPdfFontSubsetCache::GetMaxSize()
+{
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csSubsetCache);
+#endif
+  return gs_subsetCacheMaxSize;
+}
+
+size_t
+wxPdfFontSubsetCache::GetHitCount()
+{
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csSubsetCache);
+#endif
+  return gs_subsetCacheHits;
+}
+
+size_t
+wxPdfFontSubsetCache::GetMissCount()
+{
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csSubsetCache);
+#endif
+  return gs_subsetCacheMisses;
+}
+
+void
+wxPdfFontSubsetCache::Clear()
+{
+  wxString directory;
+  {
+#if wxUSE_THREADS
+    wxCriticalSectionLocker locker(gs_csSubsetCache);
+#endif
+    gs_subsetCacheHits = 0;
+    gs_subsetCacheMisses = 0;
+    directory = gs_subsetCacheDirectory;
+  }
+  if (!directory.IsEmpty())
+  {
+    wxLogNull logNull;
+    SubsetCacheSetSize(directory, SubsetCacheShrink(directory, 0));
+  }
+}
+
+bool
+wxPdfFontSubsetCache::Load(const wxString& key, wxOutputStream* fontData, size_t& fontSize1,
+                           wxPdfGlyphSet* usedGlyphs)
+{
+  wxString directory = GetDirectory();
+  if (directory.IsEmpty() || key.IsEmpty())
+  {
+    return false;
+  }
+
+  bool found = false;
+  wxString cacheFileName = SubsetCacheFileName(directory, key);
+  if (wxFileName::FileExists(cacheFileName))
+  {
+    // The cache is best effort, failures are not reported
+    wxLogNull logNull;
+    wxFile cacheFile;
+    if (cacheFile.Open(cacheFileName, wxFile::read))
+    {
+      unsigned char header[gs_subsetCacheHeaderSize];
+      wxFileOffset fileLength = cacheFile.Length();
+      if (fileLength >= (wxFileOffset) gs_subsetCacheHeaderSize &&
+          cacheFile.Read(header, gs_subsetCacheHeaderSize) == (ssize_t) gs_subsetCacheHeaderSize &&
+          memcmp(header, gs_subsetCacheMagic, sizeof(gs_subsetCacheMagic)) == 0)
+      {
+        wxUint64 size1 = SubsetCacheGetUint64(header + 8);
+        wxUint64 dataLength = SubsetCacheGetUint64(header + 16);
+        wxUint64 numGlyphs = SubsetCacheGetUint64(header + 24);
+        wxUint64 length = 4 * numGlyphs + dataLength;
+        if (numGlyphs <= 0x10000 && length == (wxUint64) (fileLength - gs_subsetCacheHeaderSize))
+        {
+          wxMemoryBuffer buffer((size_t) length);
+          unsigned char* data = (unsigned char*) buffer.GetWriteBuf((size_t) length);
+          if (cacheFile.Read(data, (size_t) length) == (ssize_t) length)
+          {
+            // Subsetting may add glyph components to the used glyphs
+            if (usedGlyphs != NULL)
+            {
+              size_t j;
+              for (j = 0; j < (size_t) numGlyphs; ++j)
+              {
+                wxUint32 glyph = data[4*j] | (data[4*j+1] << 8) | (data[4*j+2] << 16) | ((wxUint32) data[4*j+3] << 24);
+                usedGlyphs->Add(glyph);
+              }
+            }
+            fontData->Write(data + 4 * numGlyphs, (size_t) dataLength);
+            fontSize1 = (size_t) size1;
+            found = true;
+          }
+        }
+      }
+      cacheFile.Close();
+    }
+    if (found)
+    {
+      // Mark the cache file as recently used
+      wxFileName(cacheFileName).Touch();
+    }
+  }
+
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csSubsetCache);
+#endif
+  if (found)
+  {
+    ++gs_subsetCacheHits;
+  }
+  else
+  {
+    ++gs_subsetCacheMisses;
+  }
+  return found;
+}
+
+void
+wxPdfFontSubsetCache::Store(const wxString& key, const wxMemoryOutputStream& fontData, size_t fontSize1,
+                            wxPdfGlyphSet* usedGlyphs)
+{
+  wxString directory;
+  wxFileOffset maxSize;
+  {
+#if wxUSE_THREADS
+    wxCriticalSectionLocker locker(gs_csSubsetCache);
+#endif
+    directory = gs_subsetCacheDirectory;
+    maxSize = gs_subsetCacheMaxSize;
+  }
+  size_t dataLength = (size_t) fontData.GetLength();
+  size_t numGlyphs = (usedGlyphs != NULL) ? usedGlyphs->GetCount() : 0;
+  wxFileOffset fileSize = (wxFileOffset) (dataLength + 4 * numGlyphs + gs_subsetCacheHeaderSize);
+  if (directory.IsEmpty() || key.IsEmpty() || fileSize > maxSize)
+  {
+    return;
+  }
+
+  // The cache is best effort, failures are not reported
+  wxLogNull logNull;
+  wxFile tempFile;
+  wxString tempFileName = wxFileName::CreateTempFileName(directory + wxFILE_SEP_PATH + wxS("wxpdfsub_"), &tempFile);
+  if (tempFileName.IsEmpty())
+  {
+    return;
+  }
+
+  unsigned char header[gs_subsetCacheHeaderSize];
+  memcpy(header, gs_subsetCacheMagic, sizeof(gs_subsetCacheMagic));
+  SubsetCachePutUint64(header + 8, fontSize1);
+  SubsetCachePutUint64(header + 16, dataLength);
+  SubsetCachePutUint64(header + 24, numGlyphs);
+  wxMemoryBuffer glyphBuffer(4 * numGlyphs + 1);
+  unsigned char* glyphs = (unsigned char*) glyphBuffer.GetWriteBuf(4 * numGlyphs + 1);
+  size_t j = 0;
+  int glyph;
+  for (glyph = (usedGlyphs != NULL) ? usedGlyphs->FindNext(0) : wxNOT_FOUND;
+       glyph != wxNOT_FOUND; glyph = usedGlyphs->FindNext(glyph + 1), ++j)
+  {
+    glyphs[4*j]   = (unsigned char) (glyph & 0xff);
+    glyphs[4*j+1] = (unsigned char) ((glyph >> 8) & 0xff);
+    glyphs[4*j+2] = (unsigned char) ((glyph >> 16) & 0xff);
+    glyphs[4*j+3] = (unsigned char) ((glyph >> 24) & 0xff);
+  }
+  bool ok = tempFile.Write(header, gs_subsetCacheHeaderSize) == gs_subsetCacheHeaderSize &&
+            tempFile.Write(glyphs, 4 * numGlyphs) == 4 * numGlyphs &&
+            tempFile.Write(fontData.GetOutputStreamBuffer()->GetBufferStart(), dataLength) == dataLength;
+  ok = tempFile.Close() && ok;
+
+  // Renaming is atomic, so that other processes see either no file or the complete file
+  if (!ok || !wxRenameFile(tempFileName, SubsetCacheFileName(directory, key), true))
+  {
+    wxRemoveFile(tempFileName);
+    return;
+  }
+
+  // Scanning the cache directory is expensive, so it is only done to determine
+  // the initial cache size and once the estimated size exceeds the limit
+  bool shrink = false;
+  {
+#if wxUSE_THREADS
+    wxCriticalSectionLocker locker(gs_csSubsetCache);
+#endif
+    if (gs_subsetCacheDirectory == directory)
+    {
+      if (gs_subsetCacheSize >= 0)
+      {
+        gs_subsetCacheSize += fileSize;
+      }
+      shrink = gs_subsetCacheSize < 0 || gs_subsetCacheSize > maxSize;
+    }
+  }
+  if (shrink)
+  {
+    SubsetCacheSetSize(directory, SubsetCacheShrink(directory, maxSize));
+  }
+}
+
+static void
+DigestAdd(wxpdfdoc::crypto::sha256_state& md, const void* data, size_t length)
+{
+  const unsigned char* p = (const unsigned char*) data;
+  while (length > 0)
+  {
+    std::uint32_t chunk = (length > 0x40000000) ? 0x40000000 : (std::uint32_t) length;
+    wxpdfdoc::crypto::sha_process(md, p, chunk);
+    p += chunk;
+    length -= chunk;
+  }
+}
+
+static void
+DigestAdd(wxpdfdoc::crypto::sha256_state& md, const wxString& value)
+{
+  wxCharBuffer buffer = value.utf8_str();
+  size_t length = strlen(buffer.data());
+  DigestAdd(md, &length, sizeof(length));
+  DigestAdd(md, buffer.data(), length);
+}
+
+static wxString
+DigestDone(wxpdfdoc::crypto::sha256_state& md)
+{
+  unsigned char digest[32];
+  wxpdfdoc::crypto::sha_done(md, digest);
+
+  static const char hexDigits[] = "0123456789abcdef";
+  char hexDigest[65];
+  size_t j;
+  for (j = 0; j < 32; ++j)
+  {
+    hexDigest[2*j]   = hexDigits[digest[j] >> 4];
+    hexDigest[2*j+1] = hexDigits[digest[j] & 0x0f];
+  }
+  hexDigest[64] = 0;
+  return wxString::FromAscii(hexDigest);
+}
+
+wxString
+wxPdfFontData::GetSubsetCacheKey(wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
+{
+  if (usedGlyphs == NULL || wxPdfFontSubsetCache::GetDirectory().IsEmpty())
+  {
+    return wxEmptyString;
+  }
+
+  // Identify the font program
+  wxString fontId;
+  if (m_fontBuffer && m_fontBufferSize > 0)
+  {
+    // Font data are shared between documents and threads; the digest is
+    // computed outside the lock, the first result is kept
+    wxString digest;
+    {
+#if wxUSE_THREADS
+      wxCriticalSectionLocker locker(gs_csFontDigest);
+#endif
+      digest = m_fontDigest;
+    }
+    if (digest.IsEmpty())
+    {
+      wxpdfdoc::crypto::sha256_state md;
+      wxpdfdoc::crypto::sha_init(md);
+      DigestAdd(md, m_fontBuffer, m_fontBufferSize);
+      digest = DigestDone(md);
+#if wxUSE_THREADS
+      wxCriticalSectionLocker locker(gs_csFontDigest);
+#endif
+      if (m_fontDigest.IsEmpty())
+      {
+        m_fontDigest = digest;
+      }
+    }
+    fontId = wxS("buffer:") + digest;
+  }
+  else
+  {
+    wxFileName fileName;
+    if (!m_fontFileName.IsEmpty())
+    {
+      fileName = m_fontFileName;
+    }
+    else if (!m_file.IsEmpty())
+    {
+      fileName = m_file;
+      fileName.MakeAbsolute(m_path);
+    }
+    wxDateTime modTime;
+    if (!fileName.IsOk() || !fileName.GetTimes(NULL, &modTime, NULL))
+    {
+      // Fonts retrieved via the operating system are not cached
+      return wxEmptyString;
+    }
+    fileName.MakeAbsolute();
+    fontId = wxS("file:") + fileName.GetFullPath() + wxS("|") +
+             modTime.GetValue().ToString() + wxS("|") + fileName.GetSize().ToString();
+  }
+
+  wxpdfdoc::crypto::sha256_state md;
+  wxpdfdoc::crypto::sha_init(md);
+  DigestAdd(md, wxString(wxS("wxPdfFontSubset 1")));
+  DigestAdd(md, fontId);
+  DigestAdd(md, m_type);
+  int fontIndex = m_fontIndex;
+  DigestAdd(md, &fontIndex, sizeof(fontIndex));
+
+  // Add the glyphs in the order they appear in the subset
+  std::vector<wxUint32> glyphs;
+  if (subsetGlyphs != NULL)
+  {
+    glyphs.resize(subsetGlyphs->size(), 0);
+    wxPdfChar2GlyphMap::const_iterator glyphIter;
+    for (glyphIter = subsetGlyphs->begin(); glyphIter != subsetGlyphs->end(); ++glyphIter)
+    {
+      if (glyphIter->second < glyphs.size())
+      {
+        glyphs[glyphIter->second] = glyphIter->first;
+      }
+    }
+  }
+  else
+  {
+    glyphs.reserve(usedGlyphs->GetCount());
+    int glyph;
+    for (glyph = usedGlyphs->FindNext(0); glyph != wxNOT_FOUND; glyph = usedGlyphs->FindNext(glyph + 1))
+    {
+      glyphs.push_back((wxUint32) glyph);
+    }
+  }
+  size_t numGlyphs = glyphs.size();
+  DigestAdd(md, &numGlyphs, sizeof(numGlyphs));
+  if (numGlyphs > 0)
+  {
+    DigestAdd(md, &glyphs[0], numGlyphs * sizeof(wxUint32));
+  }
+  return DigestDone(md);
+}
+
+size_t
+wxPdfFontData::WriteSubsetData(wxOutputStream* fontData, wxMemoryOutputStream* subsetStream,
+                               const wxString& cacheKey, wxPdfGlyphSet* usedGlyphs)
+{
+  size_t fontSize1 = 0;
+  if (subsetStream != NULL)
+  {
+    wxMemoryInputStream tmp(*subsetStream);
+    fontSize1 = tmp.GetSize();
+    if (cacheKey.IsEmpty())
+    {
+      wxZlibOutputStream zFontData(*fontData);
+      zFontData.Write(tmp);
+      zFontData.Close();
+    }
+    else
+    {
+      wxMemoryOutputStream compressed;
+      {
+        wxZlibOutputStream zFontData(compressed);
+        zFontData.Write(tmp);
+        zFontData.Close();
+      }
+      wxPdfFontSubsetCache::Store(cacheKey, compressed, fontSize1, usedGlyphs);
+      fontData->Write(compressed.GetOutputStreamBuffer()->GetBufferStart(), (size_t) compressed.GetLength());
+    }
+  }
+  return fontSize1;
+}
@@ -79,6 +79,7 @@ wxPdfFontDataCore::wxPdfFontDataCore(const wxString& family, const wxString& ali
     }
   }
 
+  CreateMetricsTable();
   m_initialized = true;
 }
 
@@ -87,7 +88,7 @@ wxPdfFontDataCore::~wxPdfFontDataCore()
 }
 
 wxString
-wxPdfFontDataCore::GetWidthsAsString(bool subset, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs) const
+wxPdfFontDataCore::GetWidthsAsString(bool subset, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs) const
 {
   wxUnusedVar(subset);
   wxUnusedVar(usedGlyphs);
@@ -123,7 +124,11 @@ wxPdfFontDataCore::GetStringWidth(const wxString& s, const wxPdfEncoding* encodi
   wxString::const_iterator ch;
   for (ch = t.begin(); ch != t.end(); ++ch)
   {
-    w += (*m_cw)[*ch];
+    int charWidth = FindCharWidth((wxUint32) (*ch));
+    if (charWidth > 0)
+    {
+      w += charWidth;
+    }
     ++glyphCount;
   }
   if (withKerning)
@@ -169,7 +174,7 @@ wxPdfFontDataCore::CanShow(const wxString& s, const wxPdfEncoding* encoding) con
 wxString
 wxPdfFontDataCore::ConvertCID2GID(const wxString& s,
                                   const wxPdfEncoding* encoding,
-                                  wxPdfSortedArrayInt* usedGlyphs,
+                                  wxPdfGlyphSet* usedGlyphs,
                                   wxPdfChar2GlyphMap* subsetGlyphs) const
 {
   // No conversion from cid to gid
@@ -250,6 +250,10 @@ wxPdfFontDataOpenTypeUnicode::LoadFontMetrics(wxXmlNode* root)
       delete [] cc2gn;
     }
   }
+  if (m_initialized)
+  {
+    CreateMetricsTable();
+  }
   return m_initialized;
 }
 
@@ -262,6 +266,10 @@ wxPdfFontDataOpenTypeUnicode::Initialize()
     wxPdfFontParserTrueType fontParser;
     ok = fontParser.LoadFontData(this);
     m_initialized = ok;
+    if (ok)
+    {
+      CreateMetricsTable();
+    }
   }
   return ok;
 }
@@ -284,20 +292,11 @@ wxPdfFontDataOpenTypeUnicode::GetStringWidth(const wxString& s, const wxPdfEncod
   int glyphCount = 0;
   double w = 0;
 
-  wxPdfGlyphWidthMap::iterator charIter;
   wxString::const_iterator ch;
   for (ch = s.begin(); ch != s.end(); ++ch)
   {
-    wxUniChar c = *ch;
-    charIter = m_cw->find(c);
-    if (charIter != m_cw->end())
-    {
-      w += charIter->second;
-    }
-    else
-    {
-      w += m_desc.GetMissingWidth();
-    }
+    int charWidth = FindCharWidth((wxUint32) (*ch));
+    w += (charWidth >= 0) ? charWidth : m_desc.GetMissingWidth();
     ++glyphCount;
   }
   if (withKerning)
@@ -331,7 +330,7 @@ wxPdfFontDataOpenTypeUnicode::CanShow(const wxString& s, const wxPdfEncoding* en
 wxString
 wxPdfFontDataOpenTypeUnicode::ConvertCID2GID(const wxString& s,
                                              const wxPdfEncoding* encoding,
-                                             wxPdfSortedArrayInt* usedGlyphs,
+                                             wxPdfGlyphSet* usedGlyphs,
                                              wxPdfChar2GlyphMap* subsetGlyphs) const
 {
   wxUnusedVar(encoding);
@@ -348,7 +347,7 @@ wxPdfFontDataOpenTypeUnicode::ConvertCID2GID(const wxString& s,
       glyph = charIter->second;
       if (doSubsetting)
       {
-        if (usedGlyphs->Index(glyph) != wxNOT_FOUND)
+        if (usedGlyphs->Contains(glyph))
         {
           glyph = (*subsetGlyphs)[glyph];
         }
@@ -373,7 +372,7 @@ wxPdfFontDataOpenTypeUnicode::ConvertCID2GID(const wxString& s,
 wxString
 wxPdfFontDataOpenTypeUnicode::ConvertGlyph(wxUint32 glyph,
                                            const wxPdfEncoding* encoding,
-                                           wxPdfSortedArrayInt* usedGlyphs,
+                                           wxPdfGlyphSet* usedGlyphs,
                                            wxPdfChar2GlyphMap* subsetGlyphs) const
 {
   wxUnusedVar(encoding);
@@ -384,7 +383,7 @@ wxPdfFontDataOpenTypeUnicode::ConvertGlyph(wxUint32 glyph,
     wxUint32 subsetGlyph;
     if (doSubsetting)
     {
-      if (usedGlyphs->Index(glyph) != wxNOT_FOUND)
+      if (usedGlyphs->Contains(glyph))
       {
         glyph = (*subsetGlyphs)[glyph];
       }
@@ -406,7 +405,7 @@ wxPdfFontDataOpenTypeUnicode::ConvertGlyph(wxUint32 glyph,
 }
 
 wxString
-wxPdfFontDataOpenTypeUnicode::GetWidthsAsString(bool subset, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs) const
+wxPdfFontDataOpenTypeUnicode::GetWidthsAsString(bool subset, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs) const
 {
   wxString s = wxString(wxS("["));
   wxUint32 glyph;
@@ -424,7 +423,7 @@ wxPdfFontDataOpenTypeUnicode::GetWidthsAsString(bool subset, wxPdfSortedArrayInt
       glyph = 0;
     }
     if (glyph != 0 && (!subset || !usedGlyphs ||
-                       (subset && SubsetSupported() && (usedGlyphs->Index(glyph) != wxNOT_FOUND))))
+                       (subset && SubsetSupported() && usedGlyphs->Contains(glyph))))
     {
       if (subset)
       {
@@ -439,7 +438,7 @@ wxPdfFontDataOpenTypeUnicode::GetWidthsAsString(bool subset, wxPdfSortedArrayInt
 }
 
 size_t
-wxPdfFontDataOpenTypeUnicode::WriteFontData(wxOutputStream* fontData, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
+wxPdfFontDataOpenTypeUnicode::WriteFontData(wxOutputStream* fontData, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
 {
 #if defined(__WXMAC__)
 #if wxPDFMACOSX_HAS_CORE_TEXT
@@ -453,6 +452,14 @@ wxPdfFontDataOpenTypeUnicode::WriteFontData(wxOutputStream* fontData, wxPdfSorte
   bool compressed = false;
   wxFileName fileName;
   wxString fontFullPath = wxEmptyString;
+  const char* mappedData = nullptr;
+
+  // Reuse a previously created subset, if available
+  wxString cacheKey = GetSubsetCacheKey(usedGlyphs, subsetGlyphs);
+  if (!cacheKey.IsEmpty() && wxPdfFontSubsetCache::Load(cacheKey, fontData, fontSize1, usedGlyphs))
+  {
+    return fontSize1;
+  }
 
   if (m_fontBuffer && m_fontBufferSize > 0)
   {
@@ -497,9 +504,33 @@ wxPdfFontDataOpenTypeUnicode::WriteFontData(wxOutputStream* fontData, wxPdfSorte
 
     if (fileName.IsOk())
     {
+      // Map the font file into memory, if possible; WOFF files are decoded from a file stream
+      wxString fileExt = fileName.GetExt().Lower();
+      if (!fileExt.IsSameAs(wxS("woff")) && !fileExt.IsSameAs(wxS("woff2")))
+      {
+        fontStream = GetMappedFontStream(fileName.GetFullPath());
+        deleteFontStream = (fontStream != nullptr);
+        fontFullPath = fileName.GetFullPath();
+        if (fontStream != nullptr && !compressed)
+        {
+          // The CFF table is accessed directly only if it lies within the mapped file,
+          // otherwise it is read from the stream, which stops at the end of the file
+          size_t fileLength = m_mappedFile->GetLength();
+          if (m_cffOffset <= fileLength && m_cffLength <= fileLength - m_cffOffset)
+          {
+            mappedData = m_mappedFile->GetData();
+          }
+          else
+          {
+            wxLogError(wxString(wxS("wxPdfFontDataOpenTypeUnicode::WriteFontData: ")) +
+                       wxString::Format(_("The CFF table exceeds the end of font file '%s'."), fileName.GetFullPath().c_str()));
+          }
+        }
+      }
+
       // Open font file
       wxFileSystem fs;
-      fontFile = fs.OpenFile(wxFileSystem::FileNameToURL(fileName));
+      fontFile = (fontStream == nullptr) ? fs.OpenFile(wxFileSystem::FileNameToURL(fileName)) : nullptr;
       if (fontFile)
       {
         bool isWoff = false;
@@ -530,7 +561,7 @@ wxPdfFontDataOpenTypeUnicode::WriteFontData(wxOutputStream* fontData, wxPdfSorte
           }
         }
       }
-      else
+      else if (fontStream == nullptr)
       {
         // usually this should not happen since file accessibility was already checked
         wxLogError(wxString(wxS("wxPdfFontDataOpenTypeUnicode::WriteFontData: ")) +
@@ -556,6 +587,12 @@ wxPdfFontDataOpenTypeUnicode::WriteFontData(wxOutputStream* fontData, wxPdfSorte
         }
         fontStream = new wxMemoryInputStream(zUncompressed);
       }
+      else if (mappedData != nullptr)
+      {
+        // Access the CFF stream in the mapped font file directly
+        delete fontStream;
+        fontStream = new wxMemoryInputStream(mappedData + m_cffOffset, m_cffLength);
+      }
       else
       {
         // Extract CFF stream from font file
@@ -582,16 +619,19 @@ wxPdfFontDataOpenTypeUnicode::WriteFontData(wxOutputStream* fontData, wxPdfSorte
       }
 
       // Write font subset data
-      wxZlibOutputStream zFontData(*fontData);
-      wxMemoryInputStream tmp(*subsetStream);
-      fontSize1 = tmp.GetSize();
-      zFontData.Write(tmp);
-      zFontData.Close();
+      fontSize1 = WriteSubsetData(fontData, subsetStream, cacheKey, usedGlyphs);
       delete subsetStream;
     }
     else
     {
-      if (!compressed)
+      if (!compressed && mappedData != nullptr)
+      {
+        // Compress the CFF stream directly from the mapped font file
+        wxZlibOutputStream zFontData(*fontData);
+        zFontData.Write(mappedData + m_cffOffset, m_cffLength);
+        zFontData.Close();
+      }
+      else if (!compressed)
       {
         // Extract CFF stream from font file
         char* buffer = new char[m_cffLength];
@@ -607,6 +647,10 @@ wxPdfFontDataOpenTypeUnicode::WriteFontData(wxOutputStream* fontData, wxPdfSorte
         fontSize1 = GetSize1();
         fontData->Write(*fontStream);
       }
+      if (deleteFontStream)
+      {
+        delete fontStream;
+      }
     }
   }
 
@@ -621,7 +665,7 @@ wxPdfFontDataOpenTypeUnicode::WriteFontData(wxOutputStream* fontData, wxPdfSorte
 size_t
 wxPdfFontDataOpenTypeUnicode::WriteUnicodeMap(wxOutputStream* mapData,
                                               const wxPdfEncoding* encoding,
-                                              wxPdfSortedArrayInt* usedGlyphs,
+                                              wxPdfGlyphSet* usedGlyphs,
                                               wxPdfChar2GlyphMap* subsetGlyphs)
 {
   wxUnusedVar(encoding);
@@ -631,8 +675,7 @@ wxPdfFontDataOpenTypeUnicode::WriteUnicodeMap(wxOutputStream* mapData,
   {
     if (usedGlyphs)
     {
-      int usedGlyphIndex = usedGlyphs->Index(charIter->second);
-      if (usedGlyphIndex != wxNOT_FOUND)
+      if (usedGlyphs->Contains(charIter->second))
       {
         wxPdfGlyphListEntry* glEntry = new wxPdfGlyphListEntry();
         if (subsetGlyphs)
@@ -670,7 +713,7 @@ wxPdfFontDataOpenTypeUnicode::WriteUnicodeMap(wxOutputStream* mapData,
 size_t
 wxPdfFontDataOpenTypeUnicode::WriteCIDSet(wxOutputStream* setData,
   const wxPdfEncoding* encoding,
-  wxPdfSortedArrayInt* usedGlyphs,
+  wxPdfGlyphSet* usedGlyphs,
   wxPdfChar2GlyphMap* subsetGlyphs)
 {
   wxUnusedVar(encoding);
@@ -181,6 +181,10 @@ wxPdfFontDataTrueType::LoadFontMetrics(wxXmlNode* root)
     wxFileName fileName(m_file);
     m_initialized = fileName.MakeAbsolute(m_path) && fileName.FileExists() && fileName.IsFileReadable();
   }
+  if (m_initialized)
+  {
+    CreateMetricsTable();
+  }
   return m_initialized;
 }
 
@@ -199,19 +203,11 @@ wxPdfFontDataTrueType::GetStringWidth(const wxString& s, const wxPdfEncoding* en
   const char* str = s.c_str();
 #endif
 
-  wxPdfGlyphWidthMap::iterator charIter;
   size_t i;
   for (i = 0; i < s.Length(); i++)
   {
-    charIter = m_cw->find((unsigned char) str[i]);
-    if (charIter != m_cw->end())
-    {
-      w += charIter->second;
-    }
-    else
-    {
-      w += m_desc.GetMissingWidth();
-    }
+    int charWidth = FindCharWidth((unsigned char) str[i]);
+    w += (charWidth >= 0) ? charWidth : m_desc.GetMissingWidth();
     ++glyphCount;
   }
   if (withKerning)
@@ -245,7 +241,7 @@ wxPdfFontDataTrueType::CanShow(const wxString& s, const wxPdfEncoding* encoding)
 wxString
 wxPdfFontDataTrueType::ConvertCID2GID(const wxString& s,
                                       const wxPdfEncoding* encoding,
-                                      wxPdfSortedArrayInt* usedGlyphs,
+                                      wxPdfGlyphSet* usedGlyphs,
                                       wxPdfChar2GlyphMap* subsetGlyphs) const
 {
   wxUnusedVar(encoding);
@@ -276,10 +272,7 @@ wxPdfFontDataTrueType::ConvertCID2GID(const wxString& s,
       glyphIter = m_gn->find(ch);
       if (glyphIter != m_gn->end())
       {
-        if (usedGlyphs->Index(glyphIter->second) == wxNOT_FOUND)
-        {
-          usedGlyphs->Add(glyphIter->second);
-        }
+        usedGlyphs->Add(glyphIter->second);
       }
     }
     delete [] mbstr;
@@ -288,7 +281,7 @@ wxPdfFontDataTrueType::ConvertCID2GID(const wxString& s,
 }
 
 wxString
-wxPdfFontDataTrueType::GetWidthsAsString(bool subset, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs) const
+wxPdfFontDataTrueType::GetWidthsAsString(bool subset, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs) const
 {
   wxUnusedVar(subset);
   wxUnusedVar(usedGlyphs);
@@ -304,7 +297,7 @@ wxPdfFontDataTrueType::GetWidthsAsString(bool subset, wxPdfSortedArrayInt* usedG
 }
 
 size_t
-wxPdfFontDataTrueType::WriteFontData(wxOutputStream* fontData, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
+wxPdfFontDataTrueType::WriteFontData(wxOutputStream* fontData, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
 {
   wxUnusedVar(subsetGlyphs);
   wxFSFile* fontFile = nullptr;
@@ -314,6 +307,13 @@ wxPdfFontDataTrueType::WriteFontData(wxOutputStream* fontData, wxPdfSortedArrayI
   size_t fontSize1 = 0;
   bool compressed = false;
 
+  // Reuse a previously created subset, if available
+  wxString cacheKey = GetSubsetCacheKey(usedGlyphs);
+  if (!cacheKey.IsEmpty() && wxPdfFontSubsetCache::Load(cacheKey, fontData, fontSize1, usedGlyphs))
+  {
+    return fontSize1;
+  }
+
   if (m_fontBuffer && m_fontBufferSize > 0)
   {
     deleteFontStream = true;
@@ -333,9 +333,17 @@ wxPdfFontDataTrueType::WriteFontData(wxOutputStream* fontData, wxPdfSortedArrayI
       fileName = m_fontFileName;
     }
 
+    // Map the font file into memory, if possible; WOFF files are decoded from a file stream
+    wxString fileExt = fileName.GetExt().Lower();
+    if (!fileExt.IsSameAs(wxS("woff")) && !fileExt.IsSameAs(wxS("woff2")))
+    {
+      fontStream = GetMappedFontStream(fileName.GetFullPath());
+      deleteFontStream = (fontStream != nullptr);
+    }
+
     // Open font file
     wxFileSystem fs;
-    fontFile = fs.OpenFile(wxFileSystem::FileNameToURL(fileName));
+    fontFile = (fontStream == nullptr) ? fs.OpenFile(wxFileSystem::FileNameToURL(fileName)) : nullptr;
     if (fontFile)
     {
       bool isWoff = false;
@@ -367,7 +375,7 @@ wxPdfFontDataTrueType::WriteFontData(wxOutputStream* fontData, wxPdfSortedArrayI
         }
       }
     }
-    else
+    else if (fontStream == nullptr)
     {
       // usually this should not happen since file accessibility was already checked
       wxLogError(wxString(wxS("wxPdfFontDataTrueType::WriteFontData: ")) +
@@ -404,11 +412,7 @@ wxPdfFontDataTrueType::WriteFontData(wxOutputStream* fontData, wxPdfSortedArrayI
       }
 
       // Write font subset data
-      wxZlibOutputStream zFontData(*fontData);
-      wxMemoryInputStream tmp(*subsetStream);
-      fontSize1 = tmp.GetSize();
-      zFontData.Write(tmp);
-      zFontData.Close();
+      fontSize1 = WriteSubsetData(fontData, subsetStream, cacheKey, usedGlyphs);
       delete subsetStream;
     }
     else
@@ -425,6 +429,10 @@ wxPdfFontDataTrueType::WriteFontData(wxOutputStream* fontData, wxPdfSortedArrayI
         fontSize1 = GetSize1();
         fontData->Write(*fontStream);
       }
+      if (deleteFontStream)
+      {
+        delete fontStream;
+      }
     }
   }
 
@@ -643,6 +651,10 @@ wxPdfFontDataTrueTypeUnicode::LoadFontMetrics(wxXmlNode* root)
       delete [] cc2gn;
     }
   }
+  if (m_initialized)
+  {
+    CreateMetricsTable();
+  }
   return m_initialized;
 }
 
@@ -655,6 +667,10 @@ wxPdfFontDataTrueTypeUnicode::Initialize()
     wxPdfFontParserTrueType fontParser;
     ok = fontParser.LoadFontData(this);
     m_initialized = ok;
+    if (ok)
+    {
+      CreateMetricsTable();
+    }
   }
   return ok;
 }
@@ -683,19 +699,11 @@ wxPdfFontDataTrueTypeUnicode::GetStringWidth(const wxString& s, const wxPdfEncod
   int glyphCount = 0;
   double w = 0;
 
-  wxPdfGlyphWidthMap::iterator charIter;
-  size_t i;
-  for (i = 0; i < s.Length(); i++)
+  wxString::const_iterator ch;
+  for (ch = s.begin(); ch != s.end(); ++ch)
   {
-    charIter = m_cw->find(s[i]);
-    if (charIter != m_cw->end())
-    {
-      w += charIter->second;
-    }
-    else
-    {
-      w += m_desc.GetMissingWidth();
-    }
+    int charWidth = FindCharWidth((wxUint32) (*ch));
+    w += (charWidth >= 0) ? charWidth : m_desc.GetMissingWidth();
     ++glyphCount;
   }
   if (withKerning)
@@ -729,7 +737,7 @@ wxPdfFontDataTrueTypeUnicode::CanShow(const wxString& s, const wxPdfEncoding* en
 wxString
 wxPdfFontDataTrueTypeUnicode::ConvertCID2GID(const wxString& s,
                                              const wxPdfEncoding* encoding,
-                                             wxPdfSortedArrayInt* usedGlyphs,
+                                             wxPdfGlyphSet* usedGlyphs,
                                              wxPdfChar2GlyphMap* subsetGlyphs) const
 {
   wxUnusedVar(encoding);
@@ -775,10 +783,7 @@ wxPdfFontDataTrueTypeUnicode::ConvertCID2GID(const wxString& s,
       glyph = charIter->second;
       if (doSubsetting)
       {
-        if (usedGlyphs->Index(glyph) == wxNOT_FOUND)
-        {
-          usedGlyphs->Add(glyph);
-        }
+        usedGlyphs->Add(glyph);
       }
       t.Append(wxUniChar(glyph));
     }
@@ -793,7 +798,7 @@ wxPdfFontDataTrueTypeUnicode::ConvertCID2GID(const wxString& s,
 wxString
 wxPdfFontDataTrueTypeUnicode::ConvertGlyph(wxUint32 glyph,
                                            const wxPdfEncoding* encoding,
-                                           wxPdfSortedArrayInt* usedGlyphs,
+                                           wxPdfGlyphSet* usedGlyphs,
                                            wxPdfChar2GlyphMap* subsetGlyphs) const
 {
   wxUnusedVar(encoding);
@@ -804,10 +809,7 @@ wxPdfFontDataTrueTypeUnicode::ConvertGlyph(wxUint32 glyph,
     bool doSubsetting = usedGlyphs;
     if (doSubsetting)
     {
-      if (usedGlyphs->Index(glyph) == wxNOT_FOUND)
-      {
-        usedGlyphs->Add(glyph);
-      }
+      usedGlyphs->Add(glyph);
     }
     t.Append(wxUniChar(glyph));
   }
@@ -819,7 +821,7 @@ wxPdfFontDataTrueTypeUnicode::ConvertGlyph(wxUint32 glyph,
 }
 
 wxString
-wxPdfFontDataTrueTypeUnicode::GetWidthsAsString(bool subset, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs) const
+wxPdfFontDataTrueTypeUnicode::GetWidthsAsString(bool subset, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs) const
 {
   wxUnusedVar(subsetGlyphs);
   wxString s = wxString(wxS("["));
@@ -838,7 +840,7 @@ wxPdfFontDataTrueTypeUnicode::GetWidthsAsString(bool subset, wxPdfSortedArrayInt
       glyph = 0;
     }
     if (glyph != 0 && (!subset || !usedGlyphs ||
-                       (subset && SubsetSupported() && (usedGlyphs->Index(glyph) != wxNOT_FOUND))))
+                       (subset && SubsetSupported() && usedGlyphs->Contains(glyph))))
     {
       // define a specific width for each individual CID
       s += wxString::Format(wxS("%u [%u] "), glyph, charIter->second);
@@ -849,7 +851,7 @@ wxPdfFontDataTrueTypeUnicode::GetWidthsAsString(bool subset, wxPdfSortedArrayInt
 }
 
 size_t
-wxPdfFontDataTrueTypeUnicode::WriteFontData(wxOutputStream* fontData, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
+wxPdfFontDataTrueTypeUnicode::WriteFontData(wxOutputStream* fontData, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
 {
   bool isMacCoreText = false;
   bool deleteFontStream = false;
@@ -861,6 +863,13 @@ wxPdfFontDataTrueTypeUnicode::WriteFontData(wxOutputStream* fontData, wxPdfSorte
   wxString fontFullPath = wxEmptyString;
   wxFileName fileName;
 
+  // Reuse a previously created subset, if available
+  wxString cacheKey = GetSubsetCacheKey(usedGlyphs);
+  if (!cacheKey.IsEmpty() && wxPdfFontSubsetCache::Load(cacheKey, fontData, fontSize1, usedGlyphs))
+  {
+    return fontSize1;
+  }
+
   if (m_fontBuffer && m_fontBufferSize > 0)
   {
     deleteFontStream = true;
@@ -903,9 +912,18 @@ wxPdfFontDataTrueTypeUnicode::WriteFontData(wxOutputStream* fontData, wxPdfSorte
 
     if (fileName.IsOk())
     {
+      // Map the font file into memory, if possible; WOFF files are decoded from a file stream
+      wxString fileExt = fileName.GetExt().Lower();
+      if (!fileExt.IsSameAs(wxS("woff")) && !fileExt.IsSameAs(wxS("woff2")))
+      {
+        fontStream = GetMappedFontStream(fileName.GetFullPath());
+        deleteFontStream = (fontStream != nullptr);
+        fontFullPath = fileName.GetFullPath();
+      }
+
       // Open font file
       wxFileSystem fs;
-      fontFile = fs.OpenFile(wxFileSystem::FileNameToURL(fileName));
+      fontFile = (fontStream == nullptr) ? fs.OpenFile(wxFileSystem::FileNameToURL(fileName)) : nullptr;
       if (fontFile)
       {
         bool isWoff = false;
@@ -937,7 +955,7 @@ wxPdfFontDataTrueTypeUnicode::WriteFontData(wxOutputStream* fontData, wxPdfSorte
           }
         }
       }
-      else
+      else if (fontStream == nullptr)
       {
         // usually this should not happen since file accessibility was already checked
         wxLogError(wxString(wxS("wxPdfFontDataTrueTypeUnicode::WriteFontData: ")) +
@@ -982,11 +1000,7 @@ wxPdfFontDataTrueTypeUnicode::WriteFontData(wxOutputStream* fontData, wxPdfSorte
       }
 
       // Write font subset data
-      wxZlibOutputStream zFontData(*fontData);
-      wxMemoryInputStream tmp(*subsetStream);
-      fontSize1 = tmp.GetSize();
-      zFontData.Write(tmp);
-      zFontData.Close();
+      fontSize1 = WriteSubsetData(fontData, subsetStream, cacheKey, usedGlyphs);
       delete subsetStream;
     }
     else
@@ -1003,6 +1017,10 @@ wxPdfFontDataTrueTypeUnicode::WriteFontData(wxOutputStream* fontData, wxPdfSorte
         fontSize1 = GetSize1();
         fontData->Write(*fontStream);
       }
+      if (deleteFontStream)
+      {
+        delete fontStream;
+      }
     }
   }
 
@@ -1017,7 +1035,7 @@ wxPdfFontDataTrueTypeUnicode::WriteFontData(wxOutputStream* fontData, wxPdfSorte
 size_t
 wxPdfFontDataTrueTypeUnicode::WriteUnicodeMap(wxOutputStream* mapData,
                                               const wxPdfEncoding* encoding,
-                                              wxPdfSortedArrayInt* usedGlyphs,
+                                              wxPdfGlyphSet* usedGlyphs,
                                               wxPdfChar2GlyphMap* subsetGlyphs)
 {
   wxUnusedVar(encoding);
@@ -1028,7 +1046,7 @@ wxPdfFontDataTrueTypeUnicode::WriteUnicodeMap(wxOutputStream* mapData,
   {
     if (usedGlyphs)
     {
-      if (usedGlyphs->Index(charIter->second) != wxNOT_FOUND)
+      if (usedGlyphs->Contains(charIter->second))
       {
         wxPdfGlyphListEntry* glEntry = new wxPdfGlyphListEntry();
         glEntry->m_gid = charIter->second;
@@ -1059,7 +1077,7 @@ wxPdfFontDataTrueTypeUnicode::WriteUnicodeMap(wxOutputStream* mapData,
 size_t
 wxPdfFontDataTrueTypeUnicode::WriteCIDToGIDMap(wxOutputStream* mapData,
                                                const wxPdfEncoding* encoding,
-                                               wxPdfSortedArrayInt* usedGlyphs,
+                                               wxPdfGlyphSet* usedGlyphs,
                                                wxPdfChar2GlyphMap* subsetGlyphs)
 {
   wxUnusedVar(encoding);
@@ -1078,7 +1096,7 @@ wxPdfFontDataTrueTypeUnicode::WriteCIDToGIDMap(wxOutputStream* mapData,
   for (c2gMapIter = m_gn->begin(); c2gMapIter != m_gn->end(); ++c2gMapIter)
   {
     wxUint32 gid = c2gMapIter->second;
-    bool setMap = (usedGlyphs) ? (usedGlyphs->Index(gid) != wxNOT_FOUND) : true;
+    bool setMap = (usedGlyphs) ? usedGlyphs->Contains(gid) : true;
     // Set GID
     // Note: One would expect that CID is used to index the mapping array.
     // However, wxPdfDocument already replaces CIDs by GIDs on adding text strings
@@ -1102,7 +1120,7 @@ wxPdfFontDataTrueTypeUnicode::WriteCIDToGIDMap(wxOutputStream* mapData,
 size_t
 wxPdfFontDataTrueTypeUnicode::WriteCIDSet(wxOutputStream* setData,
                                           const wxPdfEncoding* encoding,
-                                          wxPdfSortedArrayInt* usedGlyphs,
+                                          wxPdfGlyphSet* usedGlyphs,
                                           wxPdfChar2GlyphMap* subsetGlyphs)
 {
   wxUnusedVar(encoding);
@@ -1123,7 +1141,7 @@ wxPdfFontDataTrueTypeUnicode::WriteCIDSet(wxOutputStream* setData,
   for (c2gMapIter = m_gn->begin(); c2gMapIter != m_gn->end(); ++c2gMapIter)
   {
     wxUint32 gid = c2gMapIter->second;
-    bool setMap = (usedGlyphs) ? (usedGlyphs->Index(gid) != wxNOT_FOUND) : true;
+    bool setMap = (usedGlyphs) ? usedGlyphs->Contains(gid) : true;
     // Set GID
     // Note: One would expect that CID is used to index the mapping array.
     // However, wxPdfDocument already replaces CIDs by GIDs on adding text strings
@@ -79,6 +79,7 @@ wxPdfFontDataType0::wxPdfFontDataType0(const wxString& family, const wxString& n
   {
     m_hwRange = false;
   }
+  CreateMetricsTable();
   m_initialized = true;
 }
 
@@ -202,11 +203,15 @@ wxPdfFontDataType0::LoadFontMetrics(wxXmlNode* root)
     m_hwLast  = 0xff9f;
   }
   m_initialized = (bName && bDesc && bRegistry && bCmap && bWidth);
+  if (m_initialized)
+  {
+    CreateMetricsTable();
+  }
   return m_initialized;
 }
 
 wxString
-wxPdfFontDataType0::GetWidthsAsString(bool subset, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs) const
+wxPdfFontDataType0::GetWidthsAsString(bool subset, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs) const
 {
   wxUnusedVar(subset);
   wxUnusedVar(usedGlyphs);
@@ -240,15 +245,8 @@ wxPdfFontDataType0::GetStringWidth(const wxString& s, const wxPdfEncoding* encod
     const wxUniChar c = *ch;
     if (c >= 0 && c < 128)
     {
-      wxPdfGlyphWidthMap::iterator charIter = (*m_cw).find(c);
-      if (charIter != (*m_cw).end())
-      {
-        w += charIter->second;
-      }
-      else
-      {
-        w += m_desc.GetMissingWidth();
-      }
+      int charWidth = FindCharWidth((wxUint32) c);
+      w += (charWidth >= 0) ? charWidth : m_desc.GetMissingWidth();
     }
     else
     {
@@ -301,7 +299,7 @@ wxPdfFontDataType0::CanShow(const wxString& s, const wxPdfEncoding* encoding) co
 wxString
 wxPdfFontDataType0::ConvertCID2GID(const wxString& s,
                                    const wxPdfEncoding* encoding,
-                                   wxPdfSortedArrayInt* usedGlyphs,
+                                   wxPdfGlyphSet* usedGlyphs,
                                    wxPdfChar2GlyphMap* subsetGlyphs) const
 {
   // No conversion from cid to gid
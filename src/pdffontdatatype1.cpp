@@ -166,6 +166,10 @@ wxPdfFontDataType1::LoadFontMetrics(wxXmlNode* root)
     wxFileName fileName(m_file);
     m_initialized = fileName.MakeAbsolute(m_path) && fileName.FileExists() && fileName.IsFileReadable();
   }
+  if (m_initialized)
+  {
+    CreateMetricsTable();
+  }
   return m_initialized;
 }
 
@@ -179,6 +183,10 @@ wxPdfFontDataType1::Initialize()
     wxPdfFontParserType1 fontParser;
     ok = fontParser.LoadFontData(this);
     m_initialized = ok;
+    if (ok)
+    {
+      CreateMetricsTable();
+    }
 #else
     ok = false;
 #endif
@@ -205,7 +213,6 @@ wxPdfFontDataType1::GetStringWidth(const wxString& s, const wxPdfEncoding* encod
       glyphNames = m_encoding->GetGlyphNames();
     }
     wxUint16 glyph;
-    wxPdfGlyphWidthMap::iterator glyphIter;
     wxPdfFontType1GlyphWidthMap::iterator type1GlyphIter;
     wxPdfChar2GlyphMap::const_iterator charIter;
     wxString::const_iterator ch;
@@ -236,15 +243,8 @@ wxPdfFontDataType1::GetStringWidth(const wxString& s, const wxPdfEncoding* encod
       else
 #endif
       {
-        glyphIter = (*m_cw).find(glyph);
-        if (glyphIter != (*m_cw).end())
-        {
-          w += glyphIter->second;
-        }
-        else
-        {
-          w += m_desc.GetMissingWidth();
-        }
+        int glyphWidth = FindCharWidth(glyph);
+        w += (glyphWidth >= 0) ? glyphWidth : m_desc.GetMissingWidth();
       }
     }
     ++glyphCount;
@@ -287,7 +287,7 @@ wxPdfFontDataType1::CanShow(const wxString& s, const wxPdfEncoding* encoding) co
 wxString
 wxPdfFontDataType1::ConvertCID2GID(const wxString& s,
                                    const wxPdfEncoding* encoding,
-                                   wxPdfSortedArrayInt* usedGlyphs,
+                                   wxPdfGlyphSet* usedGlyphs,
                                    wxPdfChar2GlyphMap* subsetGlyphs) const
 {
   wxUnusedVar(usedGlyphs);
@@ -320,7 +320,7 @@ wxPdfFontDataType1::ConvertCID2GID(const wxString& s,
 }
 
 wxString
-wxPdfFontDataType1::GetWidthsAsString(bool subset, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs) const
+wxPdfFontDataType1::GetWidthsAsString(bool subset, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs) const
 {
   wxUnusedVar(subset);
   wxUnusedVar(usedGlyphs);
@@ -337,7 +337,7 @@ wxPdfFontDataType1::GetWidthsAsString(bool subset, wxPdfSortedArrayInt* usedGlyp
 
 #if wxUSE_UNICODE
 wxString
-wxPdfFontDataType1::GetWidthsAsString(const wxArrayString& glyphNames, bool subset, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs) const
+wxPdfFontDataType1::GetWidthsAsString(const wxArrayString& glyphNames, bool subset, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs) const
 {
   wxUnusedVar(subset);
   wxUnusedVar(usedGlyphs);
@@ -489,7 +489,7 @@ wxPdfFontDataType1::CompressFontData(wxOutputStream* fontData, wxInputStream* pf
 }
 
 size_t
-wxPdfFontDataType1::WriteFontData(wxOutputStream* fontData, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
+wxPdfFontDataType1::WriteFontData(wxOutputStream* fontData, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
 {
   wxUnusedVar(usedGlyphs);
   wxUnusedVar(subsetGlyphs);
@@ -555,7 +555,7 @@ wxPdfFontDataType1::WriteFontData(wxOutputStream* fontData, wxPdfSortedArrayInt*
 size_t
 wxPdfFontDataType1::WriteUnicodeMap(wxOutputStream* mapData,
                                     const wxPdfEncoding* encoding,
-                                    wxPdfSortedArrayInt* usedGlyphs,
+                                    wxPdfGlyphSet* usedGlyphs,
                                     wxPdfChar2GlyphMap* subsetGlyphs)
 {
   wxUnusedVar(usedGlyphs);
@@ -26,18 +26,12 @@
 #include "wx/pdffont.h"
 #include "wx/pdffontdetails.h"
 
-static int
-CompareInts(int n1, int n2)
-{
-  return n1 - n2;
-}
-
 wxPdfFontDetails::wxPdfFontDetails(int index, const wxPdfFont& font)
   : m_index(index), m_n(0), m_fn(0), m_ndiff(0), m_font(font)
 {
   if (m_font.SubsetRequested())
   {
-    m_usedGlyphs = new wxPdfSortedArrayInt(CompareInts);
+    m_usedGlyphs = new wxPdfGlyphSet();
     m_usedGlyphs->Add(0);
     if (m_font.GetType().IsSameAs(wxS("TrueTypeUnicode")) ||
         m_font.GetType().IsSameAs(wxS("OpenTypeUnicode")))
@@ -144,6 +138,12 @@ wxPdfFontDetails::GetStringWidth(const wxString& s, bool withKerning, double cha
   return m_font.GetStringWidth(s, withKerning, charSpacing);
 }
 
+void
+wxPdfFontDetails::GetCharAdvances(const wxString& s, wxPdfArrayDouble& advances, bool withKerning, double charSpacing)
+{
+  m_font.GetCharAdvances(s, advances, withKerning, charSpacing);
+}
+
 wxArrayInt
 wxPdfFontDetails::GetKerningWidthArray(const wxString& s) const
 {
@@ -222,3 +222,41 @@ wxPdfFontDetails::GetEncodingConv() const
 }
 
 #endif
+
+// ----------------------------------------------------------------------------
+// wxPdfLineBreaker: measures arbitrary ranges of a text in constant time
+// ----------------------------------------------------------------------------
+
+wxPdfLineBreaker::wxPdfLineBreaker(wxPdfFontDetails* font, const wxString& s, bool kerning, double charSpacing, double fontSize)
+{
+  size_t n = s.length();
+  m_widths.Alloc(n+1);
+  m_widths.Add(0);
+  if (font != NULL && fontSize > 0)
+  {
+    wxPdfArrayDouble advances;
+    font->GetCharAdvances(s, advances, kerning, charSpacing / fontSize);
+    double sum = 0;
+    size_t k;
+    for (k = 0; k < n; ++k)
+    {
+      sum += advances[k];
+      m_widths.Add(sum * fontSize);
+    }
+    if (kerning)
+    {
+      // The kerning correction between a range and its preceding character must not be counted
+      wxPdfArrayDouble plainAdvances;
+      font->GetCharAdvances(s, plainAdvances, false, charSpacing / fontSize);
+      m_kerning.Alloc(n);
+      for (k = 0; k < n; ++k)
+      {
+        m_kerning.Add((advances[k] - plainAdvances[k]) * fontSize);
+      }
+    }
+  }
+  else
+  {
+    m_widths.Add(0, n);
+  }
+}
@@ -242,7 +242,7 @@ wxPdfFontExtended::GetSupplement() const
 }
 
 wxString
-wxPdfFontExtended::GetWidthsAsString(bool subset, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs) const
+wxPdfFontExtended::GetWidthsAsString(bool subset, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs) const
 {
   wxString widths = wxEmptyString;
   if (m_fontData != NULL)
@@ -272,6 +272,20 @@ wxPdfFontExtended::GetStringWidth(const wxString& s, bool withKerning, double ch
   return width;
 }
 
+void
+wxPdfFontExtended::GetCharAdvances(const wxString& s, wxPdfArrayDouble& advances, bool withKerning, double charSpacing)
+{
+  if (m_fontData != NULL)
+  {
+    m_fontData->GetCharAdvances(s, advances, m_encoding, withKerning, charSpacing);
+  }
+  else
+  {
+    advances.Empty();
+    advances.Add(0, s.length());
+  }
+}
+
 wxArrayInt
 wxPdfFontExtended::GetKerningWidthArray(const wxString& s) const
 {
@@ -290,7 +304,7 @@ wxPdfFontExtended::CanShow(const wxString& s) const
 }
 
 wxString
-wxPdfFontExtended::ConvertCID2GID(const wxString& s, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
+wxPdfFontExtended::ConvertCID2GID(const wxString& s, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
 {
   wxString sConv = wxEmptyString;
   if (m_fontData != NULL)
@@ -301,7 +315,7 @@ wxPdfFontExtended::ConvertCID2GID(const wxString& s, wxPdfSortedArrayInt* usedGl
 }
 
 wxString
-wxPdfFontExtended::ConvertGlyph(wxUint32 glyph, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
+wxPdfFontExtended::ConvertGlyph(wxUint32 glyph, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
 {
   wxString sConv = wxEmptyString;
   if (m_fontData != NULL)
@@ -323,14 +337,30 @@ wxPdfFontExtended::SupportsSubset() const
   return (m_fontData != NULL) ? m_fontData->SubsetSupported() : false;
 }
 
+bool
+wxPdfFontExtended::UsesSystemFont() const
+{
+  bool systemFont = false;
+#if defined(__WXMSW__) || defined(__WXMAC__)
+  if (m_fontData != NULL)
+  {
+    systemFont = (m_fontData->GetFontBuffer() == NULL || m_fontData->GetFontBufferSize() == 0) &&
+                 m_fontData->GetFontFileName().IsEmpty() &&
+                 m_fontData->GetFontFile().IsEmpty() &&
+                 m_fontData->GetFont().IsOk();
+  }
+#endif
+  return systemFont;
+}
+
 size_t
-wxPdfFontExtended::WriteFontData(wxOutputStream* fontData, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
+wxPdfFontExtended::WriteFontData(wxOutputStream* fontData, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
 {
   return (m_fontData != NULL) ? m_fontData->WriteFontData(fontData, usedGlyphs, subsetGlyphs) : 0;
 }
 
 size_t
-wxPdfFontExtended::WriteUnicodeMap(wxOutputStream* mapData, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
+wxPdfFontExtended::WriteUnicodeMap(wxOutputStream* mapData, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
 {
   size_t maplen = 0;
   if (m_fontData != NULL)
@@ -341,7 +371,7 @@ wxPdfFontExtended::WriteUnicodeMap(wxOutputStream* mapData, wxPdfSortedArrayInt*
 }
 
 size_t
-wxPdfFontExtended::WriteCIDToGIDMap(wxOutputStream* mapData, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
+wxPdfFontExtended::WriteCIDToGIDMap(wxOutputStream* mapData, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
 {
   size_t maplen = 0;
   if (m_fontData != NULL)
@@ -352,7 +382,7 @@ wxPdfFontExtended::WriteCIDToGIDMap(wxOutputStream* mapData, wxPdfSortedArrayInt
 }
 
 size_t
-wxPdfFontExtended::WriteCIDSet(wxOutputStream* setData, wxPdfSortedArrayInt* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
+wxPdfFontExtended::WriteCIDSet(wxOutputStream* setData, wxPdfGlyphSet* usedGlyphs, wxPdfChar2GlyphMap* subsetGlyphs)
 {
   size_t maplen = 0;
   if (m_fontData != NULL)
@@ -29,8 +29,15 @@
 #include <wx/font.h>
 #include <wx/hashmap.h>
 #include <wx/thread.h>
+#include <wx/txtstrm.h>
+#include <wx/wfstream.h>
 #include <wx/xml/xml.h>
 
+#include <atomic>
+#include <map>
+#include <utility>
+#include <vector>
+
 #include "wx/pdfencoding.h"
 #include "wx/pdffontmanager.h"
 #include "wx/pdffontdata.h"
@@ -72,11 +79,12 @@
 #if wxUSE_THREADS
 static wxCriticalSection gs_csFontManager;
 static wxCriticalSection gs_csFontData;
+static wxCriticalSection gs_csFontIndex;
 #endif
 
-// To make reference counting and encoding conversion thread safe
-// some methods of the wxFontData class use the critical section
-// associated with the font manager.
+// To make encoding conversion thread safe some methods of the
+// wxFontData class use the critical section associated with the font manager.
+// Reference counting uses atomic operations.
 
 wxMBConv* wxPdfFontData::ms_winEncoding = NULL;
 
@@ -94,13 +102,10 @@ wxPdfFontData::GetWinEncodingConv()
   return ms_winEncoding;
 }
 
-int
+void
 wxPdfFontData::IncrementRefCount()
 {
-#if wxUSE_THREADS
-  wxCriticalSectionLocker locker(gs_csFontData);
-#endif
-  return ++m_refCount;
+  wxAtomicInc(m_refCount);
 }
 
 // --- Font List
@@ -108,10 +113,7 @@ wxPdfFontData::IncrementRefCount()
 int
 wxPdfFontData::DecrementRefCount()
 {
-#if wxUSE_THREADS
-  wxCriticalSectionLocker locker(gs_csFontData);
-#endif
-  return --m_refCount;
+  return wxAtomicDec(m_refCount);
 }
 
 class wxPdfFontListEntry
@@ -289,6 +291,90 @@ WX_DECLARE_STRING_HASH_MAP(wxPdfEncoding*, wxPdfEncodingMap);
 /// Hashmap class for mapping encoding checkers
 WX_DECLARE_STRING_HASH_MAP(wxPdfEncodingChecker*, wxPdfEncodingCheckerMap);
 
+/// Immutable copy of the lookup tables of the font manager (For internal use only)
+/**
+* Lookups use the current snapshot without locking. A snapshot is never modified
+* after it was published; modifications of the font manager cause a new snapshot
+* to be created on the next lookup. A replaced snapshot is released once all
+* lookups which might still use it have finished.
+*/
+class wxPdfFontManagerSnapshot
+{
+public:
+  /// Constructor
+  wxPdfFontManagerSnapshot(size_t generation)
+    : m_generation(generation)
+  {
+  }
+
+  size_t                      m_generation;    ///< Modification count of the font manager
+  wxPdfFontNameMap            m_fontNameMap;   ///< Map of font names to font list index
+  wxPdfFontFamilyMap          m_fontFamilyMap; ///< Map of font families to font list indices
+  wxPdfFontAliasMap           m_fontAliasMap;  ///< Map of family aliases to font families
+  std::vector<wxPdfFontData*> m_fontList;      ///< List of registered font data
+  wxPdfEncodingMap            m_encodingMap;   ///< Map of registered encodings
+};
+
+/// Number of counters of lookups in progress per epoch
+static const size_t gs_lookupSlotCount = 16;
+
+/// Counter of lookups in progress, on a cache line of its own (For internal use only)
+/**
+* Threads are spread over several counters, so that lookups in different
+* threads do not compete for the same cache line.
+*/
+struct wxPdfFontManagerLookupSlot
+{
+  /// Constructor
+  wxPdfFontManagerLookupSlot() : m_count(0) {}
+
+  std::atomic<size_t> m_count;                                  ///< Number of lookups in progress
+  char                m_padding[64 - sizeof(std::atomic<size_t>)]; ///< Padding to the cache line size
+};
+
+/// Font face entry of the font index (For internal use only)
+class wxPdfFontIndexFace
+{
+public:
+  /// Default constructor
+  wxPdfFontIndexFace()
+    : m_style(wxPDF_FONTSTYLE_REGULAR),
+      m_embedSupported(false), m_subsetSupported(false),
+      m_cffOffset(0), m_cffLength(0)
+  {
+  }
+
+  wxString      m_type;            ///< Font type
+  wxString      m_name;            ///< PostScript font name
+  wxString      m_family;          ///< Font family name
+  wxArrayString m_fullNames;       ///< Full font names
+  int           m_style;           ///< Font style
+  bool          m_embedSupported;  ///< Flag whether embedding is allowed
+  bool          m_subsetSupported; ///< Flag whether subsetting is allowed
+  size_t        m_cffOffset;       ///< Offset of the CFF table
+  size_t        m_cffLength;       ///< Length of the CFF table
+};
+
+/// Font file entry of the font index (For internal use only)
+class wxPdfFontIndexEntry
+{
+public:
+  /// Default constructor
+  wxPdfFontIndexEntry()
+    : m_size(0), m_modified(0), m_fontCount(-1), m_used(false)
+  {
+  }
+
+  wxLongLong                         m_size;      ///< Size of the font file
+  wxLongLong                         m_modified;  ///< Modification time of the font file
+  int                                m_fontCount; ///< Number of fonts in a font collection (-1 if unknown)
+  bool                               m_used;      ///< Flag whether the entry was used in this session
+  std::map<int, wxPdfFontIndexFace>  m_faces;     ///< Identified font faces by font index
+};
+
+/// Hashmap class for mapping font file names to font index entries
+WX_DECLARE_STRING_HASH_MAP(wxPdfFontIndexEntry, wxPdfFontIndexMap);
+
 class wxPdfFontManagerBase
 {
 public:
@@ -328,6 +414,16 @@ public:
   int RegisterFontDirectory(const wxString& directory, bool recursive = false);
 #endif
 
+  bool SetFontIndexFile(const wxString& indexFileName);
+
+  wxString GetFontIndexFile() const;
+
+  bool SaveFontIndex();
+
+  int SetFontScanThreads(int numThreads);
+
+  int GetFontScanThreads() const;
+
   wxPdfFont GetFont(const wxString& fontName, int fontStyle = wxPDF_FONTSTYLE_REGULAR) const;
 
   wxPdfFont GetFont(const wxString& fontName, const wxString& fontStyle) const;
@@ -347,6 +443,22 @@ public:
   static wxString ConvertStyleToString(int fontStyle);
 
 private:
+  wxPdfFont RegisterFontFile(const wxString& fullFontFileName, const wxString& aliasName, int fontIndex);
+
+#if wxUSE_UNICODE
+  wxPdfFontData* IdentifyFontFile(const wxString& fullFontFileName, int fontIndex);
+
+  int GetCollectionFontCount(const wxString& fullFontFileName);
+
+  int RegisterFontFiles(const wxArrayString& fontFileNames, const wxArrayInt& fontIndices);
+
+  void ScanFontFiles(const wxArrayString& fontFileNames);
+
+  void ScanFontFile(const wxString& fullFontFileName);
+#endif
+
+  bool LoadFontIndex();
+
   void InitializeCoreFonts();
 
 #if wxUSE_UNICODE
@@ -369,6 +481,10 @@ private:
 
   bool AddFont(wxPdfFontData* fontData, wxPdfFont& font);
 
+  void UpdateSnapshot() const;
+
+  void ReclaimSnapshots() const;
+
   wxPathList         m_searchPaths;
 
   wxPdfFontNameMap   m_fontNameMap;
@@ -376,17 +492,103 @@ private:
   wxPdfFontAliasMap  m_fontAliasMap;
   wxPdfFontList      m_fontList;
 
-  bool               m_defaultEmbed;
-  bool               m_defaultSubset;
+  std::atomic<bool>  m_defaultEmbed;
+  std::atomic<bool>  m_defaultSubset;
 
   wxPdfEncodingMap*        m_encodingMap;
   wxPdfEncodingCheckerMap* m_encodingCheckerMap;
+
+  wxString           m_fontIndexFile;
+  wxPdfFontIndexMap  m_fontIndex;
+  bool               m_fontIndexModified;
+  int                m_fontScanThreads;
+
+  std::atomic<size_t>                                   m_generation; ///< Modification count
+  mutable std::atomic<const wxPdfFontManagerSnapshot*> m_snapshot;   ///< Current lookup snapshot
+  mutable std::vector< std::pair<const wxPdfFontManagerSnapshot*, size_t> > m_retiredSnapshots; ///< Replaced snapshots and the epoch of their replacement
+  mutable std::atomic<size_t>                           m_epoch;      ///< Current lookup epoch
+  mutable wxPdfFontManagerLookupSlot                    m_lookups[2][gs_lookupSlotCount]; ///< Lookups in progress per epoch parity
+
+  friend class wxPdfFontScanner;
+  friend class wxPdfFontManagerLookup;
 };
 
+/// Access to the current snapshot of the lookup tables for the duration of a lookup (For internal use only)
+/**
+* A lookup is registered in the counters of the current epoch before the snapshot
+* is loaded and unregistered when the lookup object is destroyed, so that the
+* snapshot is not released while it is in use.
+*/
+class wxPdfFontManagerLookup
+{
+public:
+  /// Constructor
+  wxPdfFontManagerLookup(const wxPdfFontManagerBase* fontManager);
+
+  /// Destructor
+  ~wxPdfFontManagerLookup();
+
+  /// Access the snapshot
+  const wxPdfFontManagerSnapshot* operator->() const { return m_snapshot; }
+
+private:
+  /// Register the lookup and load the current snapshot
+  void Enter(const wxPdfFontManagerBase* fontManager, size_t slot);
+
+  std::atomic<size_t>*            m_count;    ///< Counter of lookups of the current thread
+  const wxPdfFontManagerSnapshot* m_snapshot; ///< Snapshot used by the lookup
+};
+
+static size_t
+GetLookupSlot()
+{
+#if wxUSE_THREADS
+  // Thread ids are often aligned addresses, the multiplicative hash spreads them evenly
+  wxUint64 id = (wxUint64) wxThread::GetCurrentId();
+  return (size_t) (((id * wxULL(0x9E3779B97F4A7C15)) >> 32) % gs_lookupSlotCount);
+#else
+  return 0;
+#endif
+}
+
+wxPdfFontManagerLookup::wxPdfFontManagerLookup(const wxPdfFontManagerBase* fontManager)
+{
+  size_t slot = GetLookupSlot();
+  Enter(fontManager, slot);
+  if (m_snapshot == NULL || m_snapshot->m_generation != fontManager->m_generation.load(std::memory_order_acquire))
+  {
+    // Lookup tables were modified since the snapshot was taken
+    m_count->fetch_sub(1, std::memory_order_release);
+    fontManager->UpdateSnapshot();
+    Enter(fontManager, slot);
+  }
+}
+
+void
+wxPdfFontManagerLookup::Enter(const wxPdfFontManagerBase* fontManager, size_t slot)
+{
+  // Registration and loading have to be sequentially consistent with
+  // replacing the snapshot and checking the counters in ReclaimSnapshots
+  size_t epoch = fontManager->m_epoch.load(std::memory_order_seq_cst);
+  m_count = &fontManager->m_lookups[epoch & 1][slot].m_count;
+  m_count->fetch_add(1, std::memory_order_seq_cst);
+  m_snapshot = fontManager->m_snapshot.load(std::memory_order_seq_cst);
+}
+
+wxPdfFontManagerLookup::~wxPdfFontManagerLookup()
+{
+  m_count->fetch_sub(1, std::memory_order_release);
+}
+
 wxPdfFontManagerBase::wxPdfFontManagerBase()
 {
   m_defaultEmbed = true;
   m_defaultSubset = true;
+  m_fontIndexModified = false;
+  m_fontScanThreads = 1;
+  m_generation = 0;
+  m_snapshot = NULL;
+  m_epoch = 0;
   {
     // Since InitializeCoreFonts uses locking, too, it is necessary
     // to create a new context, thus locking only the access of the
@@ -408,6 +610,7 @@ wxPdfFontManagerBase::wxPdfFontManagerBase()
 
 wxPdfFontManagerBase::~wxPdfFontManagerBase()
 {
+  SaveFontIndex();
 #if wxUSE_THREADS
   wxCriticalSectionLocker locker(gs_csFontManager);
 #endif
@@ -438,6 +641,92 @@ wxPdfFontManagerBase::~wxPdfFontManagerBase()
     delete checker->second;
   }
   delete m_encodingCheckerMap;
+
+  size_t k;
+  for (k = 0; k < m_retiredSnapshots.size(); ++k)
+  {
+    delete m_retiredSnapshots[k].first;
+  }
+  m_retiredSnapshots.clear();
+  delete m_snapshot.load();
+  m_snapshot = NULL;
+}
+
+void
+wxPdfFontManagerBase::UpdateSnapshot() const
+{
+  // The current snapshot is only accessed while holding the lock,
+  // since the caller is not registered as a lookup
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csFontManager);
+#endif
+  size_t generation = m_generation.load(std::memory_order_relaxed);
+  const wxPdfFontManagerSnapshot* snapshot = m_snapshot.load(std::memory_order_relaxed);
+  if (snapshot == NULL || snapshot->m_generation != generation)
+  {
+    wxPdfFontManagerSnapshot* newSnapshot = new wxPdfFontManagerSnapshot(generation);
+    newSnapshot->m_fontNameMap = m_fontNameMap;
+    newSnapshot->m_fontFamilyMap = m_fontFamilyMap;
+    newSnapshot->m_fontAliasMap = m_fontAliasMap;
+    newSnapshot->m_fontList.reserve(m_fontList.GetCount());
+    size_t j;
+    for (j = 0; j < m_fontList.GetCount(); ++j)
+    {
+      newSnapshot->m_fontList.push_back(m_fontList[j]->GetFontData());
+    }
+    newSnapshot->m_encodingMap = *m_encodingMap;
+    if (snapshot != NULL)
+    {
+      m_retiredSnapshots.push_back(std::make_pair(snapshot, m_epoch.load(std::memory_order_relaxed)));
+    }
+    m_snapshot.store(newSnapshot, std::memory_order_seq_cst);
+    ReclaimSnapshots();
+  }
+}
+
+void
+wxPdfFontManagerBase::ReclaimSnapshots() const
+{
+  // Lookups register in the counters of the epoch they observed before they load
+  // the snapshot. New lookups use the counters of the current epoch, so those of
+  // the previous epoch drain quickly; the epoch advances once they are all zero.
+  // A snapshot replaced in epoch e may only be used by lookups registered in
+  // epoch e or earlier, thus it can be released when epoch e+2 is reached.
+  int advance;
+  for (advance = 0; advance < 2; ++advance)
+  {
+    size_t epoch = m_epoch.load(std::memory_order_relaxed);
+    const wxPdfFontManagerLookupSlot* previous = m_lookups[(epoch + 1) & 1];
+    size_t k;
+    for (k = 0; k < gs_lookupSlotCount; ++k)
+    {
+      if (previous[k].m_count.load(std::memory_order_seq_cst) != 0)
+      {
+        break;
+      }
+    }
+    if (k < gs_lookupSlotCount)
+    {
+      break;
+    }
+    m_epoch.store(epoch + 1, std::memory_order_seq_cst);
+  }
+
+  size_t epoch = m_epoch.load(std::memory_order_relaxed);
+  size_t kept = 0;
+  size_t j;
+  for (j = 0; j < m_retiredSnapshots.size(); ++j)
+  {
+    if (m_retiredSnapshots[j].second + 2 <= epoch)
+    {
+      delete m_retiredSnapshots[j].first;
+    }
+    else
+    {
+      m_retiredSnapshots[kept++] = m_retiredSnapshots[j];
+    }
+  }
+  m_retiredSnapshots.resize(kept);
 }
 
 void
@@ -505,126 +794,321 @@ wxPdfFontManagerBase::FindFile(const wxString& fileName, wxString& fullFileName)
 bool
 wxPdfFontManagerBase::SetDefaultEmbed(bool embed)
 {
-#if wxUSE_THREADS
-  wxCriticalSectionLocker locker(gs_csFontManager);
-#endif
-  bool previous = m_defaultEmbed;
-  m_defaultEmbed = embed;
-  return previous;
+  return m_defaultEmbed.exchange(embed);
 }
 
 bool
 wxPdfFontManagerBase::GetDefaultEmbed() const
+{
+  return m_defaultEmbed.load();
+}
+
+bool
+wxPdfFontManagerBase::SetDefaultSubset(bool subset)
+{
+  return m_defaultSubset.exchange(subset);
+}
+
+bool
+wxPdfFontManagerBase::GetDefaultSubset() const
+{
+  return m_defaultSubset.load();
+}
+
+// Version tag of the font index file format
+static const wxStringCharType* gs_fontIndexHeader = wxS("wxPdfFontIndex 1");
+
+static wxString
+FontIndexField(const wxString& value)
+{
+  // Fields are separated by tabs and entries by line breaks
+  wxString field = value;
+  field.Replace(wxS("\t"), wxS(" "));
+  field.Replace(wxS("\r"), wxS(" "));
+  field.Replace(wxS("\n"), wxS(" "));
+  return field;
+}
+
+bool
+wxPdfFontManagerBase::SetFontIndexFile(const wxString& indexFileName)
 {
 #if wxUSE_THREADS
-  wxCriticalSectionLocker locker(gs_csFontManager);
+  wxCriticalSectionLocker locker(gs_csFontIndex);
 #endif
-  return m_defaultEmbed;
+  bool ok = true;
+  m_fontIndexFile = indexFileName;
+  if (!m_fontIndexFile.IsEmpty())
+  {
+    // Entries collected before the index file was set need to be written as well
+    m_fontIndexModified = !m_fontIndex.empty();
+    ok = LoadFontIndex();
+  }
+  return ok;
+}
+
+wxString
+wxPdfFontManagerBase::GetFontIndexFile() const
+{
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csFontIndex);
+#endif
+  return m_fontIndexFile;
 }
 
 bool
-wxPdfFontManagerBase::SetDefaultSubset(bool subset)
+wxPdfFontManagerBase::LoadFontIndex()
+{
+  bool ok = true;
+  if (wxFileName::FileExists(m_fontIndexFile))
+  {
+    wxLogNull logNull;
+    wxFileInputStream indexStream(m_fontIndexFile);
+    ok = indexStream.IsOk();
+    if (ok)
+    {
+      wxTextInputStream text(indexStream, wxS("\t"), wxConvUTF8);
+      ok = text.ReadLine().IsSameAs(gs_fontIndexHeader);
+      wxPdfFontIndexEntry* entry = NULL;
+      while (ok && !indexStream.Eof())
+      {
+        wxString line = text.ReadLine();
+        wxArrayString fields = wxSplit(line, wxS('\t'), wxS('\0'));
+        if (fields.GetCount() == 5 && fields[0].IsSameAs(wxS("F")))
+        {
+          // Font file: size, modification time, number of fonts in collection, file name
+          wxLongLong_t size, modified;
+          long fontCount;
+          entry = NULL;
+          if (m_fontIndex.find(fields[4]) == m_fontIndex.end() &&
+              fields[1].ToLongLong(&size) && fields[2].ToLongLong(&modified) && fields[3].ToLong(&fontCount))
+          {
+            entry = &m_fontIndex[fields[4]];
+            entry->m_size = size;
+            entry->m_modified = modified;
+            entry->m_fontCount = (int) fontCount;
+          }
+        }
+        else if (fields.GetCount() >= 10 && fields[0].IsSameAs(wxS("D")) && entry != NULL)
+        {
+          // Font face: index, type, style, embed and subset flags, CFF offset and length,
+          // PostScript name, family name and full names
+          long fontIndex, style, embed, subset;
+          unsigned long cffOffset, cffLength;
+          if (fields[1].ToLong(&fontIndex) && fields[3].ToLong(&style) &&
+              fields[4].ToLong(&embed) && fields[5].ToLong(&subset) &&
+              fields[6].ToULong(&cffOffset) && fields[7].ToULong(&cffLength))
+          {
+            wxPdfFontIndexFace& face = entry->m_faces[(int) fontIndex];
+            face.m_type = fields[2];
+            face.m_style = (int) style;
+            face.m_embedSupported = (embed != 0);
+            face.m_subsetSupported = (subset != 0);
+            face.m_cffOffset = cffOffset;
+            face.m_cffLength = cffLength;
+            face.m_name = fields[8];
+            face.m_family = fields[9];
+            size_t j;
+            for (j = 10; j < fields.GetCount(); ++j)
+            {
+              face.m_fullNames.Add(fields[j]);
+            }
+          }
+        }
+      }
+    }
+    if (!ok)
+    {
+      wxLogDebug(wxString(wxS("wxPdfFontManagerBase::LoadFontIndex: ")) +
+                 wxString::Format(_("Font index file '%s' could not be read."), m_fontIndexFile.c_str()));
+    }
+  }
+  return ok;
+}
+
+bool
+wxPdfFontManagerBase::SaveFontIndex()
+{
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csFontIndex);
+#endif
+  bool ok = true;
+  if (!m_fontIndexFile.IsEmpty() && m_fontIndexModified)
+  {
+    wxLogNull logNull;
+    // Write to a temporary file first, so that other processes never see a partial index
+    wxFileName indexFileName(m_fontIndexFile);
+    wxString tempFileName = wxFileName::CreateTempFileName(indexFileName.GetPathWithSep() + wxS("wxpdfidx_"));
+    ok = !tempFileName.IsEmpty();
+    if (ok)
+    {
+      {
+        wxFileOutputStream indexStream(tempFileName);
+        ok = indexStream.IsOk();
+        if (ok)
+        {
+          wxTextOutputStream text(indexStream, wxEOL_UNIX, wxConvUTF8);
+          text << gs_fontIndexHeader << wxS("\n");
+          wxPdfFontIndexMap::const_iterator entry;
+          for (entry = m_fontIndex.begin(); entry != m_fontIndex.end(); ++entry)
+          {
+            const wxString& fileName = entry->first;
+            if (!FontIndexField(fileName).IsSameAs(fileName) ||
+                (!entry->second.m_used && !wxFileName::FileExists(fileName)))
+            {
+              continue;
+            }
+            text << wxS("F\t") << entry->second.m_size.ToString() << wxS("\t")
+                 << entry->second.m_modified.ToString() << wxS("\t")
+                 << entry->second.m_fontCount << wxS("\t") << fileName << wxS("\n");
+            std::map<int, wxPdfFontIndexFace>::const_iterator faceIter;
+            for (faceIter = entry->second.m_faces.begin(); faceIter != entry->second.m_faces.end(); ++faceIter)
+            {
+              const wxPdfFontIndexFace& face = faceIter->second;
+              text << wxS("D\t") << faceIter->first << wxS("\t") << face.m_type << wxS("\t")
+                   << face.m_style << wxS("\t") << (face.m_embedSupported ? 1 : 0) << wxS("\t")
+                   << (face.m_subsetSupported ? 1 : 0) << wxS("\t")
+                   << wxString::Format(wxS("%lu\t%lu"), (unsigned long) face.m_cffOffset, (unsigned long) face.m_cffLength)
+                   << wxS("\t") << FontIndexField(face.m_name) << wxS("\t") << FontIndexField(face.m_family);
+              size_t j;
+              for (j = 0; j < face.m_fullNames.GetCount(); ++j)
+              {
+                text << wxS("\t") << FontIndexField(face.m_fullNames[j]);
+              }
+              text << wxS("\n");
+            }
+          }
+          ok = indexStream.Close();
+        }
+      }
+      ok = ok && wxRenameFile(tempFileName, m_fontIndexFile, true);
+      if (!ok)
+      {
+        wxRemoveFile(tempFileName);
+      }
+    }
+    if (ok)
+    {
+      m_fontIndexModified = false;
+    }
+    else
+    {
+      wxLogDebug(wxString(wxS("wxPdfFontManagerBase::SaveFontIndex: ")) +
+                 wxString::Format(_("Font index file '%s' could not be written."), m_fontIndexFile.c_str()));
+    }
+  }
+  return ok;
+}
+
+int
+wxPdfFontManagerBase::SetFontScanThreads(int numThreads)
 {
 #if wxUSE_THREADS
   wxCriticalSectionLocker locker(gs_csFontManager);
 #endif
-  bool previous = m_defaultSubset;
-  m_defaultSubset = subset;
+  int previous = m_fontScanThreads;
+  m_fontScanThreads = (numThreads > 1) ? numThreads : 1;
   return previous;
 }
 
-bool
-wxPdfFontManagerBase::GetDefaultSubset() const
+int
+wxPdfFontManagerBase::GetFontScanThreads() const
 {
 #if wxUSE_THREADS
   wxCriticalSectionLocker locker(gs_csFontManager);
 #endif
-  return m_defaultSubset;
+  return m_fontScanThreads;
 }
 
 wxPdfFont
 wxPdfFontManagerBase::RegisterFont(const wxString& fontFileName, const wxString& aliasName, int fontIndex)
+{
+  wxPdfFont font;
+  wxString fullFontFileName;
+  if (FindFile(fontFileName, fullFontFileName))
+  {
+    font = RegisterFontFile(fullFontFileName, aliasName, fontIndex);
+  }
+  else
+  {
+    wxLogError(wxString(wxS("wxPdfFontManagerBase::RegisterFont: ")) +
+               wxString::Format(_("Font file '%s' does not exist or is not readable."), fontFileName.c_str()));
+  }
+  return font;
+}
+
+wxPdfFont
+wxPdfFontManagerBase::RegisterFontFile(const wxString& fullFontFileName, const wxString& aliasName, int fontIndex)
 {
 #if !wxUSE_UNICODE
   wxUnusedVar(fontIndex);
 #endif
   wxPdfFont font;
-  wxString fullFontFileName;
-  if (FindFile(fontFileName, fullFontFileName))
+  wxFileName fileName(fullFontFileName);
+  wxString ext = fileName.GetExt().Lower();
+  if (ext.IsSameAs(wxS("ttf")) || ext.IsSameAs(wxS("otf")) || ext.IsSameAs(wxS("ttc")) ||
+      ext.IsSameAs(wxS("woff")) || ext.IsSameAs(wxS("woff2")))
   {
-    wxFileName fileName(fullFontFileName);
-    wxString ext = fileName.GetExt().Lower();
-    if (ext.IsSameAs(wxS("ttf")) || ext.IsSameAs(wxS("otf")) || ext.IsSameAs(wxS("ttc")) ||
-        ext.IsSameAs(wxS("woff")) || ext.IsSameAs(wxS("woff2")))
-    {
 #if wxUSE_UNICODE
-      // TrueType font, OpenType font, or TrueType collection
-      wxPdfFontParserTrueType fontParser;
-      wxPdfFontData* fontData = fontParser.IdentifyFont(fileName.GetFullPath(), fontIndex);
-      if (fontData != NULL)
+    // TrueType font, OpenType font, or TrueType collection
+    wxPdfFontData* fontData = IdentifyFontFile(fileName.GetFullPath(), fontIndex);
+    if (fontData != NULL)
+    {
+      fontData->SetAlias(aliasName);
+      if (!AddFont(fontData, font))
       {
-        fontData->SetAlias(aliasName);
-        if (!AddFont(fontData, font))
-        {
-          delete fontData;
-          wxLogDebug(wxString(wxS("wxPdfFontManagerBase::RegisterFont: ")) +
-                     wxString::Format(_("Font file '%s' already registered."), fontFileName.c_str()));
-        }
+        delete fontData;
+        wxLogDebug(wxString(wxS("wxPdfFontManagerBase::RegisterFont: ")) +
+                   wxString::Format(_("Font file '%s' already registered."), fullFontFileName.c_str()));
       }
+    }
 #else
-      wxLogError(wxString(wxS("wxPdfFontManagerBase::RegisterFont: ")) +
-                 wxString::Format(_("Format of font file '%s' not supported."), fontFileName.c_str()));
+    wxLogError(wxString(wxS("wxPdfFontManagerBase::RegisterFont: ")) +
+               wxString::Format(_("Format of font file '%s' not supported."), fullFontFileName.c_str()));
 #endif
-    }
-    else if (/* ext.IsSameAs(wxS("pfa")) || */ ext.IsSameAs(wxS("pfb")) || ext.IsEmpty())
-    {
-      // TODO: allow Type1 fonts in PFA format (this requires encoding the binary section)
+  }
+  else if (/* ext.IsSameAs(wxS("pfa")) || */ ext.IsSameAs(wxS("pfb")) || ext.IsEmpty())
+  {
+    // TODO: allow Type1 fonts in PFA format (this requires encoding the binary section)
 #if wxUSE_UNICODE
-      // Type1 font
-      wxPdfFontParserType1 fontParser;
-      wxPdfFontData* fontData = fontParser.IdentifyFont(fileName.GetFullPath(), fontIndex);
-      if (fontData != NULL)
+    // Type1 font
+    wxPdfFontParserType1 fontParser;
+    wxPdfFontData* fontData = fontParser.IdentifyFont(fileName.GetFullPath(), fontIndex);
+    if (fontData != NULL)
+    {
+      fontData->SetAlias(aliasName);
+      SetFontBaseEncoding(fontData);
+      if (!AddFont(fontData, font))
       {
-        fontData->SetAlias(aliasName);
-        SetFontBaseEncoding(fontData);
-        if (!AddFont(fontData, font))
-        {
-          delete fontData;
-          wxLogDebug(wxString(wxS("wxPdfFontManagerBase::RegisterFont: ")) +
-                     wxString::Format(_("Font file '%s' already registered."), fontFileName.c_str()));
-        }
+        delete fontData;
+        wxLogDebug(wxString(wxS("wxPdfFontManagerBase::RegisterFont: ")) +
+                   wxString::Format(_("Font file '%s' already registered."), fullFontFileName.c_str()));
       }
+    }
 #else
-      wxLogError(wxString(wxS("wxPdfFontManagerBase::RegisterFont: ")) +
-                 wxString::Format(_("Format of font file '%s' not supported."), fontFileName.c_str()));
+    wxLogError(wxString(wxS("wxPdfFontManagerBase::RegisterFont: ")) +
+               wxString::Format(_("Format of font file '%s' not supported."), fullFontFileName.c_str()));
 #endif
-    }
-    else if (ext.IsSameAs(wxS("xml")))
+  }
+  else if (ext.IsSameAs(wxS("xml")))
+  {
+    // wxPdfDocument font description file
+    wxPdfFontData* fontData = LoadFontFromXML(fullFontFileName);
+    if (fontData != NULL)
     {
-      // wxPdfDocument font description file
-      wxPdfFontData* fontData = LoadFontFromXML(fullFontFileName);
-      if (fontData != NULL)
+      fontData->SetAlias(aliasName);
+      SetFontBaseEncoding(fontData);
+      if (!AddFont(fontData, font))
       {
-        fontData->SetAlias(aliasName);
-        SetFontBaseEncoding(fontData);
-        if (!AddFont(fontData, font))
-        {
-          delete fontData;
-          wxLogDebug(wxString(wxS("wxPdfFontManagerBase::RegisterFont: ")) +
-                     wxString::Format(_("Font file '%s' already registered."), fontFileName.c_str()));
-        }
+        delete fontData;
+        wxLogDebug(wxString(wxS("wxPdfFontManagerBase::RegisterFont: ")) +
+                   wxString::Format(_("Font file '%s' already registered."), fullFontFileName.c_str()));
       }
     }
-    else
-    {
-      wxLogError(wxString(wxS("wxPdfFontManagerBase::RegisterFont: ")) +
-                 wxString::Format(_("Format of font file '%s' not supported."), fontFileName.c_str()));
-    }
   }
   else
   {
     wxLogError(wxString(wxS("wxPdfFontManagerBase::RegisterFont: ")) +
-               wxString::Format(_("Font file '%s' does not exist or is not readable."), fontFileName.c_str()));
+               wxString::Format(_("Format of font file '%s' not supported."), fullFontFileName.c_str()));
   }
   return font;
 }
@@ -852,12 +1336,11 @@ wxPdfFontManagerBase::RegisterFontCollection(const wxString& fontCollectionFileN
     wxFileName fileName(fullFontCollectionFileName);
     if (fileName.IsOk() && fileName.GetExt().Lower().IsSameAs(wxS("ttc")))
     {
-      wxPdfFontParserTrueType fontParser;
-      int fontCount = fontParser.GetCollectionFontCount(fullFontCollectionFileName);
+      int fontCount = GetCollectionFontCount(fileName.GetFullPath());
       int j;
       for (j = 0; j < fontCount; ++j)
       {
-        wxPdfFont registeredFont = RegisterFont(fileName.GetFullPath(), wxEmptyString, j);
+        wxPdfFont registeredFont = RegisterFontFile(fileName.GetFullPath(), wxEmptyString, j);
         if (registeredFont.IsValid())
         {
           ++count;
@@ -883,8 +1366,12 @@ bool
 wxPdfFontManagerBase::RegisterFontCJK(const wxString& family)
 {
   bool ok = false;
-  wxPdfFontFamilyMap::const_iterator familyIter = m_fontFamilyMap.find(family.Lower());
-  if (familyIter == m_fontFamilyMap.end())
+  bool registered;
+  {
+    wxPdfFontManagerLookup snapshot(this);
+    registered = snapshot->m_fontFamilyMap.find(family.Lower()) != snapshot->m_fontFamilyMap.end();
+  }
+  if (!registered)
   {
     wxString fontFileName = family.Lower() + wxString(wxS(".xml"));
     wxString fullFontFileName;
@@ -946,35 +1433,30 @@ wxPdfFontManagerBase::RegisterSystemFonts()
   wxString strValueName;
   wxString strValueData;
   wxString fontFileName;
+  wxArrayString fontFileNames;
+  wxArrayInt fontIndices;
   long nIndex;
   fontRegKey->GetFirstValue(strValueName, nIndex);
   size_t i;
   for (i = 0; i < nValues; ++i)
   {
-    // suppress possible error messages
-    wxLogNull nolog;
-
     fontRegKey->QueryValue(strValueName, fontFileName);
     if (fontFileName.Find(wxS('\\')) == wxNOT_FOUND)
     {
       fontFileName.Prepend(fontDirectory);
     }
-    if (fontFileName.Lower().EndsWith(wxS(".ttc")))
-    {
-      count += RegisterFontCollection(fontFileName);
-    }
-    else
-    {
-      wxPdfFont registeredFont = RegisterFont(fontFileName);
-      if (registeredFont.IsValid())
-      {
-        ++count;
-      }
-    }
+    fontFileNames.Add(fontFileName);
+    fontIndices.Add(fontFileName.Lower().EndsWith(wxS(".ttc")) ? -1 : 0);
     fontRegKey->GetNextValue(strValueName, nIndex);
   }
   fontRegKey->Close();
   delete fontRegKey;
+
+  {
+    // suppress possible error messages
+    wxLogNull nolog;
+    count = RegisterFontFiles(fontFileNames, fontIndices);
+  }
 #elif defined(__WXGTK__)
 #if 0
   // TODO: Do we need to load the fontconfig library?
@@ -1002,6 +1484,8 @@ wxPdfFontManagerBase::RegisterSystemFonts()
   FcPatternDestroy(pat);
   if (fs != NULL)
   {
+    wxArrayString fontFileNames;
+    wxArrayInt fontIndices;
     int j;
     for (j = 0; j < fs->nfont; ++j)
     {
@@ -1014,15 +1498,12 @@ wxPdfFontManagerBase::RegisterSystemFonts()
         {
           fontFileIndex = id;
         }
-        wxString fontFileName = wxString::FromUTF8((char*) file);
-        wxPdfFont registeredFont = RegisterFont(fontFileName, wxEmptyString, fontFileIndex);
-        if (registeredFont.IsValid())
-        {
-          ++count;
-        }
+        fontFileNames.Add(wxString::FromUTF8((char*) file));
+        fontIndices.Add(fontFileIndex);
       }
     }
     FcFontSetDestroy(fs);
+    count = RegisterFontFiles(fontFileNames, fontIndices);
   }
 #elif defined(__WXMAC__)
   count += RegisterFontDirectory(wxS("/System/Library/Fonts"));
@@ -1031,14 +1512,15 @@ wxPdfFontManagerBase::RegisterSystemFonts()
   wxLogWarning(wxString(wxS("wxPdfFontManagerBase::RegisterSystemFonts: ")) +
                wxString(_("Method is not available for your platform.")));
 #endif
+  SaveFontIndex();
   return count;
 }
 
 class wxPdfFontDirTraverser : public wxDirTraverser
 {
 public:
-  wxPdfFontDirTraverser(wxPdfFontManagerBase* fontManager)
-    : m_fontManager(fontManager), m_count(0)
+  wxPdfFontDirTraverser(wxArrayString& fontFileNames, wxArrayInt& fontIndices)
+    : m_fontFileNames(fontFileNames), m_fontIndices(fontIndices)
   {
   }
 
@@ -1049,15 +1531,13 @@ public:
     if (ext.IsSameAs(wxS("ttf")) || ext.IsSameAs(wxS("otf")) ||
         /* ext.IsSameAs(wxS("pfa")) || */ ext.IsSameAs(wxS("pfb")))
     {
-      wxPdfFont registeredFont = m_fontManager->RegisterFont(fontFileName.GetFullPath());
-      if (registeredFont.IsValid())
-      {
-        ++m_count;
-      }
+      m_fontFileNames.Add(fontFileName.GetFullPath());
+      m_fontIndices.Add(0);
     }
     else if (ext.IsSameAs(wxS("ttc")))
     {
-      m_count += m_fontManager->RegisterFontCollection(fontFileName.GetFullPath());
+      m_fontFileNames.Add(fontFileName.GetFullPath());
+      m_fontIndices.Add(-1);
     }
     return wxDIR_CONTINUE;
   }
@@ -1067,14 +1547,9 @@ public:
     return wxDIR_CONTINUE;
   }
 
-  int GetCount() const
-  {
-    return m_count;
-  }
-
 private:
-  wxPdfFontManagerBase* m_fontManager;
-  int                   m_count;
+  wxArrayString& m_fontFileNames;
+  wxArrayInt&    m_fontIndices;
 };
 
 int
@@ -1086,10 +1561,13 @@ wxPdfFontManagerBase::RegisterFontDirectory(const wxString& directory, bool recu
     wxDir fontDir(directory);
     if (fontDir.IsOpened())
     {
-      wxPdfFontDirTraverser fontDirTraverser(this);
+      wxArrayString fontFileNames;
+      wxArrayInt fontIndices;
+      wxPdfFontDirTraverser fontDirTraverser(fontFileNames, fontIndices);
       int flags = (recursive) ? wxDIR_FILES | wxDIR_DIRS : wxDIR_FILES;
       fontDir.Traverse(fontDirTraverser, wxEmptyString, flags);
-      count = fontDirTraverser.GetCount();
+      count = RegisterFontFiles(fontFileNames, fontIndices);
+      SaveFontIndex();
     }
     else
     {
@@ -1104,35 +1582,342 @@ wxPdfFontManagerBase::RegisterFontDirectory(const wxString& directory, bool recu
   }
   return count;
 }
+
+/// Scanner identifying font files in parallel (For internal use only)
+class wxPdfFontScanner
+{
+public:
+  /// Constructor
+  wxPdfFontScanner(wxPdfFontManagerBase* fontManager, const wxArrayString& fontFileNames)
+    : m_fontManager(fontManager), m_fontFileNames(fontFileNames), m_next(0)
+  {
+  }
+
+  /// Identify font files until all files are processed
+  void Scan()
+  {
+    // Errors are reported when the fonts are actually registered
+    wxLogNull logNull;
+    wxString fontFileName;
+    while (GetNextFile(fontFileName))
+    {
+      m_fontManager->ScanFontFile(fontFileName);
+    }
+  }
+
+private:
+  /// Get the next font file to be identified (thread safe)
+  bool GetNextFile(wxString& fontFileName)
+  {
+#if wxUSE_THREADS
+    wxCriticalSectionLocker locker(m_cs);
 #endif
+    bool ok = m_next < m_fontFileNames.GetCount();
+    if (ok)
+    {
+      // Deep copy, since the string data must not be shared between threads
+      fontFileName = wxString(m_fontFileNames[m_next++].wc_str());
+    }
+    return ok;
+  }
 
-wxPdfFont
-wxPdfFontManagerBase::GetFont(const wxString& fontName, int fontStyle) const
+  wxPdfFontManagerBase* m_fontManager;   ///< font manager to be updated
+  const wxArrayString&  m_fontFileNames; ///< list of font files
+  size_t                m_next;          ///< index of next font file to be identified
+#if wxUSE_THREADS
+  wxCriticalSection     m_cs;            ///< critical section for file distribution
+#endif
+};
+
+#if wxUSE_THREADS
+/// Thread identifying font files (For internal use only)
+class wxPdfFontScanThread : public wxThread
+{
+public:
+  /// Constructor
+  wxPdfFontScanThread(wxPdfFontScanner* scanner)
+    : wxThread(wxTHREAD_JOINABLE), m_scanner(scanner)
+  {
+  }
+
+protected:
+  /// Identify font files until none is left
+  virtual ExitCode Entry() wxOVERRIDE
+  {
+    m_scanner->Scan();
+    return 0;
+  }
+
+private:
+  wxPdfFontScanner* m_scanner; ///< scanner the thread belongs to
+};
+#endif
+
+static bool
+GetFontFileStamp(const wxString& fileName, wxLongLong& size, wxLongLong& modified)
 {
+  // A single status query provides everything required to validate a font index entry
+  wxStructStat fileStat;
+  bool ok = (wxStat(fileName, &fileStat) == 0);
+  if (ok)
+  {
+    size = wxLongLong((wxLongLong_t) fileStat.st_size);
+    modified = wxLongLong((wxLongLong_t) fileStat.st_mtime);
+  }
+  return ok;
+}
+
+static wxPdfFontIndexEntry&
+GetFontIndexEntry(wxPdfFontIndexMap& fontIndex, const wxString& fileName, const wxLongLong& size, const wxLongLong& modified)
+{
+  wxPdfFontIndexEntry& entry = fontIndex[fileName];
+  if (entry.m_size != size || entry.m_modified != modified)
+  {
+    // Font file was changed, forget everything known about it
+    entry.m_size = size;
+    entry.m_modified = modified;
+    entry.m_fontCount = -1;
+    entry.m_faces.clear();
+  }
+  entry.m_used = true;
+  return entry;
+}
+
+wxPdfFontData*
+wxPdfFontManagerBase::IdentifyFontFile(const wxString& fullFontFileName, int fontIndex)
+{
+  wxPdfFontData* fontData = NULL;
+  wxString ext = wxFileName(fullFontFileName).GetExt().Lower();
+  if (!ext.IsSameAs(wxS("ttc")))
+  {
+    // Only font collections contain more than one font
+    fontIndex = 0;
+  }
+
+  wxLongLong size;
+  wxLongLong modified;
+  bool indexed = fontIndex >= 0 && GetFontFileStamp(fullFontFileName, size, modified);
+  if (indexed)
+  {
 #if wxUSE_THREADS
-  wxCriticalSectionLocker locker(gs_csFontManager);
+    wxCriticalSectionLocker locker(gs_csFontIndex);
+#endif
+    wxPdfFontIndexMap::iterator entry = m_fontIndex.find(fullFontFileName);
+    if (entry != m_fontIndex.end() && entry->second.m_size == size && entry->second.m_modified == modified)
+    {
+      entry->second.m_used = true;
+      std::map<int, wxPdfFontIndexFace>::const_iterator faceIter = entry->second.m_faces.find(fontIndex);
+      if (faceIter != entry->second.m_faces.end())
+      {
+        const wxPdfFontIndexFace& face = faceIter->second;
+        if (face.m_type.IsSameAs(wxS("OpenTypeUnicode")))
+        {
+          wxPdfFontDataOpenTypeUnicode* otfFontData = new wxPdfFontDataOpenTypeUnicode();
+          otfFontData->SetCffOffset(face.m_cffOffset);
+          otfFontData->SetCffLength(face.m_cffLength);
+          fontData = otfFontData;
+        }
+        else
+        {
+          fontData = new wxPdfFontDataTrueTypeUnicode();
+        }
+        fontData->SetName(face.m_name);
+        fontData->m_family = face.m_family;
+        fontData->SetFullNames(face.m_fullNames);
+        fontData->SetStyle(face.m_style);
+        fontData->SetEmbedSupported(face.m_embedSupported);
+        fontData->SetSubsetSupported(face.m_subsetSupported);
+        fontData->SetFontFileName(fullFontFileName);
+        fontData->SetFontIndex(fontIndex);
+      }
+    }
+  }
+
+  if (fontData == NULL)
+  {
+    wxPdfFontParserTrueType fontParser;
+    fontData = fontParser.IdentifyFont(fullFontFileName, fontIndex);
+    if (fontData != NULL && indexed)
+    {
+#if wxUSE_THREADS
+      wxCriticalSectionLocker locker(gs_csFontIndex);
+#endif
+      wxPdfFontIndexEntry& entry = GetFontIndexEntry(m_fontIndex, fullFontFileName, size, modified);
+      wxPdfFontIndexFace& face = entry.m_faces[fontIndex];
+      face.m_type = fontData->GetType();
+      face.m_name = fontData->GetName();
+      face.m_family = fontData->m_family;
+      face.m_fullNames = fontData->GetFullNames();
+      face.m_style = fontData->GetStyle();
+      face.m_embedSupported = fontData->EmbedSupported();
+      face.m_subsetSupported = fontData->SubsetSupported();
+      face.m_cffOffset = fontData->GetCffOffset();
+      face.m_cffLength = fontData->GetCffLength();
+      m_fontIndexModified = true;
+    }
+  }
+  return fontData;
+}
+
+int
+wxPdfFontManagerBase::GetCollectionFontCount(const wxString& fullFontFileName)
+{
+  int fontCount = -1;
+  wxLongLong size;
+  wxLongLong modified;
+  bool indexed = GetFontFileStamp(fullFontFileName, size, modified);
+  if (indexed)
+  {
+#if wxUSE_THREADS
+    wxCriticalSectionLocker locker(gs_csFontIndex);
+#endif
+    wxPdfFontIndexMap::iterator entry = m_fontIndex.find(fullFontFileName);
+    if (entry != m_fontIndex.end() && entry->second.m_size == size && entry->second.m_modified == modified)
+    {
+      entry->second.m_used = true;
+      fontCount = entry->second.m_fontCount;
+    }
+  }
+
+  if (fontCount < 0)
+  {
+    wxPdfFontParserTrueType fontParser;
+    fontCount = fontParser.GetCollectionFontCount(fullFontFileName);
+    if (fontCount > 0 && indexed)
+    {
+#if wxUSE_THREADS
+      wxCriticalSectionLocker locker(gs_csFontIndex);
+#endif
+      GetFontIndexEntry(m_fontIndex, fullFontFileName, size, modified).m_fontCount = fontCount;
+      m_fontIndexModified = true;
+    }
+  }
+  return fontCount;
+}
+
+int
+wxPdfFontManagerBase::RegisterFontFiles(const wxArrayString& fontFileNames, const wxArrayInt& fontIndices)
+{
+  int count = 0;
+  if (GetFontScanThreads() > 1)
+  {
+    // Identify all font files in parallel; registration below then uses the font index
+    wxPdfFontNameMap fileMap;
+    wxArrayString scanFileNames;
+    size_t j;
+    for (j = 0; j < fontFileNames.GetCount(); ++j)
+    {
+      if (fileMap.find(fontFileNames[j]) == fileMap.end())
+      {
+        fileMap[fontFileNames[j]] = (int) j;
+        scanFileNames.Add(fontFileNames[j]);
+      }
+    }
+    ScanFontFiles(scanFileNames);
+  }
+
+  size_t j;
+  for (j = 0; j < fontFileNames.GetCount(); ++j)
+  {
+    if (fontIndices[j] < 0)
+    {
+      count += RegisterFontCollection(fontFileNames[j]);
+    }
+    else
+    {
+      wxPdfFont registeredFont = RegisterFontFile(fontFileNames[j], wxEmptyString, fontIndices[j]);
+      if (registeredFont.IsValid())
+      {
+        ++count;
+      }
+    }
+  }
+  return count;
+}
+
+void
+wxPdfFontManagerBase::ScanFontFiles(const wxArrayString& fontFileNames)
+{
+  wxPdfFontScanner scanner(this, fontFileNames);
+#if wxUSE_THREADS
+  std::vector<wxThread*> threads;
+  // The calling thread takes part in identifying the font files
+  int numThreads = wxMin(GetFontScanThreads(), (int) fontFileNames.GetCount()) - 1;
+  int j;
+  for (j = 0; j < numThreads; ++j)
+  {
+    wxPdfFontScanThread* thread = new wxPdfFontScanThread(&scanner);
+    if (thread->Run() == wxTHREAD_NO_ERROR)
+    {
+      threads.push_back(thread);
+    }
+    else
+    {
+      delete thread;
+      break;
+    }
+  }
+#endif
+
+  scanner.Scan();
+
+#if wxUSE_THREADS
+  size_t k;
+  for (k = 0; k < threads.size(); ++k)
+  {
+    threads[k]->Wait();
+    delete threads[k];
+  }
+#endif
+}
+
+void
+wxPdfFontManagerBase::ScanFontFile(const wxString& fullFontFileName)
+{
+  wxString ext = wxFileName(fullFontFileName).GetExt().Lower();
+  if (ext.IsSameAs(wxS("ttc")))
+  {
+    int fontCount = GetCollectionFontCount(fullFontFileName);
+    int j;
+    for (j = 0; j < fontCount; ++j)
+    {
+      delete IdentifyFontFile(fullFontFileName, j);
+    }
+  }
+  else if (ext.IsSameAs(wxS("ttf")) || ext.IsSameAs(wxS("otf")) ||
+           ext.IsSameAs(wxS("woff")) || ext.IsSameAs(wxS("woff2")))
+  {
+    delete IdentifyFontFile(fullFontFileName, 0);
+  }
+}
 #endif
+
+wxPdfFont
+wxPdfFontManagerBase::GetFont(const wxString& fontName, int fontStyle) const
+{
+  // Lookups use the current snapshot of the lookup tables without locking
+  wxPdfFontManagerLookup snapshot(this);
   wxString lcFontName = fontName.Lower();
   int searchStyle = (fontStyle & ~wxPDF_FONTSTYLE_DECORATION_MASK) & wxPDF_FONTSTYLE_MASK;
   wxPdfFontData* fontData = NULL;
 
   // 0. Determine whether a family alias exists
-  wxPdfFontFamilyMap::const_iterator familyAliasIter = m_fontFamilyMap.end();
-  wxPdfFontAliasMap::const_iterator aliasIter = m_fontAliasMap.find(lcFontName);
-  if (aliasIter != m_fontAliasMap.end())
+  wxPdfFontFamilyMap::const_iterator familyAliasIter = snapshot->m_fontFamilyMap.end();
+  wxPdfFontAliasMap::const_iterator aliasIter = snapshot->m_fontAliasMap.find(lcFontName);
+  if (aliasIter != snapshot->m_fontAliasMap.end())
   {
-    familyAliasIter = m_fontFamilyMap.find(aliasIter->second);
+    familyAliasIter = snapshot->m_fontFamilyMap.find(aliasIter->second);
   }
 
   // Check whether font name equals font family
-  wxPdfFontFamilyMap::const_iterator familyIter = m_fontFamilyMap.find(lcFontName);
-  if (familyIter == m_fontFamilyMap.end())
+  wxPdfFontFamilyMap::const_iterator familyIter = snapshot->m_fontFamilyMap.find(lcFontName);
+  if (familyIter == snapshot->m_fontFamilyMap.end())
   {
     // 1. Use family alias (may be empty)
     familyIter = familyAliasIter;
   }
 
-  if (familyIter != m_fontFamilyMap.end())
+  if (familyIter != snapshot->m_fontFamilyMap.end())
   {
     // 2. Check whether the family contains a font with the requested style
     size_t n = familyIter->second.GetCount();
@@ -1141,7 +1926,7 @@ wxPdfFontManagerBase::GetFont(const wxString& fontName, int fontStyle) const
     {
       for (j = 0; j < n && fontData == NULL; ++j)
       {
-        fontData = m_fontList[familyIter->second[j]]->GetFontData();
+        fontData = snapshot->m_fontList[familyIter->second[j]];
         if (fontData->GetStyle() != searchStyle)
         {
           fontData = NULL;
@@ -1151,7 +1936,7 @@ wxPdfFontManagerBase::GetFont(const wxString& fontName, int fontStyle) const
       // Search in alias font family if not already searched
       if (fontData == NULL && familyAliasIter != familyIter)
       {
-        if (familyAliasIter != m_fontFamilyMap.end())
+        if (familyAliasIter != snapshot->m_fontFamilyMap.end())
         {
           familyIter = familyAliasIter;
           n = familyIter->second.GetCount();
@@ -1164,10 +1949,10 @@ wxPdfFontManagerBase::GetFont(const wxString& fontName, int fontStyle) const
   if (fontData == NULL)
   {
     // 3. Check whether a font is registered under the given name
-    wxPdfFontNameMap::const_iterator fontIter = m_fontNameMap.find(lcFontName);
-    if (fontIter != m_fontNameMap.end())
+    wxPdfFontNameMap::const_iterator fontIter = snapshot->m_fontNameMap.find(lcFontName);
+    if (fontIter != snapshot->m_fontNameMap.end())
     {
-      wxPdfFontData* candidate = m_fontList[fontIter->second]->GetFontData();
+      wxPdfFontData* candidate = snapshot->m_fontList[fontIter->second];
       // only accept if no specific style was requested or the candidate's style matches
       if (searchStyle == wxPDF_FONTSTYLE_REGULAR || candidate->GetStyle() == searchStyle)
       {
@@ -1182,10 +1967,10 @@ wxPdfFontManagerBase::GetFont(const wxString& fontName, int fontStyle) const
       const int weight = searchStyle & wxPDF_FONTSTYLE_WEIGHT_MASK;
       // Map Medium and above to Bold; map anything lighter than Medium to Regular
       const int fallbackStyle = (searchStyle & wxPDF_FONTSTYLE_ITALIC) | (weight >= wxPDF_FONTSTYLE_MEDIUM ? wxPDF_FONTSTYLE_BOLD : wxPDF_FONTSTYLE_REGULAR);
-      familyIter = m_fontFamilyMap.find(lcFontName);
-      if (familyIter == m_fontFamilyMap.end())
+      familyIter = snapshot->m_fontFamilyMap.find(lcFontName);
+      if (familyIter == snapshot->m_fontFamilyMap.end())
         familyIter = familyAliasIter;
-      if (familyIter != m_fontFamilyMap.end())
+      if (familyIter != snapshot->m_fontFamilyMap.end())
       {
         // First, search within the font family (including aliases)
         size_t n = familyIter->second.GetCount();
@@ -1194,12 +1979,12 @@ wxPdfFontManagerBase::GetFont(const wxString& fontName, int fontStyle) const
         {
           for (j = 0; j < n && fontData == NULL; ++j)
           {
-            wxPdfFontData* data = m_fontList[familyIter->second[j]]->GetFontData();
+            wxPdfFontData* data = snapshot->m_fontList[familyIter->second[j]];
             if (data->GetStyle() == fallbackStyle)
               fontData = data;
           }
           n = 0;
-          if (fontData == NULL && familyAliasIter != familyIter && familyAliasIter != m_fontFamilyMap.end())
+          if (fontData == NULL && familyAliasIter != familyIter && familyAliasIter != snapshot->m_fontFamilyMap.end())
           {
             familyIter = familyAliasIter;
             n = familyIter->second.GetCount();
@@ -1209,10 +1994,10 @@ wxPdfFontManagerBase::GetFont(const wxString& fontName, int fontStyle) const
       if (fontData == NULL)
       {
         // If still not found, check if a font was registered directly under this name with the fallback style
-        wxPdfFontNameMap::const_iterator foundFontIter = m_fontNameMap.find(lcFontName);
-        if (foundFontIter != m_fontNameMap.end())
+        wxPdfFontNameMap::const_iterator foundFontIter = snapshot->m_fontNameMap.find(lcFontName);
+        if (foundFontIter != snapshot->m_fontNameMap.end())
         {
-          wxPdfFontData* candidate = m_fontList[foundFontIter->second]->GetFontData();
+          wxPdfFontData* candidate = snapshot->m_fontList[foundFontIter->second];
           if (candidate->GetStyle() == fallbackStyle)
             fontData = candidate;
         }
@@ -1227,8 +2012,8 @@ wxPdfFontManagerBase::GetFont(const wxString& fontName, int fontStyle) const
     }
   }
   wxPdfFont font(fontData, fontStyle);
-  font.SetEmbed(m_defaultEmbed);
-  font.SetSubset(m_defaultSubset);
+  font.SetEmbed(m_defaultEmbed.load());
+  font.SetSubset(m_defaultSubset.load());
   return font;
 }
 
@@ -1244,13 +2029,11 @@ wxPdfFontManagerBase::GetFont(const wxString& fontName, const wxString& fontStyl
 wxPdfFont
 wxPdfFontManagerBase::GetFont(size_t fontIndex) const
 {
-#if wxUSE_THREADS
-  wxCriticalSectionLocker locker(gs_csFontManager);
-#endif
+  wxPdfFontManagerLookup snapshot(this);
   wxPdfFont font;
-  if (fontIndex < m_fontList.GetCount())
+  if (fontIndex < snapshot->m_fontList.size())
   {
-    font = wxPdfFont(m_fontList[fontIndex]->GetFontData());
+    font = wxPdfFont(snapshot->m_fontList[fontIndex]);
   }
   return font;
 }
@@ -1258,10 +2041,7 @@ wxPdfFontManagerBase::GetFont(size_t fontIndex) const
 size_t
 wxPdfFontManagerBase::GetFontCount() const
 {
-#if wxUSE_THREADS
-  wxCriticalSectionLocker locker(gs_csFontManager);
-#endif
-  return m_fontList.GetCount();
+  return wxPdfFontManagerLookup(this)->m_fontList.size();
 }
 
 bool
@@ -1287,19 +2067,21 @@ wxPdfFontManagerBase::RegisterEncoding(const wxPdfEncoding& encoding)
 {
   bool ok = true;
   wxString encodingName = encoding.GetEncodingName().Lower();
-  if (m_encodingMap->find(encodingName) == m_encodingMap->end())
-  {
 #if wxUSE_THREADS
-    wxCriticalSectionLocker locker(gs_csFontManager);
+  wxCriticalSectionLocker locker(gs_csFontManager);
 #endif
+  if (m_encodingMap->find(encodingName) == m_encodingMap->end())
+  {
     wxPdfEncoding* addedEncoding = new wxPdfEncoding(encoding);
     if (addedEncoding->IsOk())
     {
       addedEncoding->InitializeEncodingMap();
       (*m_encodingMap)[encodingName] = addedEncoding;
+      ++m_generation;
     }
     else
     {
+      delete addedEncoding;
       ok = false;
     }
   }
@@ -1321,6 +2103,9 @@ wxPdfFontManagerBase::SetFontBaseEncoding(wxPdfFontData* fontData)
     {
       if (RegisterEncoding(encoding))
       {
+#if wxUSE_THREADS
+        wxCriticalSectionLocker locker(gs_csFontManager);
+#endif
         wxPdfEncodingMap::const_iterator beIter = m_encodingMap->find(encoding);
         wxPdfEncoding* baseEncoding = (beIter != m_encodingMap->end()) ? beIter->second : NULL;
         fontData->SetEncoding(baseEncoding);
@@ -1338,18 +2123,31 @@ wxPdfFontManagerBase::SetFontBaseEncoding(wxPdfFontData* fontData)
 const wxPdfEncoding*
 wxPdfFontManagerBase::GetEncoding(const wxString& encodingName)
 {
-#if wxUSE_THREADS
-  wxCriticalSectionLocker locker(gs_csFontManager);
-#endif
   wxPdfEncoding* foundEncoding = NULL;
-  if (RegisterEncoding(encodingName))
+  wxString lcEncodingName = encodingName.Lower();
   {
-    wxPdfEncodingMap::const_iterator encoding = m_encodingMap->find(encodingName.Lower());
-    if (encoding != m_encodingMap->end())
+    wxPdfFontManagerLookup snapshot(this);
+    wxPdfEncodingMap::const_iterator encoding = snapshot->m_encodingMap.find(lcEncodingName);
+    if (encoding != snapshot->m_encodingMap.end())
     {
       foundEncoding = encoding->second;
     }
   }
+  if (foundEncoding == NULL)
+  {
+    // Encoding not yet registered
+#if wxUSE_THREADS
+    wxCriticalSectionLocker locker(gs_csFontManager);
+#endif
+    if (RegisterEncoding(encodingName))
+    {
+      wxPdfEncodingMap::iterator encoding = m_encodingMap->find(lcEncodingName);
+      if (encoding != m_encodingMap->end())
+      {
+        foundEncoding = encoding->second;
+      }
+    }
+  }
   return foundEncoding;
 }
 
@@ -1468,6 +2266,9 @@ wxPdfFontManagerBase::RegisterEncoding(const wxString& encoding)
 {
   bool ok = true;
   wxString encodingName = encoding.Lower();
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csFontManager);
+#endif
   if (m_encodingMap->find(encodingName) == m_encodingMap->end())
   {
     wxPdfEncoding* addedEncoding = new wxPdfEncoding();
@@ -1475,6 +2276,7 @@ wxPdfFontManagerBase::RegisterEncoding(const wxString& encoding)
     {
       addedEncoding->InitializeEncodingMap();
       (*m_encodingMap)[encodingName] = addedEncoding;
+      ++m_generation;
     }
     else
     {
@@ -1608,12 +2410,10 @@ wxPdfFontManagerBase::LoadFontFromXML(const wxString& fontFileName)
 bool
 wxPdfFontManagerBase::IsRegistered(wxPdfFontData* fontData)
 {
-#if wxUSE_THREADS
-  wxCriticalSectionLocker locker(gs_csFontManager);
-#endif
+  wxPdfFontManagerLookup snapshot(this);
   wxString fontName = fontData->GetName();
-  wxPdfFontNameMap::const_iterator font = m_fontNameMap.find(fontName.Lower());
-  return (font != m_fontNameMap.end());
+  wxPdfFontNameMap::const_iterator font = snapshot->m_fontNameMap.find(fontName.Lower());
+  return (font != snapshot->m_fontNameMap.end());
 }
 
 bool
@@ -1664,6 +2464,7 @@ wxPdfFontManagerBase::AddFont(wxPdfFontData* fontData, wxPdfFont& font)
     {
       m_fontFamilyMap[alias].Add(pos);
     }
+    ++m_generation;
   }
   else
   {
@@ -1688,6 +2489,7 @@ wxPdfFontManagerBase::AddFont(wxPdfFontData* fontData, wxPdfFont& font)
     {
       // alias not previously assigned, remember assignment
       m_fontAliasMap[alias] = family;
+      ++m_generation;
     }
   }
   return ok;
@@ -1820,6 +2622,36 @@ wxPdfFontManager::RegisterFontDirectory(const wxString& directory, bool recursiv
 #endif
 }
 
+bool
+wxPdfFontManager::SetFontIndexFile(const wxString& indexFileName)
+{
+  return m_fontManagerBase->SetFontIndexFile(indexFileName);
+}
+
+wxString
+wxPdfFontManager::GetFontIndexFile() const
+{
+  return m_fontManagerBase->GetFontIndexFile();
+}
+
+bool
+wxPdfFontManager::SaveFontIndex()
+{
+  return m_fontManagerBase->SaveFontIndex();
+}
+
+int
+wxPdfFontManager::SetFontScanThreads(int numThreads)
+{
+  return m_fontManagerBase->SetFontScanThreads(numThreads);
+}
+
+int
+wxPdfFontManager::GetFontScanThreads() const
+{
+  return m_fontManagerBase->GetFontScanThreads();
+}
+
 wxPdfFont
 wxPdfFontManager::GetFont(const wxString& fontName, int fontStyle) const
 {
@@ -819,8 +819,15 @@ wxPdfFontParserTrueType::LoadFontData(wxPdfFontData* fontData)
     if (!m_fileName.IsEmpty())
     {
       wxFileName fileName(m_fileName);
+      bool isWoff = fileName.GetExt().Lower().IsSameAs(wxS("woff")) || fileName.GetExt().Lower().IsSameAs(wxS("woff2"));
+      if (!isWoff)
+      {
+        // Map the font file into memory; the mapping is kept by the font data for embedding
+        fontStream = fontData->GetMappedFontStream(fileName.GetFullPath());
+        m_inFont = fontStream;
+      }
       wxFileSystem fs;
-      fontFile = fs.OpenFile(wxFileSystem::FileNameToURL(fileName));
+      fontFile = (fontStream == nullptr) ? fs.OpenFile(wxFileSystem::FileNameToURL(fileName)) : nullptr;
       if (fontFile)
       {
         m_inFont = fontFile->GetStream();
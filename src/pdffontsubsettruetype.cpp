@@ -57,7 +57,7 @@ wxPdfFontSubsetTrueType::SetCTFontRef(const wxFont& font)
 #endif
 
 wxMemoryOutputStream*
-wxPdfFontSubsetTrueType::CreateSubset(wxInputStream* inFont, wxPdfSortedArrayInt* usedGlyphs, bool includeCmap)
+wxPdfFontSubsetTrueType::CreateSubset(wxInputStream* inFont, wxPdfGlyphSet* usedGlyphs, bool includeCmap)
 {
   m_inFont = inFont;
   m_usedGlyphs = usedGlyphs;
@@ -150,16 +150,21 @@ wxPdfFontSubsetTrueType::CheckGlyphs()
   {
     tableLocation = entry->second;
     LockTable(wxS("glyf"));
-    int glyph0 = 0;
-    if (m_usedGlyphs->Index(glyph0) == wxNOT_FOUND)
+    m_usedGlyphs->Add(0);
+    m_glyfTableOffset = tableLocation->m_offset;
+
+    // Components of composite glyphs may be composite glyphs themselves
+    wxPdfArrayUint32 pendingGlyphs;
+    int glyph;
+    for (glyph = m_usedGlyphs->FindNext(0); glyph != wxNOT_FOUND; glyph = m_usedGlyphs->FindNext(glyph + 1))
     {
-      m_usedGlyphs->Add(glyph0);
+      pendingGlyphs.Add(glyph);
     }
-    m_glyfTableOffset = tableLocation->m_offset;
-    size_t k;
-    for (k = 0; k < m_usedGlyphs->GetCount(); k++)
+    while (!pendingGlyphs.IsEmpty())
     {
-      FindGlyphComponents(m_usedGlyphs->Item(k));
+      glyph = pendingGlyphs.Last();
+      pendingGlyphs.RemoveAt(pendingGlyphs.GetCount() - 1);
+      FindGlyphComponents(glyph, pendingGlyphs);
     }
     ok = true;
     ReleaseTable();
@@ -179,7 +184,7 @@ static const int FLAG_HAS_SCALE_XY        =  64;
 static const int FLAG_HAS_TWO_BY_TWO      = 128;
 
 void
-wxPdfFontSubsetTrueType::FindGlyphComponents(int glyph)
+wxPdfFontSubsetTrueType::FindGlyphComponents(int glyph, wxPdfArrayUint32& pendingGlyphs)
 {
 
   int glyphOffset = m_locaTable[glyph];
@@ -200,9 +205,9 @@ wxPdfFontSubsetTrueType::FindGlyphComponents(int glyph)
   {
     int flags = ReadUShort();
     int glyphComponent = (int) ReadUShort();
-    if (m_usedGlyphs->Index(glyphComponent) == wxNOT_FOUND)
+    if (m_usedGlyphs->Add(glyphComponent))
     {
-      m_usedGlyphs->Add(glyphComponent);
+      pendingGlyphs.Add(glyphComponent);
     }
     if ((flags & FLAG_HAS_MORE_COMPONENTS) == 0)
     {
@@ -229,15 +234,14 @@ wxPdfFontSubsetTrueType::FindGlyphComponents(int glyph)
 void
 wxPdfFontSubsetTrueType::CreateNewTables()
 {
-  size_t usedGlyphCount = m_usedGlyphs->GetCount();
   size_t k;
   m_newLocaTable = new int[m_locaTableSize];
 
   // Calculate new 'glyf' table size
   m_newGlyfTableSize = 0;
-  for (k = 0; k < usedGlyphCount; k++)
+  int glyph;
+  for (glyph = m_usedGlyphs->FindNext(0); glyph != wxNOT_FOUND; glyph = m_usedGlyphs->FindNext(glyph + 1))
   {
-    int glyph = (*m_usedGlyphs)[k];
     m_newGlyfTableSize += m_locaTable[glyph + 1] - m_locaTable[glyph];
   }
   m_newGlyfTableRealSize = m_newGlyfTableSize;
@@ -253,13 +257,11 @@ wxPdfFontSubsetTrueType::CreateNewTables()
   // Copy used glyphs to new 'glyf' table
   LockTable(wxS("glyf"));
   int newGlyphOffset = 0;
-  size_t glyphIndex = 0;
   for (k = 0; k < m_locaTableSize; k++)
   {
     m_newLocaTable[k] = newGlyphOffset;
-    if (glyphIndex < usedGlyphCount && (size_t)(*m_usedGlyphs)[glyphIndex] == k)
+    if (m_usedGlyphs->Contains((wxUint32) k))
     {
-      glyphIndex++;
       m_newLocaTable[k] = newGlyphOffset;
       int glyphOffset = m_locaTable[k];
       int glyphLength = m_locaTable[k + 1] - glyphOffset;
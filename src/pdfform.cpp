@@ -158,6 +158,7 @@ wxPdfDocument::OutIndirectObject(wxPdfIndirectObject* object)
   int generationId = object->GetGenerationId();
   if (m_offsets->count(objectId-1) == 0)
   {
+    FlushObject();
     (*m_offsets)[objectId-1] = m_buffer->TellO();
     OutAscii(wxString::Format(wxS("%d %d obj"), objectId, generationId));
     switch (object->GetType())
@@ -2203,10 +2203,25 @@ wxPdfGraphicsContext::GetTextExtent(const wxString& str,
   }
 }
 
-void wxPdfGraphicsContext::GetPartialTextExtents(const wxString& WXUNUSED(text), wxArrayDouble& widths) const
+void wxPdfGraphicsContext::GetPartialTextExtents(const wxString& text, wxArrayDouble& widths) const
 {
-  wxLogDebug(wxT("wxPdfGraphicsContext::GetPartialTextExtents - not implemented"));
   widths.Clear();
+  wxCHECK_RET(m_pdfDocument, wxT("wxPdfGraphicsContext::GetPartialTextExtents - no valid PDF document"));
+  wxCHECK_RET(!m_font.IsNull(), wxT("wxPdfGraphicsContext::GetPartialTextExtents - no valid font set") );
+
+  if (text.empty()) return;
+
+  // Measure all characters in a single pass and accumulate the advances
+  wxPdfArrayDouble advances;
+  m_pdfDocument->GetCharAdvances(text, advances);
+  widths.Alloc(advances.GetCount());
+  double w = 0;
+  size_t i;
+  for (i = 0; i < advances.GetCount(); ++i)
+  {
+    w += advances[i];
+    widths.Add(w);
+  }
 }
 
 void
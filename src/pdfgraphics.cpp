@@ -727,33 +727,31 @@ void
 wxPdfDocument::Line(double x1, double y1, double x2, double y2)
 {
   // Draw a line
-  OutAscii(wxPdfUtility::Double2String(x1*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(y1*m_k,2) + wxString(wxS(" m ")) +
-           wxPdfUtility::Double2String(x2*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(y2*m_k,2) + wxString(wxS(" l S")));
+  double start[2] = { x1*m_k, y1*m_k };
+  double end[2] = { x2*m_k, y2*m_k };
+  OutNumbers(start, 2, 2, "m ", false);
+  OutNumbers(end, 2, 2, "l S");
 }
 
 void
 wxPdfDocument::Rect(double x, double y, double w, double h, int style)
 {
-  wxString op;
+  const char* op;
   // Draw a rectangle
   if ((style & wxPDF_STYLE_FILLDRAW) == wxPDF_STYLE_FILL)
   {
-    op = wxS("f");
+    op = "re f";
   }
   else if ((style & wxPDF_STYLE_FILLDRAW) == wxPDF_STYLE_FILLDRAW)
   {
-    op = wxS("B");
+    op = "re B";
   }
   else
   {
-    op = wxS("S");
+    op = "re S";
   }
-  OutAscii(wxPdfUtility::Double2String(x*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(y*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(w*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(h*m_k,2) + wxString(wxS(" re ")) + op);
+  double values[4] = { x*m_k, y*m_k, w*m_k, h*m_k };
+  OutNumbers(values, 4, 2, op);
 }
 
 void
@@ -1665,18 +1663,14 @@ wxPdfDocument::ClippingText(double x, double y, const wxString& txt, bool outlin
 void
 wxPdfDocument::ClippingRect(double x, double y, double w, double h, bool outline)
 {
-  wxString op = outline ? wxS("S") : wxS("n");
   StartTransform();
-  OutAscii(wxPdfUtility::Double2String(x*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(y*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(w*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(h*m_k,2) + wxString(wxS(" re W ")) + op);
+  double values[4] = { x*m_k, y*m_k, w*m_k, h*m_k };
+  OutNumbers(values, 4, 2, outline ? "re W S" : "re W n");
 }
 
 void
 wxPdfDocument::ClippingEllipse(double x, double y, double rx, double ry, bool outline)
 {
-  wxString op = outline ? wxS("S") : wxS("n");
   if (ry <= 0)
   {
     ry = rx;
@@ -1685,35 +1679,16 @@ wxPdfDocument::ClippingEllipse(double x, double y, double rx, double ry, bool ou
   double ly = 4./3. * (sqrt(2.)-1.) * ry;
 
   StartTransform();
-  OutAscii(wxPdfUtility::Double2String((x+rx)*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(y*m_k,2) + wxString(wxS(" m ")) +
-           wxPdfUtility::Double2String((x+rx)*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String((y-ly)*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String((x+lx)*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String((y-ry)*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(x*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String((y-ry)*m_k,2) + wxString(wxS(" c")));
-
-  OutAscii(wxPdfUtility::Double2String((x-lx)*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String((y-ry)*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String((x-rx)*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String((y-ly)*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String((x-rx)*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(y*m_k,2) + wxString(wxS(" c")));
-
-  OutAscii(wxPdfUtility::Double2String((x-rx)*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String((y+ly)*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String((x-lx)*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String((y+ry)*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(x*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String((y+ry)*m_k,2) + wxString(wxS(" c")));
-
-  OutAscii(wxPdfUtility::Double2String((x+lx)*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String((y+ry)*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String((x+rx)*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String((y+ly)*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String((x+rx)*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(y*m_k,2) + wxString(wxS(" c W ")) + op);
+  double start[2] = { (x+rx)*m_k, y*m_k };
+  OutNumbers(start, 2, 2, "m ", false);
+  double curve1[6] = { (x+rx)*m_k, (y-ly)*m_k, (x+lx)*m_k, (y-ry)*m_k, x*m_k, (y-ry)*m_k };
+  OutNumbers(curve1, 6, 2, "c");
+  double curve2[6] = { (x-lx)*m_k, (y-ry)*m_k, (x-rx)*m_k, (y-ly)*m_k, (x-rx)*m_k, y*m_k };
+  OutNumbers(curve2, 6, 2, "c");
+  double curve3[6] = { (x-rx)*m_k, (y+ly)*m_k, (x-lx)*m_k, (y+ry)*m_k, x*m_k, (y+ry)*m_k };
+  OutNumbers(curve3, 6, 2, "c");
+  double curve4[6] = { (x+lx)*m_k, (y+ry)*m_k, (x+rx)*m_k, (y+ly)*m_k, (x+rx)*m_k, y*m_k };
+  OutNumbers(curve4, 6, 2, outline ? "c W S" : "c W n");
 }
 
 void
@@ -2548,12 +2523,12 @@ wxPdfDocument::Arrow(double x1, double y1, double x2, double y2, double linewidt
   SetLineWidth(0.2);
 
   //Draw an arrow head
-  OutAscii(wxPdfUtility::Double2String( x2*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String( y2*m_k,2) + wxString(wxS(" m ")) +
-           wxPdfUtility::Double2String( x3*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String( y3*m_k,2) + wxString(wxS(" l ")) +
-           wxPdfUtility::Double2String( x4*m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String( y4*m_k,2) + wxString(wxS(" l b")));
+  double p2[2] = { x2*m_k, y2*m_k };
+  double p3[2] = { x3*m_k, y3*m_k };
+  double p4[2] = { x4*m_k, y4*m_k };
+  OutNumbers(p2, 2, 2, "m ", false);
+  OutNumbers(p3, 2, 2, "l ", false);
+  OutNumbers(p4, 2, 2, "l b");
 
   SetLineWidth(linewidth);
   Line(x1+cosa*linewidth, y1+sina*linewidth, x2-cosa*height, y2-sina*height);
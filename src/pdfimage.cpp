@@ -22,14 +22,21 @@
 
 #include <wx/uri.h>
 #include <wx/url.h>
+#include <wx/filename.h>
 #include <wx/gifdecod.h>
+#include <wx/hashmap.h>
+#include <wx/thread.h>
 #include <wx/wfstream.h>
 #include <wx/zstream.h>
 
+#include <math.h>
+
 #include "wx/pdfdocument.h"
 #include "wx/pdfimage.h"
 #include "wx/pdfutility.h"
 
+#include "crypto/sha256.h"
+
 wxFileSystem* wxPdfImage::ms_fileSystem = NULL;
 
 wxFileSystem*
@@ -43,6 +50,263 @@ wxPdfImage::GetFileSystem()
   return ms_fileSystem;
 }
 
+// ----------------------------------------------------------------------------
+// wxPdfImageCache: process-wide cache of parsed images
+// ----------------------------------------------------------------------------
+
+// Parsed image data shared between documents
+class wxPdfImageCacheEntry
+{
+public:
+  wxPdfImageCacheEntry()
+    : m_width(0), m_height(0), m_bpc('\0'),
+      m_palSize(0), m_pal(NULL), m_trnsSize(0), m_trns(NULL), m_dataSize(0), m_data(NULL),
+      m_smaskSize(0), m_smask(NULL), m_prev(NULL), m_next(NULL)
+  {
+  }
+
+  ~wxPdfImageCacheEntry()
+  {
+    if (m_pal  != NULL) delete [] m_pal;
+    if (m_trns != NULL) delete [] m_trns;
+    if (m_data != NULL) delete [] m_data;
+    if (m_smask != NULL) delete [] m_smask;
+  }
+
+  size_t GetSize() const
+  {
+    return sizeof(wxPdfImageCacheEntry) + m_palSize + m_trnsSize + m_dataSize + m_smaskSize;
+  }
+
+  wxString     m_key;
+  wxString     m_type;
+  int          m_width;
+  int          m_height;
+  wxString     m_cs;
+  char         m_bpc;
+  wxString     m_f;
+  wxString     m_parms;
+  unsigned int m_palSize;
+  char*        m_pal;
+  unsigned int m_trnsSize;
+  char*        m_trns;
+  unsigned int m_dataSize;
+  char*        m_data;
+  unsigned int m_smaskSize;
+  char*        m_smask;
+
+  wxPdfImageCacheEntry* m_prev;
+  wxPdfImageCacheEntry* m_next;
+};
+
+WX_DECLARE_STRING_HASH_MAP(wxPdfImageCacheEntry*, wxPdfImageCacheMap);
+
+#if wxUSE_THREADS
+static wxCriticalSection gs_csImageCache;
+#endif
+
+static wxPdfImageCacheMap     gs_imageCache;
+static wxPdfImageCacheEntry*  gs_imageCacheFirst = NULL;
+static wxPdfImageCacheEntry*  gs_imageCacheLast = NULL;
+static size_t                 gs_imageCacheSize = 0;
+static size_t                 gs_imageCacheMaxSize = 0;
+static size_t                 gs_imageCacheHits = 0;
+static size_t                 gs_imageCacheMisses = 0;
+
+// The following functions require the cache lock to be held
+
+static void
+ImageCacheUnlink(wxPdfImageCacheEntry* entry)
+{
+  if (entry->m_prev != NULL)
+  {
+    entry->m_prev->m_next = entry->m_next;
+  }
+  else
+  {
+    gs_imageCacheFirst = entry->m_next;
+  }
+  if (entry->m_next != NULL)
+  {
+    entry->m_next->m_prev = entry->m_prev;
+  }
+  else
+  {
+    gs_imageCacheLast = entry->m_prev;
+  }
+  entry->m_prev = NULL;
+  entry->m_next = NULL;
+}
+
+static void
+ImageCachePushFront(wxPdfImageCacheEntry* entry)
+{
+  entry->m_next = gs_imageCacheFirst;
+  if (gs_imageCacheFirst != NULL)
+  {
+    gs_imageCacheFirst->m_prev = entry;
+  }
+  else
+  {
+    gs_imageCacheLast = entry;
+  }
+  gs_imageCacheFirst = entry;
+}
+
+static void
+ImageCacheShrink(size_t maxSize)
+{
+  while (gs_imageCacheSize > maxSize && gs_imageCacheLast != NULL)
+  {
+    wxPdfImageCacheEntry* entry = gs_imageCacheLast;
+    ImageCacheUnlink(entry);
+    gs_imageCache.erase(entry->m_key);
+    gs_imageCacheSize -= entry->GetSize();
+    delete entry;
+  }
+}
+
+void
+wxPdfImageCache::SetMaxSize(size_t maxSize)
+{
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csImageCache);
+#endif
+  gs_imageCacheMaxSize = maxSize;
+  ImageCacheShrink(maxSize);
+}
+
+size_t
+wxPdfImageCache::GetMaxSize()
+{
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csImageCache);
+#endif
+  return gs_imageCacheMaxSize;
+}
+
+size_t
+wxPdfImageCache::GetSize()
+{
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csImageCache);
+#endif
+  return gs_imageCacheSize;
+}
+
+size_t
+wxPdfImageCache::GetHitCount()
+{
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csImageCache);
+#endif
+  return gs_imageCacheHits;
+}
+
+size_t
+wxPdfImageCache::GetMissCount()
+{
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csImageCache);
+#endif
+  return gs_imageCacheMisses;
+}
+
+void
+wxPdfImageCache::Clear()
+{
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csImageCache);
+#endif
+  ImageCacheShrink(0);
+  gs_imageCacheHits = 0;
+  gs_imageCacheMisses = 0;
+}
+
+// Copy a block of image data
+static char*
+ImageCacheCopy(const char* data, unsigned int size)
+{
+  char* copy = NULL;
+  if (data != NULL)
+  {
+    copy = new char[size];
+    memcpy(copy, data, size);
+  }
+  return copy;
+}
+
+bool
+wxPdfImage::LoadFromCache(const wxString& key)
+{
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csImageCache);
+#endif
+  wxPdfImageCacheMap::iterator entryIter = gs_imageCache.find(key);
+  if (entryIter == gs_imageCache.end())
+  {
+    ++gs_imageCacheMisses;
+    return false;
+  }
+  ++gs_imageCacheHits;
+  wxPdfImageCacheEntry* entry = entryIter->second;
+  ImageCacheUnlink(entry);
+  ImageCachePushFront(entry);
+
+  m_type     = entry->m_type;
+  m_width    = entry->m_width;
+  m_height   = entry->m_height;
+  m_cs       = entry->m_cs;
+  m_bpc      = entry->m_bpc;
+  m_f        = entry->m_f;
+  m_parms    = entry->m_parms;
+  m_palSize  = entry->m_palSize;
+  m_pal      = ImageCacheCopy(entry->m_pal, entry->m_palSize);
+  m_trnsSize = entry->m_trnsSize;
+  m_trns     = ImageCacheCopy(entry->m_trns, entry->m_trnsSize);
+  m_dataSize = entry->m_dataSize;
+  m_data     = ImageCacheCopy(entry->m_data, entry->m_dataSize);
+  m_smaskSize = entry->m_smaskSize;
+  m_smask     = ImageCacheCopy(entry->m_smask, entry->m_smaskSize);
+  return true;
+}
+
+void
+wxPdfImage::StoreInCache(const wxString& key)
+{
+  wxPdfImageCacheEntry* entry = new wxPdfImageCacheEntry();
+  entry->m_key      = key;
+  entry->m_type     = m_type;
+  entry->m_width    = m_width;
+  entry->m_height   = m_height;
+  entry->m_cs       = m_cs;
+  entry->m_bpc      = m_bpc;
+  entry->m_f        = m_f;
+  entry->m_parms    = m_parms;
+  entry->m_palSize  = m_palSize;
+  entry->m_pal      = ImageCacheCopy(m_pal, m_palSize);
+  entry->m_trnsSize = m_trnsSize;
+  entry->m_trns     = ImageCacheCopy(m_trns, m_trnsSize);
+  entry->m_dataSize = m_dataSize;
+  entry->m_data     = ImageCacheCopy(m_data, m_dataSize);
+  entry->m_smaskSize = m_smaskSize;
+  entry->m_smask     = ImageCacheCopy(m_smask, m_smaskSize);
+
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csImageCache);
+#endif
+  if (entry->GetSize() > gs_imageCacheMaxSize || gs_imageCache.find(key) != gs_imageCache.end())
+  {
+    // Image too large for the cache or already added by another thread
+    delete entry;
+    return;
+  }
+  gs_imageCache[key] = entry;
+  ImageCachePushFront(entry);
+  gs_imageCacheSize += entry->GetSize();
+  ImageCacheShrink(gs_imageCacheMaxSize);
+}
+
 // ----------------------------------------------------------------------------
 // wxPdfImage: class representing image objects
 // ----------------------------------------------------------------------------
@@ -70,6 +334,11 @@ wxPdfImage::wxPdfImage(wxPdfDocument* document, int index, const wxString& filen
   m_trns     = NULL;
   m_dataSize = 0;
   m_data     = NULL;
+  m_smaskSize = 0;
+  m_smask     = NULL;
+  m_deferredFileSize = 0;
+  m_placedWidth = 0;
+  m_placedHeight = 0;
 
   wxString fileURL = m_name;
   wxURI uri(m_name);
@@ -92,7 +361,7 @@ wxPdfImage::wxPdfImage(wxPdfDocument* document, int index, const wxString& filen
 }
 
 wxPdfImage::wxPdfImage(wxPdfDocument* document, int index, const wxString& name, const wxImage& image,
-                       bool jpegFormat)
+                       bool jpegFormat, bool alphaMask)
 {
   m_document = document;
   m_index    = index;
@@ -114,8 +383,46 @@ wxPdfImage::wxPdfImage(wxPdfDocument* document, int index, const wxString& name,
   m_trns     = NULL;
   m_dataSize = 0;
   m_data     = NULL;
+  m_smaskSize = 0;
+  m_smask     = NULL;
+  m_deferredFileSize = 0;
+  m_placedWidth = 0;
+  m_placedHeight = 0;
+
+  m_validWxImage = ConvertWxImage(image, jpegFormat, alphaMask);
+
+  m_imageFile = NULL;
+  m_imageStream = NULL;
+}
+
+wxPdfImage::wxPdfImage(wxPdfDocument* document, int index, const wxString& name)
+{
+  m_document = document;
+  m_index    = index;
+  m_name     = name;
+  m_maskImage = 0;
+  m_isFormObj = false;
+  m_fromWxImage = false;
+  m_validWxImage = false;
+
+  m_width    = 0;
+  m_height   = 0;
+  m_cs       = wxS("");
+  m_bpc      = '\0';
+  m_f        = wxS("");
+  m_parms    = wxS("");
 
-  m_validWxImage = ConvertWxImage(image, jpegFormat);
+  m_palSize  = 0;
+  m_pal      = NULL;
+  m_trnsSize = 0;
+  m_trns     = NULL;
+  m_dataSize = 0;
+  m_data     = NULL;
+  m_smaskSize = 0;
+  m_smask     = NULL;
+  m_deferredFileSize = 0;
+  m_placedWidth = 0;
+  m_placedHeight = 0;
 
   m_imageFile = NULL;
   m_imageStream = NULL;
@@ -144,6 +451,11 @@ wxPdfImage::wxPdfImage(wxPdfDocument* document, int index, const wxString& name,
   m_trns     = NULL;
   m_dataSize = 0;
   m_data     = NULL;
+  m_smaskSize = 0;
+  m_smask     = NULL;
+  m_deferredFileSize = 0;
+  m_placedWidth = 0;
+  m_placedHeight = 0;
 
   m_imageFile = NULL;
   m_type = mimeType;
@@ -155,10 +467,11 @@ wxPdfImage::~wxPdfImage()
   if (m_pal  != NULL) delete [] m_pal;
   if (m_trns != NULL) delete [] m_trns;
   if (m_data != NULL) delete [] m_data;
+  if (m_smask != NULL) delete [] m_smask;
 }
 
 bool
-wxPdfImage::ConvertWxImage(const wxImage& image, bool jpegFormat)
+wxPdfImage::ConvertWxImage(const wxImage& image, bool jpegFormat, bool alphaMask)
 {
 #if !wxUSE_LIBJPEG
   if (jpegFormat)
@@ -167,6 +480,32 @@ wxPdfImage::ConvertWxImage(const wxImage& image, bool jpegFormat)
   }
 #endif // wxUSE_LIBJPEG
 
+  if (wxPdfImageCache::GetMaxSize() > 0)
+  {
+    m_cacheKey = wxS("wximage:") + GetDigest(image, jpegFormat);
+    if (!jpegFormat)
+    {
+      // The encoded data depend on the compression settings of the document
+      int level = (m_document != NULL) ? m_document->GetImageDeflateLevel() : -1;
+      bool predictors = (m_document != NULL) ? m_document->GetImagePredictors() : true;
+      m_cacheKey += wxString::Format(wxS("|raw:%d:%d:%d"), (alphaMask) ? 1 : 0, level, (predictors) ? 1 : 0);
+    }
+    if (LoadFromCache(m_cacheKey))
+    {
+      return true;
+    }
+  }
+
+  if (!jpegFormat)
+  {
+    bool isValid = EncodeWxImage(image, alphaMask);
+    if (isValid && !m_cacheKey.IsEmpty())
+    {
+      StoreInCache(m_cacheKey);
+    }
+    return isValid;
+  }
+
   bool isValid = false;
   wxBitmapType bitmapType = (jpegFormat) ? wxBITMAP_TYPE_JPEG : wxBITMAP_TYPE_PNG;
   if (wxImage::FindHandler(bitmapType) == NULL)
@@ -200,9 +539,342 @@ wxPdfImage::ConvertWxImage(const wxImage& image, bool jpegFormat)
       isValid = ParsePNG(&is);
     }
   }
+  if (isValid && !m_cacheKey.IsEmpty())
+  {
+    StoreInCache(m_cacheKey);
+  }
   return isValid;
 }
 
+// Predict an image byte from its neighbours according to the PNG filter type
+static inline int
+PredictImageByte(int type, int a, int b, int c)
+{
+  int predicted;
+  switch (type)
+  {
+    case 1:
+      predicted = a;
+      break;
+    case 2:
+      predicted = b;
+      break;
+    case 3:
+      predicted = (a + b) / 2;
+      break;
+    case 4:
+      {
+        int p = a + b - c;
+        int pa = abs(p - a);
+        int pb = abs(p - b);
+        int pc = abs(p - c);
+        predicted = (pa <= pb && pa <= pc) ? a : ((pb <= pc) ? b : c);
+      }
+      break;
+    default:
+      predicted = 0;
+      break;
+  }
+  return predicted;
+}
+
+// Apply the PNG row filter of the given type
+static void
+FilterImageRow(int type, const unsigned char* row, const unsigned char* prev,
+               size_t length, size_t bpp, unsigned char* out)
+{
+  size_t j;
+  for (j = 0; j < length; ++j)
+  {
+    int a = (j >= bpp) ? row[j-bpp] : 0;
+    int b = (prev != NULL) ? prev[j] : 0;
+    int c = (j >= bpp && prev != NULL) ? prev[j-bpp] : 0;
+    out[j] = (unsigned char) (row[j] - PredictImageByte(type, a, b, c));
+  }
+}
+
+// Reverse the PNG row filter of the given type in place
+static bool
+UnfilterImageRow(int type, unsigned char* row, const unsigned char* prev,
+                 size_t length, size_t bpp)
+{
+  if (type < 0 || type > 4)
+  {
+    return false;
+  }
+  if (type != 0)
+  {
+    size_t j;
+    for (j = 0; j < length; ++j)
+    {
+      int a = (j >= bpp) ? row[j-bpp] : 0;
+      int b = (prev != NULL) ? prev[j] : 0;
+      int c = (j >= bpp && prev != NULL) ? prev[j-bpp] : 0;
+      row[j] = (unsigned char) (row[j] + PredictImageByte(type, a, b, c));
+    }
+  }
+  return true;
+}
+
+// Compresses image data row by row, optionally applying adaptive PNG row predictors
+class wxPdfImageRowEncoder
+{
+public:
+  wxPdfImageRowEncoder(wxOutputStream& os, int level, bool predictors, size_t rowLength, size_t bpp)
+    : m_zos(os, level), m_predictors(predictors), m_rowLength(rowLength), m_bpp(bpp), m_hasPrev(false)
+  {
+    m_prev = new unsigned char[rowLength];
+    m_filtered = new unsigned char[rowLength + 1];
+    m_candidate = new unsigned char[rowLength];
+  }
+
+  ~wxPdfImageRowEncoder()
+  {
+    delete [] m_prev;
+    delete [] m_filtered;
+    delete [] m_candidate;
+  }
+
+  void WriteRow(const unsigned char* row)
+  {
+    if (!m_predictors)
+    {
+      m_zos.Write(row, m_rowLength);
+      return;
+    }
+    // Choose the filter with the minimum sum of absolute differences
+    const unsigned char* above = (m_hasPrev) ? m_prev : NULL;
+    unsigned long bestSum = 0;
+    int type;
+    for (type = 0; type <= 4; ++type)
+    {
+      FilterImageRow(type, row, above, m_rowLength, m_bpp, m_candidate);
+      unsigned long sum = 0;
+      size_t j;
+      for (j = 0; j < m_rowLength; ++j)
+      {
+        sum += (m_candidate[j] < 128) ? m_candidate[j] : 256 - m_candidate[j];
+      }
+      if (type == 0 || sum < bestSum)
+      {
+        bestSum = sum;
+        m_filtered[0] = (unsigned char) type;
+        memcpy(m_filtered + 1, m_candidate, m_rowLength);
+      }
+    }
+    m_zos.Write(m_filtered, m_rowLength + 1);
+    memcpy(m_prev, row, m_rowLength);
+    m_hasPrev = true;
+  }
+
+  bool Close()
+  {
+    return m_zos.Close();
+  }
+
+private:
+  wxZlibOutputStream m_zos;
+  bool               m_predictors;
+  size_t             m_rowLength;
+  size_t             m_bpp;
+  bool               m_hasPrev;
+  unsigned char*     m_prev;
+  unsigned char*     m_filtered;
+  unsigned char*     m_candidate;
+};
+
+// Build the decode parameters for Flate compressed data with PNG predictors
+static wxString
+GetPredictorParms(int colors, int bpc, int columns)
+{
+  return wxString::Format(wxS("/DecodeParms <</Predictor 15 /Colors %d /BitsPerComponent %d /Columns %d>>"),
+                          colors, bpc, columns);
+}
+
+bool
+wxPdfImage::EncodeWxImage(const wxImage& image, bool alphaMask)
+{
+  if (!image.IsOk() || (alphaMask && !image.HasAlpha()))
+  {
+    return false;
+  }
+
+  m_type = wxS("png");
+  m_width  = image.GetWidth();
+  m_height = image.GetHeight();
+
+  // Select the colour space as the PNG handler would do
+  int greyMode = -1;
+  if (alphaMask)
+  {
+    greyMode = wxPNG_TYPE_GREY_RED;
+  }
+  else if (image.HasOption(wxIMAGE_OPTION_PNG_FORMAT))
+  {
+    int format = image.GetOptionInt(wxIMAGE_OPTION_PNG_FORMAT);
+    if (format == wxPNG_TYPE_GREY || format == wxPNG_TYPE_GREY_RED)
+    {
+      greyMode = format;
+    }
+  }
+  size_t channels = (greyMode >= 0) ? 1 : 3;
+  size_t width = (size_t) m_width;
+  size_t rowLength = channels * width;
+
+  int level = (m_document != NULL) ? m_document->GetImageDeflateLevel() : -1;
+  bool predictors = (m_document != NULL) ? m_document->GetImagePredictors() : true;
+
+  const unsigned char* rgb = image.GetData();
+  const unsigned char* alpha = image.GetAlpha();
+  unsigned char* row = new unsigned char[rowLength];
+
+  wxMemoryOutputStream os;
+  {
+    wxPdfImageRowEncoder encoder(os, level, predictors, rowLength, channels);
+    int y;
+    for (y = 0; y < m_height; ++y)
+    {
+      size_t offset = (size_t) y * width;
+      size_t x;
+      if (alphaMask)
+      {
+        memcpy(row, alpha + offset, width);
+      }
+      else if (greyMode == wxPNG_TYPE_GREY_RED)
+      {
+        const unsigned char* src = rgb + 3 * offset;
+        for (x = 0; x < width; ++x, src += 3)
+        {
+          row[x] = src[0];
+        }
+      }
+      else if (greyMode == wxPNG_TYPE_GREY)
+      {
+        const unsigned char* src = rgb + 3 * offset;
+        for (x = 0; x < width; ++x, src += 3)
+        {
+          row[x] = (unsigned char) ((299 * src[0] + 587 * src[1] + 114 * src[2] + 500) / 1000);
+        }
+      }
+      else
+      {
+        memcpy(row, rgb + 3 * offset, rowLength);
+      }
+      encoder.WriteRow(row);
+    }
+    encoder.Close();
+  }
+  delete [] row;
+
+  m_cs  = (channels == 1) ? wxS("DeviceGray") : wxS("DeviceRGB");
+  m_bpc = 8;
+  m_f   = wxS("FlateDecode");
+  m_parms = (predictors) ? GetPredictorParms((int) channels, 8, m_width) : wxString(wxEmptyString);
+
+  m_dataSize = (unsigned int) os.TellO();
+  m_data = new char[m_dataSize];
+  os.CopyTo(m_data, m_dataSize);
+  return true;
+}
+
+wxPdfImage*
+wxPdfImage::CreateSoftMask(int index, const wxString& name)
+{
+  wxPdfImage* softMask = NULL;
+  if (m_smask != NULL)
+  {
+    softMask = new wxPdfImage(m_document, index, name);
+    softMask->m_type   = m_type;
+    softMask->m_width  = m_width;
+    softMask->m_height = m_height;
+    softMask->m_cs     = wxS("DeviceGray");
+    softMask->m_bpc    = m_bpc;
+    softMask->m_f      = wxS("FlateDecode");
+    // The soft mask is compressed with predictors if and only if the colour data are
+    softMask->m_parms  = (!m_parms.IsEmpty()) ? GetPredictorParms(1, m_bpc, m_width) : wxString(wxEmptyString);
+    softMask->m_dataSize = m_smaskSize;
+    softMask->m_data     = m_smask;
+    m_smaskSize = 0;
+    m_smask     = NULL;
+  }
+  return softMask;
+}
+
+void
+wxPdfImage::DiscardSoftMask()
+{
+  if (m_smask != NULL)
+  {
+    delete [] m_smask;
+    m_smaskSize = 0;
+    m_smask     = NULL;
+  }
+}
+
+static void
+DigestAdd(wxpdfdoc::crypto::sha256_state& md, const void* data, size_t length)
+{
+  const unsigned char* p = (const unsigned char*) data;
+  while (length > 0)
+  {
+    std::uint32_t chunk = (length > 0x40000000) ? 0x40000000 : (std::uint32_t) length;
+    wxpdfdoc::crypto::sha_process(md, p, chunk);
+    p += chunk;
+    length -= chunk;
+  }
+}
+
+static void
+DigestAdd(wxpdfdoc::crypto::sha256_state& md, const wxString& value)
+{
+  wxCharBuffer buffer = value.utf8_str();
+  size_t length = strlen(buffer.data());
+  DigestAdd(md, &length, sizeof(length));
+  DigestAdd(md, buffer.data(), length);
+}
+
+wxString
+wxPdfImage::GetDigest(const wxImage& image, bool jpegFormat, int jpegQuality, int maskImage)
+{
+  wxpdfdoc::crypto::sha256_state md;
+  wxpdfdoc::crypto::sha_init(md);
+
+  int params[8];
+  params[0] = image.GetWidth();
+  params[1] = image.GetHeight();
+  params[2] = maskImage;
+  params[3] = jpegFormat ? 1 : 0;
+  params[4] = jpegFormat ? jpegQuality : 0;
+  params[5] = image.HasAlpha() ? 1 : 0;
+  params[6] = image.HasMask() ? 1 : 0;
+  params[7] = image.HasMask() ? ((image.GetMaskRed() << 16) | (image.GetMaskGreen() << 8) | image.GetMaskBlue()) : 0;
+  DigestAdd(md, params, sizeof(params));
+  DigestAdd(md, image.GetOption(wxIMAGE_OPTION_PNG_FORMAT));
+  DigestAdd(md, image.GetOption(wxIMAGE_OPTION_PNG_BITDEPTH));
+  DigestAdd(md, image.GetOption(wxIMAGE_OPTION_QUALITY));
+
+  size_t pixels = (size_t) image.GetWidth() * (size_t) image.GetHeight();
+  DigestAdd(md, image.GetData(), 3 * pixels);
+  if (image.HasAlpha())
+  {
+    DigestAdd(md, image.GetAlpha(), pixels);
+  }
+
+  unsigned char digest[32];
+  wxpdfdoc::crypto::sha_done(md, digest);
+
+  static const char hexDigits[] = "0123456789abcdef";
+  char hexDigest[65];
+  size_t j;
+  for (j = 0; j < 32; ++j)
+  {
+    hexDigest[2*j]   = hexDigits[digest[j] >> 4];
+    hexDigest[2*j+1] = hexDigits[digest[j] & 0x0f];
+  }
+  hexDigest[64] = 0;
+  return wxString::FromAscii(hexDigest);
+}
+
 bool
 wxPdfImage::Parse()
 {
@@ -213,15 +885,58 @@ wxPdfImage::Parse()
 
   if (m_imageStream)
   {
+    // Local image files are identified by path, modification time and size
+    bool isLocalFile = m_imageFile != NULL && wxFileName::FileExists(m_name);
+    bool deferData = isLocalFile && m_document != NULL && m_document->IsDeferredImageLoading() &&
+                     m_imageStream->IsSeekable();
+    if (deferData)
+    {
+      wxFileName fileName(m_name);
+      fileName.MakeAbsolute();
+      m_deferredFileSize = (wxFileOffset) fileName.GetSize().GetValue();
+      m_deferredModTime = fileName.GetModificationTime().GetValue();
+    }
+    else if (isLocalFile && wxPdfImageCache::GetMaxSize() > 0)
+    {
+      wxFileName fileName(m_name);
+      fileName.MakeAbsolute();
+      m_cacheKey = wxS("file:") + fileName.GetFullPath() + wxS("|") + m_type + wxS("|") +
+                   fileName.GetModificationTime().GetValue().ToString() + wxS("|") +
+                   fileName.GetSize().ToString();
+      if (m_document != NULL)
+      {
+        // PNG images with alpha channel are recompressed according to the document settings
+        m_cacheKey += wxString::Format(wxS("|%d:%d"), m_document->GetImageDeflateLevel(),
+                                       (m_document->GetImagePredictors()) ? 1 : 0);
+      }
+      if (LoadFromCache(m_cacheKey))
+      {
+        delete m_imageFile;
+        m_imageFile = NULL;
+        return true;
+      }
+    }
+
+    bool isCacheable = false;
     if ((m_type.StartsWith(wxS("image/")) && m_type.EndsWith(wxS("png"))) ||
         m_type == wxS("png"))
     {
+      if (deferData)
+      {
+        m_deferredFile = wxFileName(m_name).GetAbsolutePath();
+      }
       isValid = ParsePNG(m_imageStream);
+      isCacheable = true;
     }
     else if ((m_type.StartsWith(wxS("image/")) && m_type.EndsWith(wxS("jpeg"))) ||
              m_type == wxS("jpeg") || m_type == wxS("jpg"))
     {
+      if (deferData)
+      {
+        m_deferredFile = wxFileName(m_name).GetAbsolutePath();
+      }
       isValid = ParseJPG(m_imageStream);
+      isCacheable = true;
     }
 #if wxUSE_GIF
     else if ((m_type.StartsWith(wxS("image/")) && m_type.EndsWith(wxS("gif"))) ||
@@ -239,6 +954,16 @@ wxPdfImage::Parse()
         isValid = ParseWMF(m_imageStream);
       }
     }
+    if (!isValid)
+    {
+      m_deferredFile = wxEmptyString;
+      m_deferredBlocks.clear();
+    }
+    // GIF and WMF images depend on document settings and are not cached
+    if (isValid && isCacheable && !m_cacheKey.IsEmpty())
+    {
+      StoreInCache(m_cacheKey);
+    }
     if (m_imageFile != NULL)
     {
       delete m_imageFile;
@@ -248,6 +973,250 @@ wxPdfImage::Parse()
   return isValid;
 }
 
+bool
+wxPdfImage::WriteData(wxOutputStream& stream)
+{
+  if (m_deferredFile.IsEmpty())
+  {
+    if (m_data != NULL)
+    {
+      stream.Write(m_data, m_dataSize);
+    }
+    return true;
+  }
+
+  // The image file must not have been changed since it was parsed
+  wxFileName fileName(m_deferredFile);
+  wxPdfMappedFile mappedFile;
+  bool ok = fileName.FileExists() &&
+            fileName.GetModificationTime().GetValue() == m_deferredModTime &&
+            mappedFile.Open(m_deferredFile) &&
+            (wxFileOffset) mappedFile.GetLength() == m_deferredFileSize;
+  if (ok)
+  {
+    size_t j;
+    for (j = 0; ok && j < m_deferredBlocks.size(); ++j)
+    {
+      wxFileOffset offset = m_deferredBlocks[j].first;
+      unsigned int length = m_deferredBlocks[j].second;
+      ok = offset >= 0 && (size_t) offset + length <= mappedFile.GetLength();
+      if (ok)
+      {
+        stream.Write(mappedFile.GetData() + offset, length);
+      }
+    }
+  }
+  if (!ok)
+  {
+    wxLogError(wxString(wxS("wxPdfImage::WriteData: ")) +
+               wxString::Format(_("Image file '%s' changed or not accessible."), m_deferredFile.c_str()));
+  }
+  return ok;
+}
+
+void
+wxPdfImage::UpdatePlacedSize(double width, double height)
+{
+  if (width > m_placedWidth)
+  {
+    m_placedWidth = width;
+  }
+  if (height > m_placedHeight)
+  {
+    m_placedHeight = height;
+  }
+}
+
+bool
+wxPdfImage::DecodeImage(wxImage& image)
+{
+  wxMemoryOutputStream data;
+  if (!WriteData(data))
+  {
+    return false;
+  }
+
+  bool isValid = false;
+  if (m_f == wxS("DCTDecode"))
+  {
+#if wxUSE_LIBJPEG
+    if (wxImage::FindHandler(wxBITMAP_TYPE_JPEG) == NULL)
+    {
+      wxImage::AddHandler(new wxJPEGHandler());
+    }
+    wxMemoryInputStream is(data);
+    isValid = image.LoadFile(is, wxBITMAP_TYPE_JPEG) &&
+              image.GetWidth() == m_width && image.GetHeight() == m_height;
+#endif // wxUSE_LIBJPEG
+  }
+  else if (m_f == wxS("FlateDecode") && m_bpc == 8)
+  {
+    // Flate compressed samples, with PNG row predictors if decode parameters are given
+    size_t channels = (m_cs == wxS("DeviceRGB")) ? 3 : 1;
+    size_t width = (size_t) m_width;
+    size_t rowLength = channels * width;
+    bool predictors = !m_parms.IsEmpty();
+    size_t filterLength = (predictors) ? 1 : 0;
+
+    image.Create(m_width, m_height, false);
+    unsigned char* pixels = image.GetData();
+    unsigned char* row = new unsigned char[rowLength + 1];
+    unsigned char* prev = new unsigned char[rowLength + 1];
+
+    wxMemoryInputStream compressed(data);
+    wxZlibInputStream zis(compressed);
+    isValid = true;
+    int y;
+    for (y = 0; isValid && y < m_height; ++y)
+    {
+      zis.Read(row, rowLength + filterLength);
+      isValid = zis.LastRead() == rowLength + filterLength;
+      if (isValid && predictors)
+      {
+        isValid = UnfilterImageRow(row[0], row + 1, (y > 0) ? prev + 1 : NULL, rowLength, channels);
+      }
+      if (isValid)
+      {
+        const unsigned char* src = row + filterLength;
+        unsigned char* dst = pixels + 3 * (size_t) y * width;
+        if (channels == 3)
+        {
+          memcpy(dst, src, rowLength);
+        }
+        else
+        {
+          size_t x;
+          for (x = 0; x < width; ++x, dst += 3)
+          {
+            dst[0] = dst[1] = dst[2] = src[x];
+          }
+        }
+        unsigned char* swap = prev;
+        prev = row;
+        row = swap;
+      }
+    }
+    delete [] row;
+    delete [] prev;
+  }
+  return isValid;
+}
+
+// Check whether all pixels of an image are grey
+static bool
+IsGreyImage(const wxImage& image)
+{
+  const unsigned char* p = image.GetData();
+  size_t pixels = (size_t) image.GetWidth() * (size_t) image.GetHeight();
+  size_t j;
+  for (j = 0; j < pixels; ++j, p += 3)
+  {
+    if (p[0] != p[1] || p[0] != p[2])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+wxPdfImage*
+wxPdfImage::CreatePolicyImage(double targetDpi, int maxPixels, int jpegQuality, bool detectGreyscale)
+{
+  // Colour key masking and indexed or CMYK colour spaces are not supported
+  if (m_isFormObj || m_trnsSize > 0 || m_width <= 0 || m_height <= 0 ||
+      (m_cs != wxS("DeviceRGB") && m_cs != wxS("DeviceGray")))
+  {
+    return NULL;
+  }
+  bool isJpeg = (m_f == wxS("DCTDecode"));
+  bool isFlate = (m_f == wxS("FlateDecode") && m_bpc == 8);
+#if !wxUSE_LIBJPEG
+  isJpeg = false;
+#endif // wxUSE_LIBJPEG
+  if (!isJpeg && !isFlate)
+  {
+    return NULL;
+  }
+
+  // Determine the scale keeping the target resolution in both directions
+  double scale = 1;
+  if (targetDpi > 0 && m_placedWidth > 0 && m_placedHeight > 0)
+  {
+    double scaleX = targetDpi * m_placedWidth / 72.0 / m_width;
+    double scaleY = targetDpi * m_placedHeight / 72.0 / m_height;
+    scale = (scaleX > scaleY) ? scaleX : scaleY;
+  }
+  double pixelCount = (double) m_width * (double) m_height;
+  if (maxPixels > 0 && pixelCount * scale * scale > maxPixels)
+  {
+    scale = sqrt(maxPixels / pixelCount);
+  }
+  int newWidth = (int) ceil(m_width * scale);
+  int newHeight = (int) ceil(m_height * scale);
+  if (newWidth < 1) newWidth = 1;
+  if (newHeight < 1) newHeight = 1;
+  bool downsample = (newWidth < m_width && newHeight < m_height);
+  bool checkGrey = detectGreyscale && isFlate && m_cs == wxS("DeviceRGB");
+  if (!downsample && !checkGrey)
+  {
+    return NULL;
+  }
+
+  wxImage image;
+  if (!DecodeImage(image))
+  {
+    return NULL;
+  }
+  bool isGrey = checkGrey && IsGreyImage(image);
+  if (!downsample && !isGrey)
+  {
+    return NULL;
+  }
+  if (downsample)
+  {
+    image = image.Scale(newWidth, newHeight, wxIMAGE_QUALITY_BOX_AVERAGE);
+  }
+
+  wxPdfImage* policyImage = new wxPdfImage(m_document, m_index, m_name);
+  bool isValid = false;
+  if (isJpeg)
+  {
+#if wxUSE_LIBJPEG
+    wxMemoryOutputStream os;
+    image.SetOption(wxIMAGE_OPTION_QUALITY, jpegQuality);
+    if (image.SaveFile(os, wxBITMAP_TYPE_JPEG))
+    {
+      policyImage->m_type     = m_type;
+      policyImage->m_dataSize = (unsigned int) os.TellO();
+      policyImage->m_data     = new char[policyImage->m_dataSize];
+      os.CopyTo(policyImage->m_data, policyImage->m_dataSize);
+      policyImage->m_width  = image.GetWidth();
+      policyImage->m_height = image.GetHeight();
+      // The JPEG encoder always writes RGB data
+      policyImage->m_cs    = wxS("DeviceRGB");
+      policyImage->m_bpc   = m_bpc;
+      policyImage->m_f     = m_f;
+      policyImage->m_parms = m_parms;
+      isValid = true;
+    }
+#endif // wxUSE_LIBJPEG
+  }
+  else
+  {
+    if (m_cs == wxS("DeviceGray") || isGrey)
+    {
+      image.SetOption(wxIMAGE_OPTION_PNG_FORMAT, wxPNG_TYPE_GREY_RED);
+    }
+    isValid = policyImage->EncodeWxImage(image, false);
+  }
+  if (!isValid)
+  {
+    delete policyImage;
+    policyImage = NULL;
+  }
+  return policyImage;
+}
+
 // --- Parse PNG image file ---
 
 bool
@@ -282,26 +1251,28 @@ wxPdfImage::ParsePNG(wxInputStream* imageStream)
 
   imageStream->Read(buffer,1);
   char bpc = buffer[0];
-  if (bpc > 8)
+  if (bpc != 1 && bpc != 2 && bpc != 4 && bpc != 8 && bpc != 16)
   {
-    // 16-bit depth not supported
+    // Invalid bit depth
     wxLogDebug(wxString(wxS("wxPdfImage::ParsePNG: ")) +
-               wxString::Format(_("16-bit depth not supported: '%s'."), m_name.c_str()));
+               wxString::Format(_("Invalid bit depth: '%s'."), m_name.c_str()));
     return false;
   }
 
   wxString colspace = wxEmptyString;
   imageStream->Read(buffer,1);
   char ct = buffer[0];
-  if (ct == 0)
+  if (ct == 0 || ct == 4)
   {
+    // Grey scale, optionally with alpha channel
     colspace = wxS("DeviceGray");
   }
-  else if (ct == 2)
+  else if (ct == 2 || ct == 6)
   {
+    // RGB, optionally with alpha channel
     colspace = wxS("DeviceRGB");
   }
-  else if (ct == 3)
+  else if (ct == 3 && bpc <= 8)
   {
     colspace = wxS("Indexed");
   }
@@ -336,8 +1307,18 @@ wxPdfImage::ParsePNG(wxInputStream* imageStream)
     return false;
   }
 
+  bool hasAlpha = (ct == 4 || ct == 6);
+  if (hasAlpha && bpc < 8)
+  {
+    // Invalid bit depth for colour type with alpha channel
+    wxLogDebug(wxString(wxS("wxPdfImage::ParsePNG: ")) +
+               wxString::Format(_("Invalid bit depth: '%s'."), m_name.c_str()));
+    return false;
+  }
+  int colors = (ct == 2 || ct == 6) ? 3 : 1;
+
   imageStream->Read(buffer,4);
-  m_parms = wxString::Format(wxS("/DecodeParms <</Predictor 15 /Colors %d /BitsPerComponent %d /Columns %d>>"), (ct==2 ? 3 : 1), (int) bpc, w);
+  m_parms = GetPredictorParms(colors, (int) bpc, w);
 
   // Scan chunks looking for palette, transparency and image data
   m_palSize  = 0;
@@ -346,6 +1327,15 @@ wxPdfImage::ParsePNG(wxInputStream* imageStream)
   m_trns     = NULL;
   m_dataSize = 0;
   m_data     = NULL;
+  unsigned int dataCapacity = 0;
+
+  // The image data of images with alpha channel are always needed for splitting
+  if (hasAlpha || !imageStream->IsSeekable())
+  {
+    m_deferredFile = wxEmptyString;
+  }
+  m_deferredBlocks.clear();
+
   int n;
   do
   {
@@ -364,6 +1354,19 @@ wxPdfImage::ParsePNG(wxInputStream* imageStream)
       imageStream->Read(m_pal,n);
       imageStream->Read(buffer,4);
     }
+    else if (strncmp(buffer,"tRNS",4) == 0 && bpc == 16)
+    {
+      // 16-bit colour key masking not supported
+      if (m_pal  != NULL) delete [] m_pal;
+      if (m_trns != NULL) delete [] m_trns;
+      if (m_data != NULL) delete [] m_data;
+      m_pal  = NULL;
+      m_trns = NULL;
+      m_data = NULL;
+      wxLogDebug(wxString(wxS("wxPdfImage::ParsePNG: ")) +
+                 wxString::Format(_("16-bit transparency not supported: '%s'."), m_name.c_str()));
+      return false;
+    }
     else if (strncmp(buffer,"tRNS",4) == 0)
     {
       // Read transparency info
@@ -407,17 +1410,35 @@ wxPdfImage::ParsePNG(wxInputStream* imageStream)
     }
     else if (strncmp(buffer,"IDAT",4) == 0)
     {
-      // Read image data block
-      int prevSize = m_dataSize;
-      char* prevData = m_data;
-      m_dataSize += n;
-      m_data = new char[m_dataSize];
-      if (prevSize > 0)
+      if (!m_deferredFile.IsEmpty())
       {
-        memcpy(m_data, prevData, prevSize);
-        delete [] prevData;
+        // Remember the location of the image data block
+        m_deferredBlocks.push_back(std::make_pair(imageStream->TellI(), (unsigned int) n));
+        m_dataSize += n;
+        imageStream->SeekI(n, wxFromCurrent);
+      }
+      else
+      {
+        // Append the image data block, growing the buffer geometrically
+        if (m_dataSize + n > dataCapacity)
+        {
+          unsigned int newCapacity = (dataCapacity > 0) ? 2 * dataCapacity : 65536;
+          if (newCapacity < m_dataSize + n)
+          {
+            newCapacity = m_dataSize + n;
+          }
+          char* newData = new char[newCapacity];
+          if (m_dataSize > 0)
+          {
+            memcpy(newData, m_data, m_dataSize);
+          }
+          if (m_data != NULL) delete [] m_data;
+          m_data = newData;
+          dataCapacity = newCapacity;
+        }
+        imageStream->Read(m_data+m_dataSize,n);
+        m_dataSize += n;
       }
-      imageStream->Read(m_data+prevSize,n);
       imageStream->Read(buffer,4);
     }
     else if (strncmp(buffer,"IEND",4) == 0)
@@ -452,9 +1473,104 @@ wxPdfImage::ParsePNG(wxInputStream* imageStream)
   m_f      = wxS("FlateDecode");
 
   isValid = true;
+  if (hasAlpha)
+  {
+    // Colour and alpha samples are interleaved, the alpha channel becomes a soft mask
+    isValid = SplitAlphaPNG(colors, bpc / 8);
+  }
   return isValid;
 }
 
+bool
+wxPdfImage::SplitAlphaPNG(int colors, int bytesPerSample)
+{
+  if (m_data == NULL || m_width <= 0 || m_height <= 0)
+  {
+    wxLogDebug(wxString(wxS("wxPdfImage::SplitAlphaPNG: ")) +
+               wxString::Format(_("Missing image data: '%s'."), m_name.c_str()));
+    return false;
+  }
+
+  size_t width = (size_t) m_width;
+  size_t pixelLength = (size_t) (colors + 1) * bytesPerSample;
+  size_t colourLength = (size_t) colors * bytesPerSample;
+  size_t rowLength = width * pixelLength;
+
+  int level = (m_document != NULL) ? m_document->GetImageDeflateLevel() : -1;
+  bool predictors = (m_document != NULL) ? m_document->GetImagePredictors() : true;
+
+  unsigned char* row = new unsigned char[rowLength + 1];
+  unsigned char* prev = new unsigned char[rowLength + 1];
+  unsigned char* colourRow = new unsigned char[width * colourLength];
+  unsigned char* alphaRow = new unsigned char[width * bytesPerSample];
+
+  bool isValid = true;
+  wxMemoryOutputStream colourStream;
+  wxMemoryOutputStream alphaStream;
+  {
+    wxMemoryInputStream compressed(m_data, m_dataSize);
+    wxZlibInputStream zis(compressed);
+    wxPdfImageRowEncoder colourEncoder(colourStream, level, predictors, width * colourLength, colourLength);
+    wxPdfImageRowEncoder alphaEncoder(alphaStream, level, predictors, width * bytesPerSample, bytesPerSample);
+    int y;
+    for (y = 0; isValid && y < m_height; ++y)
+    {
+      // Each row starts with the filter type
+      zis.Read(row, rowLength + 1);
+      if (zis.LastRead() != rowLength + 1)
+      {
+        isValid = false;
+        break;
+      }
+      isValid = UnfilterImageRow(row[0], row + 1, (y > 0) ? prev + 1 : NULL, rowLength, pixelLength);
+      if (isValid)
+      {
+        const unsigned char* src = row + 1;
+        unsigned char* colourDst = colourRow;
+        unsigned char* alphaDst = alphaRow;
+        size_t x;
+        for (x = 0; x < width; ++x)
+        {
+          memcpy(colourDst, src, colourLength);
+          memcpy(alphaDst, src + colourLength, bytesPerSample);
+          colourDst += colourLength;
+          alphaDst += bytesPerSample;
+          src += pixelLength;
+        }
+        colourEncoder.WriteRow(colourRow);
+        alphaEncoder.WriteRow(alphaRow);
+        unsigned char* swap = prev;
+        prev = row;
+        row = swap;
+      }
+    }
+    colourEncoder.Close();
+    alphaEncoder.Close();
+  }
+
+  delete [] row;
+  delete [] prev;
+  delete [] colourRow;
+  delete [] alphaRow;
+
+  if (!isValid)
+  {
+    wxLogDebug(wxString(wxS("wxPdfImage::SplitAlphaPNG: ")) +
+               wxString::Format(_("Corrupt image data: '%s'."), m_name.c_str()));
+    return false;
+  }
+
+  delete [] m_data;
+  m_dataSize = (unsigned int) colourStream.TellO();
+  m_data = new char[m_dataSize];
+  colourStream.CopyTo(m_data, m_dataSize);
+  m_smaskSize = (unsigned int) alphaStream.TellO();
+  m_smask = new char[m_smaskSize];
+  alphaStream.CopyTo(m_smask, m_smaskSize);
+  m_parms = (predictors) ? GetPredictorParms(colors, m_bpc, m_width) : wxString(wxEmptyString);
+  return true;
+}
+
 //--- Parse JPEG image file
 
 // some defines for the different JPEG block types
@@ -641,10 +1757,18 @@ wxPdfImage::ParseJPG(wxInputStream* imageStream)
     m_bpc = bits;
 
     //Read whole file
-    imageStream->SeekI(0);
     m_dataSize = imageStream->GetLength();
-    m_data = new char[m_dataSize];
-    imageStream->Read(m_data,m_dataSize);
+    m_deferredBlocks.clear();
+    if (!m_deferredFile.IsEmpty())
+    {
+      m_deferredBlocks.push_back(std::make_pair((wxFileOffset) 0, m_dataSize));
+    }
+    else
+    {
+      imageStream->SeekI(0);
+      m_data = new char[m_dataSize];
+      imageStream->Read(m_data,m_dataSize);
+    }
 
     m_width  = width;
     m_height = height;
@@ -21,10 +21,15 @@
 #include <wx/wx.h>
 #endif
 
+#include <wx/stopwatch.h>
+#include <wx/thread.h>
 #include <wx/tokenzr.h>
 #include <wx/wfstream.h>
 #include <wx/zstream.h>
 
+#include <map>
+#include <vector>
+
 #include "wx/pdfannotation.h"
 #include "wx/pdfbookmark.h"
 #include "wx/pdfdocument.h"
@@ -43,6 +48,24 @@
 
 #include "pdfcorefontdata.inc"
 
+/// Compress a memory buffer
+static void
+CompressBuffer(const void* data, size_t len, wxMemoryOutputStream& out)
+{
+  wxZlibOutputStream q(out);
+  if (len > 0)
+  {
+    q.Write(data, len);
+  }
+}
+
+/// Compress the content of a memory stream
+static void
+CompressStream(wxMemoryOutputStream& in, wxMemoryOutputStream& out)
+{
+  CompressBuffer(in.GetOutputStreamBuffer()->GetBufferStart(), (size_t) in.GetLength(), out);
+}
+
 class wxPdfGraphicState
 {
 public:
@@ -356,12 +379,19 @@ wxPdfDocument::EndDoc()
   {
     m_PDFVersion = wxS("1.5");
   }
+  if (m_compactOutput && m_PDFVersion < wxS("1.5"))
+  {
+    m_PDFVersion = wxS("1.5");
+  }
   if (m_importVersion > m_PDFVersion)
   {
     m_PDFVersion = m_importVersion;
   }
 
-  PutHeader();
+  if (!m_streaming)
+  {
+    PutHeader();
+  }
   PutPages();
 
   PutResources();
@@ -383,6 +413,13 @@ wxPdfDocument::EndDoc()
   Out(">>");
   Out("endobj");
 
+  if (m_compactOutput)
+  {
+    PutXRefStream();
+    m_state = 3;
+    return;
+  }
+
   // Cross-Reference
   int o = m_buffer->TellO();
   Out("xref");
@@ -405,6 +442,115 @@ wxPdfDocument::EndDoc()
   m_state = 3;
 }
 
+/// Maximal number of objects in an object stream
+static const size_t gs_objStmMaxObjects = 100;
+
+/// Add an entry to a cross-reference stream with field widths [1 4 2]
+static void
+PutXRefEntry(wxMemoryOutputStream& xref, int type, int field2, int field3)
+{
+  unsigned char entry[7];
+  entry[0] = (unsigned char) type;
+  entry[1] = (unsigned char) ((field2 >> 24) & 0xff);
+  entry[2] = (unsigned char) ((field2 >> 16) & 0xff);
+  entry[3] = (unsigned char) ((field2 >>  8) & 0xff);
+  entry[4] = (unsigned char) ( field2        & 0xff);
+  entry[5] = (unsigned char) ((field3 >>  8) & 0xff);
+  entry[6] = (unsigned char) ( field3        & 0xff);
+  xref.Write(entry, 7);
+}
+
+void
+wxPdfDocument::PutXRefStream()
+{
+  // The catalog is the last object, the info dictionary precedes it
+  int rootId = m_n;
+  int infoId = m_n - 1;
+  FlushObject();
+  wxString filter = (m_compress) ? wxS("/Filter /FlateDecode ") : wxS("");
+
+  // Object streams
+  int firstObjStmId = m_n + 1;
+  size_t count = m_objStmIds.GetCount();
+  size_t k;
+  for (k = 0; k < m_objStreams.GetCount(); k++)
+  {
+    size_t first = k * gs_objStmMaxObjects;
+    size_t last = wxMin(first + gs_objStmMaxObjects, count);
+    wxString header;
+    size_t j;
+    for (j = first; j < last; j++)
+    {
+      header += wxString::Format(wxS("%d %d "), m_objStmIds[j], m_objStmOffsets[j]);
+    }
+    wxMemoryOutputStream data;
+    wxCharBuffer headerBuffer = header.ToAscii();
+    data.Write(headerBuffer.data(), header.Length());
+    wxMemoryInputStream objects(*((wxMemoryOutputStream*) m_objStreams[k]));
+    data.Write(objects);
+
+    wxMemoryOutputStream mos;
+    wxMemoryOutputStream* p = &data;
+    if (m_compress)
+    {
+      CompressStream(data, mos);
+      p = &mos;
+    }
+
+    int objStmId = GetNewObjId();
+    (*m_offsets)[objStmId-1] = m_buffer->TellO();
+    OutAscii(wxString::Format(wxS("%d 0 obj"), objStmId));
+    OutAscii(wxString::Format(wxS("<</Type /ObjStm /N %d /First %d "), (int) (last - first), (int) header.Length()) +
+             filter + wxString::Format(wxS("/Length %lu>>"), (unsigned long) CalculateStreamLength(p->TellO())));
+    PutStream(*p);
+    Out("endobj");
+  }
+
+  // Cross-reference stream
+  int xrefId = GetNewObjId();
+  int o = m_buffer->TellO();
+  (*m_offsets)[xrefId-1] = o;
+
+  wxMemoryOutputStream xref;
+  PutXRefEntry(xref, 0, 0, 65535);
+  int id;
+  for (id = 1; id <= xrefId; id++)
+  {
+    wxPdfObjIdHashMap::iterator objStmEntry = m_objStmIndex->find(id);
+    if (objStmEntry != m_objStmIndex->end())
+    {
+      int index = objStmEntry->second;
+      PutXRefEntry(xref, 2, firstObjStmId + index / (int) gs_objStmMaxObjects, index % (int) gs_objStmMaxObjects);
+    }
+    else
+    {
+      PutXRefEntry(xref, 1, (*m_offsets)[id-1], 0);
+    }
+  }
+  wxMemoryOutputStream mos;
+  wxMemoryOutputStream* p = &xref;
+  if (m_compress)
+  {
+    CompressStream(xref, mos);
+    p = &mos;
+  }
+
+  OutAscii(wxString::Format(wxS("%d 0 obj"), xrefId));
+  Out("<</Type /XRef");
+  PutTrailerEntries(xrefId+1, rootId, infoId);
+  OutAscii(wxString(wxS("/W [1 4 2] ")) + filter +
+           wxString::Format(wxS("/Length %lu>>"), (unsigned long) p->TellO()));
+  // The cross-reference stream is never encrypted
+  bool encrypted = m_encrypted;
+  m_encrypted = false;
+  PutStream(*p);
+  m_encrypted = encrypted;
+  Out("endobj");
+  Out("startxref");
+  OutAscii(wxString::Format(wxS("%d"),o));
+  Out("%%EOF");
+}
+
 void
 wxPdfDocument::BeginPage(int orientation, wxSize pageSize)
 {
@@ -474,6 +620,12 @@ wxPdfDocument::EndPage()
   }
   m_state = 1;
   ClearGraphicState();
+
+  if (m_streaming)
+  {
+    // Write the finished page to the output stream
+    PutPage(m_page);
+  }
 }
 
 void
@@ -486,9 +638,15 @@ wxPdfDocument::PutHeader()
 void
 wxPdfDocument::PutTrailer()
 {
-  OutAscii(wxString(wxS("/Size ")) + wxString::Format(wxS("%d"),(m_n+1)));
-  OutAscii(wxString(wxS("/Root ")) + wxString::Format(wxS("%d"),m_n) + wxString(wxS(" 0 R")));
-  OutAscii(wxString(wxS("/Info ")) + wxString::Format(wxS("%d"),(m_n-1)) + wxString(wxS(" 0 R")));
+  PutTrailerEntries(m_n+1, m_n, m_n-1);
+}
+
+void
+wxPdfDocument::PutTrailerEntries(int size, int rootId, int infoId)
+{
+  OutAscii(wxString(wxS("/Size ")) + wxString::Format(wxS("%d"),size));
+  OutAscii(wxString(wxS("/Root ")) + wxString::Format(wxS("%d"),rootId) + wxString(wxS(" 0 R")));
+  OutAscii(wxString(wxS("/Info ")) + wxString::Format(wxS("%d"),infoId) + wxString(wxS(" 0 R")));
 
   if (m_encrypted)
   {
@@ -522,10 +680,61 @@ wxPdfDocument::NewObj(int objId)
 {
   // Begin a new object
   int id = (objId > 0) ? objId : GetNewObjId();
+  if (m_compactOutput)
+  {
+    // Capture the object, on completion it is either packed into
+    // an object stream or written as a regular object
+    FlushObject();
+    m_objId = id;
+    m_objHasStream = false;
+    m_objBuffer = new wxMemoryOutputStream();
+    m_objOutput = m_buffer;
+    m_buffer = m_objBuffer;
+    return;
+  }
   (*m_offsets)[id-1] = m_buffer->TellO();
   OutAscii(wxString::Format(wxS("%d"),id) + wxString(wxS(" 0 obj")));
 }
 
+void
+wxPdfDocument::FlushObject()
+{
+  if (m_objBuffer == NULL)
+  {
+    return;
+  }
+  m_buffer = m_objOutput;
+  m_objOutput = NULL;
+
+  static const char endobj[] = "endobj\n";
+  static const size_t endobjLen = sizeof(endobj) - 1;
+  const char* data = (const char*) m_objBuffer->GetOutputStreamBuffer()->GetBufferStart();
+  size_t len = (size_t) m_objBuffer->GetLength();
+  if (!m_objHasStream && !m_encrypted &&
+      len >= endobjLen && memcmp(data + len - endobjLen, endobj, endobjLen) == 0)
+  {
+    // Pack the object into the current object stream
+    size_t count = m_objStmIds.GetCount();
+    if (count % gs_objStmMaxObjects == 0)
+    {
+      m_objStreams.Add(new wxMemoryOutputStream());
+    }
+    wxMemoryOutputStream* objStm = (wxMemoryOutputStream*) m_objStreams.Last();
+    (*m_objStmIndex)[m_objId] = (int) count;
+    m_objStmIds.Add(m_objId);
+    m_objStmOffsets.Add((int) objStm->TellO());
+    objStm->Write(data, len - endobjLen);
+  }
+  else
+  {
+    (*m_offsets)[m_objId-1] = m_buffer->TellO();
+    OutAscii(wxString::Format(wxS("%d"),m_objId) + wxString(wxS(" 0 obj")));
+    m_buffer->Write(data, len);
+  }
+  delete m_objBuffer;
+  m_objBuffer = NULL;
+}
+
 void
 wxPdfDocument::PutFormFields()
 {
@@ -584,6 +793,12 @@ wxPdfDocument::PutCatalog()
   Out("/Type /Catalog");
   Out("/Pages 1 0 R");
 
+  if (m_streaming && m_PDFVersion > m_streamVersion)
+  {
+    // The header was written before the final PDF version was known
+    OutAscii(wxString(wxS("/Version /")) + m_PDFVersion);
+  }
+
   if (!m_attachments->empty())
   {
     OutAscii(wxString::Format(wxS("/Names <</EmbeddedFiles %d 0 R>>"), m_nAttachments));
@@ -591,19 +806,19 @@ wxPdfDocument::PutCatalog()
 
   if (m_zoomMode == wxPDF_ZOOM_FULLPAGE)
   {
-    OutAscii(wxString::Format(wxS("/OpenAction [%d 0 R /Fit]"), m_firstPageId));
+    OutAscii(wxString::Format(wxS("/OpenAction [%d 0 R /Fit]"), GetPageObjId(1)));
   }
   else if (m_zoomMode == wxPDF_ZOOM_FULLWIDTH)
   {
-    OutAscii(wxString::Format(wxS("/OpenAction [%d 0 R /FitH null]"), m_firstPageId));
+    OutAscii(wxString::Format(wxS("/OpenAction [%d 0 R /FitH null]"), GetPageObjId(1)));
   }
   else if (m_zoomMode == wxPDF_ZOOM_REAL)
   {
-    OutAscii(wxString::Format(wxS("/OpenAction [%d 0 R /XYZ null null 1]"), m_firstPageId));
+    OutAscii(wxString::Format(wxS("/OpenAction [%d 0 R /XYZ null null 1]"), GetPageObjId(1)));
   }
   else if (m_zoomMode == wxPDF_ZOOM_FACTOR)
   {
-    OutAscii(wxString::Format(wxS("/OpenAction [%d 0 R /XYZ null null "), m_firstPageId) +
+    OutAscii(wxString::Format(wxS("/OpenAction [%d 0 R /XYZ null null "), GetPageObjId(1)) +
              wxPdfUtility::Double2String(m_zoomFactor/100.,3) + wxString(wxS("]")));
   }
 
@@ -726,6 +941,387 @@ wxPdfDocument::PutCatalog()
   }
 }
 
+// --- Worker pool for compressing streams and creating font streams in parallel
+
+/// Job to be executed by a worker pool (For internal use only)
+class wxPdfWorkerJob
+{
+public:
+  /// Constructor
+  wxPdfWorkerJob() : m_duration(0)
+  {
+  }
+
+  /// Destructor
+  virtual ~wxPdfWorkerJob()
+  {
+  }
+
+  /// Execute the job, measuring the time it takes
+  void Execute()
+  {
+    wxStopWatch sw;
+    Run();
+    m_duration = sw.TimeInMicro();
+  }
+
+  /// Get the time in microseconds it took to execute the job
+  wxLongLong GetDuration() const { return m_duration; }
+
+protected:
+  /// Do the actual work
+  virtual void Run() = 0;
+
+private:
+  wxLongLong m_duration; ///< execution time in microseconds
+};
+
+/// Pool of worker threads executing a list of jobs (For internal use only)
+class wxPdfWorkerPool
+{
+public:
+  /// Constructor
+  wxPdfWorkerPool(int numThreads)
+    : m_numThreads(numThreads), m_next(0), m_timeSaved(0)
+  {
+  }
+
+  /// Destructor
+  virtual ~wxPdfWorkerPool()
+  {
+    size_t j;
+    for (j = 0; j < m_jobs.size(); ++j)
+    {
+      delete m_jobs[j];
+    }
+  }
+
+  /// Add a job to the pool
+  size_t AddJob(wxPdfWorkerJob* job)
+  {
+    m_jobs.push_back(job);
+    return m_jobs.size() - 1;
+  }
+
+  /// Get the number of jobs
+  size_t GetJobCount() const { return m_jobs.size(); }
+
+  /// Get a job
+  wxPdfWorkerJob* GetJob(size_t index) const { return m_jobs[index]; }
+
+  /// Execute all jobs and wait until all of them are finished
+  void Execute();
+
+  /// Get the next job to be executed (thread safe)
+  wxPdfWorkerJob* GetNextJob();
+
+  /// Get the wall-clock time in microseconds saved compared to sequential execution
+  wxLongLong GetTimeSaved() const { return m_timeSaved; }
+
+private:
+  int                          m_numThreads; ///< number of threads
+  std::vector<wxPdfWorkerJob*> m_jobs;       ///< list of jobs
+  size_t                       m_next;       ///< index of next job to be executed
+  wxLongLong                   m_timeSaved;  ///< time saved compared to sequential execution
+#if wxUSE_THREADS
+  wxCriticalSection            m_cs;         ///< critical section for job distribution
+#endif
+};
+
+#if wxUSE_THREADS
+/// Worker thread executing jobs of a worker pool (For internal use only)
+class wxPdfWorkerThread : public wxThread
+{
+public:
+  /// Constructor
+  wxPdfWorkerThread(wxPdfWorkerPool* pool)
+    : wxThread(wxTHREAD_JOINABLE), m_pool(pool)
+  {
+  }
+
+protected:
+  /// Execute jobs until none is left
+  virtual ExitCode Entry() wxOVERRIDE
+  {
+    wxPdfWorkerJob* job;
+    while ((job = m_pool->GetNextJob()) != NULL)
+    {
+      job->Execute();
+    }
+    return 0;
+  }
+
+private:
+  wxPdfWorkerPool* m_pool; ///< pool the thread belongs to
+};
+#endif
+
+wxPdfWorkerJob*
+wxPdfWorkerPool::GetNextJob()
+{
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(m_cs);
+#endif
+  return (m_next < m_jobs.size()) ? m_jobs[m_next++] : NULL;
+}
+
+void
+wxPdfWorkerPool::Execute()
+{
+  wxStopWatch sw;
+  std::vector<wxThread*> threads;
+#if wxUSE_THREADS
+  // The calling thread takes part in executing the jobs
+  int numThreads = wxMin(m_numThreads, (int) m_jobs.size()) - 1;
+  int j;
+  for (j = 0; j < numThreads; ++j)
+  {
+    wxPdfWorkerThread* thread = new wxPdfWorkerThread(this);
+    if (thread->Run() == wxTHREAD_NO_ERROR)
+    {
+      threads.push_back(thread);
+    }
+    else
+    {
+      delete thread;
+      break;
+    }
+  }
+#endif
+
+  wxPdfWorkerJob* job;
+  while ((job = GetNextJob()) != NULL)
+  {
+    job->Execute();
+  }
+
+#if wxUSE_THREADS
+  size_t k;
+  for (k = 0; k < threads.size(); ++k)
+  {
+    threads[k]->Wait();
+    delete threads[k];
+  }
+#endif
+
+  wxLongLong sequentialTime = 0;
+  size_t n;
+  for (n = 0; n < m_jobs.size(); ++n)
+  {
+    sequentialTime += m_jobs[n]->GetDuration();
+  }
+  m_timeSaved = sequentialTime - sw.TimeInMicro();
+  if (m_timeSaved < 0)
+  {
+    m_timeSaved = 0;
+  }
+}
+
+/// Job compressing a memory buffer (For internal use only)
+class wxPdfCompressionJob : public wxPdfWorkerJob
+{
+public:
+  /// Constructor
+  wxPdfCompressionJob(const void* data, size_t len)
+    : m_data(data), m_len(len)
+  {
+  }
+
+  /// Get the compressed data
+  wxMemoryOutputStream& GetResult() { return m_result; }
+
+protected:
+  /// Compress the buffer
+  virtual void Run() wxOVERRIDE
+  {
+    CompressBuffer(m_data, m_len, m_result);
+  }
+
+private:
+  const void*          m_data;   ///< data to be compressed
+  size_t               m_len;    ///< length of the data
+  wxMemoryOutputStream m_result; ///< compressed data
+};
+
+/// Pool of worker threads compressing memory buffers (For internal use only)
+class wxPdfCompressionPool : public wxPdfWorkerPool
+{
+public:
+  /// Constructor
+  wxPdfCompressionPool(int numThreads)
+    : wxPdfWorkerPool(numThreads)
+  {
+  }
+
+  /// Add a memory buffer to be compressed
+  size_t Add(const void* data, size_t len)
+  {
+    return AddJob(new wxPdfCompressionJob(data, len));
+  }
+
+  /// Add the content of a memory stream to be compressed
+  size_t Add(wxMemoryOutputStream& in)
+  {
+    return Add(in.GetOutputStreamBuffer()->GetBufferStart(), (size_t) in.GetLength());
+  }
+
+  /// Get compressed data
+  wxMemoryOutputStream& GetResult(size_t index)
+  {
+    return static_cast<wxPdfCompressionJob*>(GetJob(index))->GetResult();
+  }
+};
+
+/// Font streams prepared in advance for embedding (For internal use only)
+class wxPdfFontStreams
+{
+public:
+  /// Constructor
+  wxPdfFontStreams(wxPdfFontDetails* font)
+    : m_font(font), m_fontSize1(0)
+  {
+    wxPdfFontExtended extFont = font->GetFont();
+    wxString type = font->GetType();
+    m_embed = extFont.IsEmbedded();
+    m_unicodeMap = (type == wxS("Type1") && extFont.HasEncodingMap()) ||
+                   type == wxS("TrueTypeUnicode") || type == wxS("OpenTypeUnicode");
+    m_cidToGidMap = (type == wxS("TrueTypeUnicode"));
+    m_cidSet = (type == wxS("TrueTypeUnicode") || type == wxS("OpenTypeUnicode")) &&
+               extFont.IsEmbedded() && extFont.SubsetRequested();
+  }
+
+  /// Check whether any stream has to be created for the font
+  bool HasWork() const { return m_embed || m_unicodeMap || m_cidToGidMap || m_cidSet; }
+
+  /// Create the font program stream
+  void WriteFontData()
+  {
+    if (m_embed)
+    {
+      m_fontSize1 = m_font->WriteFontData(&m_fontData);
+    }
+  }
+
+  /// Create the map and set streams
+  void WriteMaps()
+  {
+    if (m_unicodeMap)
+    {
+      m_font->WriteUnicodeMap(&m_unicodeMapData);
+    }
+    if (m_cidToGidMap)
+    {
+      m_font->WriteCIDToGIDMap(&m_cidToGidMapData);
+    }
+    if (m_cidSet)
+    {
+      m_font->WriteCIDSet(&m_cidSetData);
+    }
+  }
+
+  bool                 m_embed;           ///< Flag whether the font program is embedded
+  bool                 m_unicodeMap;      ///< Flag whether a ToUnicode map is needed
+  bool                 m_cidToGidMap;     ///< Flag whether a CIDToGIDMap is needed
+  bool                 m_cidSet;          ///< Flag whether a CIDSet is needed
+  wxPdfFontDetails*    m_font;            ///< font
+  size_t               m_fontSize1;       ///< uncompressed size of the font program
+  wxMemoryOutputStream m_fontData;        ///< font program
+  wxMemoryOutputStream m_unicodeMapData;  ///< ToUnicode map
+  wxMemoryOutputStream m_cidToGidMapData; ///< CIDToGIDMap
+  wxMemoryOutputStream m_cidSetData;      ///< CIDSet
+};
+
+/// Job creating the streams of all fonts sharing the same font data (For internal use only)
+class wxPdfFontJob : public wxPdfWorkerJob
+{
+public:
+  /// Constructor
+  wxPdfFontJob()
+  {
+  }
+
+  /// Destructor
+  virtual ~wxPdfFontJob()
+  {
+    size_t j;
+    for (j = 0; j < m_fonts.size(); ++j)
+    {
+      delete m_fonts[j];
+    }
+  }
+
+  /// Add a font
+  wxPdfFontStreams* Add(wxPdfFontDetails* font)
+  {
+    wxPdfFontStreams* streams = new wxPdfFontStreams(font);
+    m_fonts.push_back(streams);
+    return streams;
+  }
+
+protected:
+  /// Create the streams in the same order as sequential output does
+  virtual void Run() wxOVERRIDE
+  {
+    size_t j;
+    for (j = 0; j < m_fonts.size(); ++j)
+    {
+      m_fonts[j]->WriteFontData();
+    }
+    for (j = 0; j < m_fonts.size(); ++j)
+    {
+      m_fonts[j]->WriteMaps();
+    }
+  }
+
+private:
+  std::vector<wxPdfFontStreams*> m_fonts; ///< fonts sharing the same font data
+};
+
+/// Pool of worker threads creating font streams (For internal use only)
+class wxPdfFontPool : public wxPdfWorkerPool
+{
+public:
+  /// Constructor
+  wxPdfFontPool(int numThreads)
+    : wxPdfWorkerPool(numThreads)
+  {
+  }
+
+  /// Add a font; fonts sharing the same font data are handled by the same job
+  void Add(wxPdfFontDetails* font)
+  {
+    wxPdfFontExtended extFont = font->GetFont();
+    const wxPdfFontData* fontData = extFont.GetFontData();
+    wxPdfFontJob* job;
+    std::map<const wxPdfFontData*, wxPdfFontJob*>::iterator jobIter = m_jobMap.find(fontData);
+    if (jobIter != m_jobMap.end())
+    {
+      job = jobIter->second;
+    }
+    else
+    {
+      job = new wxPdfFontJob();
+      AddJob(job);
+      m_jobMap[fontData] = job;
+    }
+    m_fontMap[font] = job->Add(font);
+  }
+
+  /// Get the prepared streams of a font
+  /**
+  * \return the prepared streams or NULL if the font was not added to the pool
+  */
+  wxPdfFontStreams* Find(wxPdfFontDetails* font) const
+  {
+    std::map<wxPdfFontDetails*, wxPdfFontStreams*>::const_iterator fontIter = m_fontMap.find(font);
+    return (fontIter != m_fontMap.end()) ? fontIter->second : NULL;
+  }
+
+private:
+  std::map<const wxPdfFontData*, wxPdfFontJob*>  m_jobMap;  ///< job per font data
+  std::map<wxPdfFontDetails*, wxPdfFontStreams*> m_fontMap; ///< prepared streams per font
+};
+
 // --- Fast string search (KMP method) for page number alias replacement
 
 static size_t*
@@ -808,8 +1404,71 @@ wxPdfDocument::ReplaceNbPagesAlias()
   int n;
   for (n = 1; n <= m_page; n++)
   {
+    // In streaming mode only pages not yet written are still available
+    wxPdfPageHashMap::iterator page = m_pages->find(n);
+    wxPdfAliasPositionsMap::iterator aliasPositions = m_aliasNbPagesPositions->find(n);
+    wxArrayInt* positions = NULL;
+    if (aliasPositions != m_aliasNbPagesPositions->end())
+    {
+      positions = aliasPositions->second;
+      m_aliasNbPagesPositions->erase(aliasPositions);
+    }
+    if (page == m_pages->end() || page->second == NULL)
+    {
+      delete positions;
+      continue;
+    }
+
+    if (n > m_aliasNbPagesScan)
+    {
+      // Only the alias positions recorded on writing the page have to be patched
+      if (positions != NULL)
+      {
+        wxMemoryOutputStream* p = new wxMemoryOutputStream();
+        const char* buffer = (const char*) page->second->GetOutputStreamBuffer()->GetBufferStart();
+        size_t len = (size_t) page->second->GetLength();
+        size_t copied = 0;
+        size_t j;
+        for (j = 0; j < positions->GetCount(); j += 2)
+        {
+          size_t offset = (size_t) (*positions)[j];
+          size_t aliasLen = (size_t) (*positions)[j+1];
+          if (offset > copied)
+          {
+            p->Write(buffer+copied, offset-copied);
+          }
+          if (aliasLen == lenAsc && memcmp(buffer+offset, nbAsc, lenAsc) == 0)
+          {
+            p->Write(pgAsc,lenPgAsc);
+          }
+#if wxUSE_UNICODE
+          else if (aliasLen == lenUni && memcmp(buffer+offset, nbUni, lenUni) == 0)
+          {
+            p->Write(pgUni,lenPgUni);
+          }
+#endif
+          else
+          {
+            // The alias was converted to a different encoding, leave it unchanged
+            p->Write(buffer+offset, aliasLen);
+          }
+          copied = offset + aliasLen;
+        }
+        if (len > copied)
+        {
+          p->Write(buffer+copied, len-copied);
+        }
+        delete page->second;
+        page->second = p;
+        delete positions;
+      }
+      continue;
+    }
+    delete positions;
+
+    // The page was written before the alias was defined and has to be searched
     wxMemoryOutputStream* p = new wxMemoryOutputStream();
-    wxMemoryInputStream inPage(*((*m_pages)[n]));
+    wxMemoryInputStream inPage(*(page->second));
     size_t len = inPage.GetSize();
     char* buffer = new char[len];
     char* pBuf = buffer;
@@ -862,8 +1521,8 @@ wxPdfDocument::ReplaceNbPagesAlias()
       p->Write(pBuf,len);
     }
     delete [] buffer;
-    delete (*m_pages)[n];
-    (*m_pages)[n] = p;
+    delete page->second;
+    page->second = p;
   }
 
 #if wxUSE_UNICODE
@@ -877,12 +1536,20 @@ wxPdfDocument::ReplaceNbPagesAlias()
 void
 wxPdfDocument::PutPages()
 {
-  double wPt, hPt;
+  double hPt;
   int nb = m_page;
   int n;
   int nbannot = 0;
   int firstTextAnnotation = m_n;
 
+  if (m_streaming)
+  {
+    // Pages were already written, except for deferred objects
+    PutStreamedPages();
+    PutPagesRoot();
+    return;
+  }
+
   //Text annotations
   for (n = 1; n <= nb; n++)
   {
@@ -920,17 +1587,21 @@ wxPdfDocument::PutPages()
     ReplaceNbPagesAlias();
   }
 
-  if (m_defOrientation == wxPORTRAIT)
-  {
-    wPt = m_fwPt;
-    hPt = m_fhPt;
-  }
-  else
+  hPt = (m_defOrientation == wxPORTRAIT) ? m_fhPt : m_fwPt;
+  wxString filter = (m_compress) ? wxS("/Filter /FlateDecode ") : wxS("");
+
+  // Compress page contents in parallel, if requested
+  wxPdfCompressionPool compressor(m_compressionThreads);
+  bool compressParallel = m_compress && m_compressionThreads > 1 && nb > 1;
+  if (compressParallel)
   {
-    wPt = m_fhPt;
-    hPt = m_fwPt;
+    for (n = 1; n <= nb; n++)
+    {
+      compressor.Add(*((*m_pages)[n]));
+    }
+    compressor.Execute();
+    m_compressionTimeSaved += compressor.GetTimeSaved();
   }
-  wxString filter = (m_compress) ? wxS("/Filter /FlateDecode ") : wxS("");
 
   m_firstPageId = m_n + 1;
   for (n = 1; n <= nb; n++)
@@ -990,7 +1661,7 @@ wxPdfDocument::PutPages()
             }
             y = h - y;
           }
-          OutAscii(wxString::Format(wxS("/Dest [%d 0 R /XYZ 0 "),m_firstPageId+2*(link->GetPage()-1)) +
+          OutAscii(wxString::Format(wxS("/Dest [%d 0 R /XYZ 0 "),GetPageObjId(link->GetPage())) +
                    wxPdfUtility::Double2String(y,2) +
                    wxString(wxS(" null]>>")),false);
         }
@@ -1032,45 +1703,368 @@ wxPdfDocument::PutPages()
     // TODO: not sure whether writing the group dictionary is necessary
     if (!m_isPdfA1 && m_PDFVersion > wxS("1.3"))
     {
-      Out("/Group <</Type /Group /S /Transparency /CS /DeviceRGB>>");
+      Out("/Group <</Type /Group /S /Transparency /CS /DeviceRGB>>");
+    }
+    OutAscii(wxString::Format(wxS("/Contents %d 0 R>>"), m_n+1));
+    Out("endobj");
+
+    // Page content
+    wxMemoryOutputStream mos;
+    wxMemoryOutputStream* p = (*m_pages)[n];
+    if (compressParallel)
+    {
+      p = &compressor.GetResult(n-1);
+    }
+    else if (m_compress)
+    {
+      CompressStream(*p, mos);
+      p = &mos;
+    }
+
+    NewObj();
+    OutAscii(wxString(wxS("<<")) + filter + wxString(wxS("/Length ")) +
+             wxString::Format(wxS("%lu"), (unsigned long) CalculateStreamLength(p->TellO())) + wxString(wxS(">>")));
+    PutStream(*p);
+    Out("endobj");
+  }
+  PutPagesRoot();
+}
+
+void
+wxPdfDocument::PutPagesRoot()
+{
+  double wPt, hPt;
+  int nb = m_page;
+  if (m_defOrientation == wxPORTRAIT)
+  {
+    wPt = m_fwPt;
+    hPt = m_fhPt;
+  }
+  else
+  {
+    wPt = m_fhPt;
+    hPt = m_fwPt;
+  }
+
+  // Pages root
+  NewObj(1);
+  Out("<</Type /Pages");
+  wxString kids = wxS("/Kids [");
+  int i;
+  for (i = 1; i <= nb; i++)
+  {
+    kids += wxString::Format(wxS("%d"),GetPageObjId(i)) + wxString(wxS(" 0 R "));
+  }
+  OutAscii(kids + wxString(wxS("]")));
+  OutAscii(wxString(wxS("/Count ")) + wxString::Format(wxS("%d"),nb));
+  OutAscii(wxString(wxS("/MediaBox [0 0 ")) +
+           wxPdfUtility::Double2String(wPt,3) + wxString(wxS(" ")) +
+           wxPdfUtility::Double2String(hPt,3) + wxString(wxS("]")));
+  Out(">>");
+  Out("endobj");
+}
+
+int
+wxPdfDocument::GetPageObjId(int page)
+{
+  if (!m_streaming)
+  {
+    // Page objects and their content streams are written alternately
+    return m_firstPageId + 2 * (page - 1);
+  }
+
+  // In streaming mode the object id of a page is reserved on first request,
+  // so that forward references to pages not yet written can be resolved.
+  int objId;
+  wxPdfObjIdHashMap::iterator pageObjId = m_pageObjIds->find(page);
+  if (pageObjId != m_pageObjIds->end())
+  {
+    objId = pageObjId->second;
+  }
+  else
+  {
+    objId = GetNewObjId();
+    (*m_pageObjIds)[page] = objId;
+  }
+  return objId;
+}
+
+bool
+wxPdfDocument::HasNbPagesAlias(int n)
+{
+  bool hasAlias = false;
+  wxPdfPageHashMap::iterator page = m_pages->find(n);
+  if (n > m_aliasNbPagesScan)
+  {
+    hasAlias = m_aliasNbPagesPositions->find(n) != m_aliasNbPagesPositions->end();
+  }
+  else if (m_aliasNbPages.Length() > 0 && page != m_pages->end() && page->second != NULL)
+  {
+    wxStreamBuffer* pageBuffer = page->second->GetOutputStreamBuffer();
+    const char* buffer = (const char*) pageBuffer->GetBufferStart();
+    size_t len = (size_t) page->second->GetLength();
+
+    size_t lenAsc = m_aliasNbPages.Length();
+#if wxUSE_UNICODE
+    const wxScopedCharBuffer wcb(m_aliasNbPages.ToAscii());
+    const char* nbAsc = (const char*) wcb;
+#else
+    const char* nbAsc = m_aliasNbPages.c_str();
+#endif
+    size_t* fAsc = makeFail(nbAsc,lenAsc);
+    hasAlias = findString(buffer,len,nbAsc,lenAsc,fAsc) < len;
+    delete [] fAsc;
+
+#if wxUSE_UNICODE
+    if (!hasAlias)
+    {
+      wxMBConvUTF16BE conv;
+      size_t lenUni = conv.FromWChar(NULL, 0, m_aliasNbPages.wc_str(), lenAsc);
+      char* nbUni = new char[lenUni+3];
+      lenUni = conv.FromWChar(nbUni, lenUni+3, m_aliasNbPages.wc_str(), lenAsc);
+      size_t* fUni = makeFail(nbUni,lenUni);
+      hasAlias = findString(buffer,len,nbUni,lenUni,fUni) < len;
+      delete [] fUni;
+      delete [] nbUni;
+    }
+#endif
+  }
+  return hasAlias;
+}
+
+void
+wxPdfDocument::PutPage(int n)
+{
+  // Reserve object ids, before writing any object
+  int pageObjId = GetPageObjId(n);
+  int contentObjId = GetNewObjId();
+  wxArrayInt linkObjIds;
+  wxArrayPtrVoid* pageLinkArray = NULL;
+  wxPdfPageLinksMap::iterator pageLinks = (*m_pageLinks).find(n);
+  if (pageLinks != (*m_pageLinks).end())
+  {
+    pageLinkArray = pageLinks->second;
+    unsigned int pageLinkCount = (unsigned int) pageLinkArray->GetCount();
+    unsigned int j;
+    for (j = 0; j < pageLinkCount; j++)
+    {
+      wxPdfPageLink* pl = (wxPdfPageLink*) (*pageLinkArray)[j];
+      // Targets of internal links may not be known before the document is closed
+      linkObjIds.Add((pl->IsLinkRef()) ? GetNewObjId() : 0);
+    }
+  }
+
+  // Text annotations
+  wxArrayInt annotObjIds;
+  wxPdfAnnotationsMap::iterator pageAnnots = (*m_annotations).find(n);
+  if (pageAnnots != (*m_annotations).end())
+  {
+    wxArrayPtrVoid* pageAnnotsArray = pageAnnots->second;
+    unsigned int pageAnnotsCount = (unsigned int) pageAnnotsArray->GetCount();
+    unsigned int j;
+    for (j = 0; j < pageAnnotsCount; j++)
+    {
+      wxPdfAnnotation* annotation = (wxPdfAnnotation*) (*pageAnnotsArray)[j];
+      NewObj();
+      annotObjIds.Add(m_n);
+      double x = annotation->GetX();
+      double y = annotation->GetY();
+      Out("<</Type /Annot /Subtype /Text /Rect [", false);
+      wxString rect = wxPdfUtility::Double2String(x,2) + wxString(wxS(" ")) +
+                      wxPdfUtility::Double2String(y,2) + wxString(wxS(" ")) +
+                      wxPdfUtility::Double2String(x,2) + wxString(wxS(" ")) +
+                      wxPdfUtility::Double2String(y,2);
+      OutAscii(rect,false);
+      Out("] /Contents ", false);
+      OutTextstring(annotation->GetText(), false);
+      Out(">>");
+      Out("endobj");
+      delete annotation;
+      (*pageAnnotsArray)[j] = NULL;
+    }
+  }
+
+  // Page
+  int nSave = m_n;
+  m_n = pageObjId;
+  NewObj(pageObjId);
+  Out("<</Type /Page");
+  Out("/Parent 1 0 R");
+
+  if ((*m_orientationChanges).find(n) != (*m_orientationChanges).end())
+  {
+    wxSize pageSize = (*m_pageSizes)[n];
+    double pageWidth = pageSize.GetWidth() / 254. * 72.;
+    double pageHeight = pageSize.GetHeight() / 254. * 72.;
+    OutAscii(wxString(wxS("/MediaBox [0 0 ")) +
+             wxPdfUtility::Double2String(pageWidth,3) + wxString(wxS(" ")) +
+             wxPdfUtility::Double2String(pageHeight,3) + wxString(wxS("]")));
+  }
+
+  Out("/Resources 2 0 R");
+
+  Out("/Annots [",false);
+  if (pageLinkArray != NULL)
+  {
+    unsigned int pageLinkCount = (unsigned int) pageLinkArray->GetCount();
+    unsigned int j;
+    for (j = 0; j < pageLinkCount; j++)
+    {
+      wxPdfPageLink* pl = (wxPdfPageLink*) (*pageLinkArray)[j];
+      if (pl->IsLinkRef())
+      {
+        // Internal links are written when the document is closed
+        OutAscii(wxString::Format(wxS("%d 0 R "), linkObjIds[j]), false);
+        m_deferredLinks.Add(pl);
+        m_deferredLinkIds.Add(linkObjIds[j]);
+      }
+      else
+      {
+        wxString rect = wxPdfUtility::Double2String(pl->GetX(),2) + wxString(wxS(" ")) +
+                        wxPdfUtility::Double2String(pl->GetY(),2) + wxString(wxS(" ")) +
+                        wxPdfUtility::Double2String(pl->GetX()+pl->GetWidth(),2) + wxString(wxS(" ")) +
+                        wxPdfUtility::Double2String(pl->GetY()-pl->GetHeight(),2);
+        Out("<</Type /Annot /Subtype /Link /Rect [",false);
+        OutAscii(rect,false);
+        Out("] /Border [0 0 0] ",false);
+        Out("/A <</S /URI /URI ",false);
+        OutAsciiTextstring(pl->GetLinkURL(),false);
+        Out(">>>>",false);
+        delete pl;
+      }
+      (*pageLinkArray)[j] = NULL;
+    }
+  }
+  size_t k;
+  for (k = 0; k < annotObjIds.GetCount(); k++)
+  {
+    OutAscii(wxString::Format(wxS("%d 0 R "), annotObjIds[k]), false);
+  }
+  wxPdfFormAnnotsMap::iterator formAnnots = (*m_formAnnotations).find(n);
+  if (formAnnots != (*m_formAnnotations).end())
+  {
+    // Form annotations
+    wxArrayPtrVoid* formAnnotsArray = formAnnots->second;
+    unsigned int formAnnotsCount = (unsigned int) formAnnotsArray->GetCount();
+    unsigned int j;
+    for (j = 0; j < formAnnotsCount; j++)
+    {
+      wxPdfIndirectObject* object = static_cast<wxPdfIndirectObject*>((*formAnnotsArray)[j]);
+      OutAscii(wxString::Format(wxS("%d %d R "), object->GetObjectId(), object->GetGenerationId()), false);
+    }
+  }
+  Out("]");
+  if (!m_isPdfA1 && m_PDFVersion > wxS("1.3"))
+  {
+    Out("/Group <</Type /Group /S /Transparency /CS /DeviceRGB>>");
+  }
+  OutAscii(wxString::Format(wxS("/Contents %d 0 R>>"), contentObjId));
+  Out("endobj");
+  m_n = nSave;
+
+  if (HasNbPagesAlias(n))
+  {
+    // Page content is written after the total number of pages is known
+    (*m_contentObjIds)[n] = contentObjId;
+  }
+  else
+  {
+    PutPageContent(n, contentObjId);
+  }
+}
+
+void
+wxPdfDocument::PutPageContent(int n, int objId)
+{
+  wxString filter = (m_compress) ? wxS("/Filter /FlateDecode ") : wxS("");
+  wxPdfPageHashMap::iterator page = m_pages->find(n);
+  if (page == m_pages->end() || page->second == NULL)
+  {
+    return;
+  }
+
+  wxMemoryOutputStream mos;
+  wxMemoryOutputStream* p = page->second;
+  if (m_compress)
+  {
+    CompressStream(*p, mos);
+    p = &mos;
+  }
+
+  int nSave = m_n;
+  m_n = objId;
+  NewObj(objId);
+  OutAscii(wxString(wxS("<<")) + filter + wxString(wxS("/Length ")) +
+           wxString::Format(wxS("%lu"), (unsigned long) CalculateStreamLength(p->TellO())) + wxString(wxS(">>")));
+  PutStream(*p);
+  Out("endobj");
+  m_n = nSave;
+
+  // The page content is no longer needed
+  delete page->second;
+  m_pages->erase(page);
+}
+
+void
+wxPdfDocument::PutStreamedPages()
+{
+  if (m_aliasNbPages.Length() > 0)
+  {
+    // Replace number of pages in pages not yet written
+    ReplaceNbPagesAlias();
+  }
+
+  // Deferred page contents
+  int n;
+  for (n = 1; n <= m_page; n++)
+  {
+    wxPdfObjIdHashMap::iterator contentObjId = m_contentObjIds->find(n);
+    if (contentObjId != m_contentObjIds->end())
+    {
+      PutPageContent(n, contentObjId->second);
     }
-    OutAscii(wxString::Format(wxS("/Contents %d 0 R>>"), m_n+1));
-    Out("endobj");
+  }
+  m_contentObjIds->clear();
 
-    // Page content
-    wxMemoryOutputStream mos;
-    wxMemoryOutputStream* p = (*m_pages)[n];
-    if (m_compress)
+  // Deferred internal link annotations
+  double hPt = (m_defOrientation == wxPORTRAIT) ? m_fhPt : m_fwPt;
+  size_t j;
+  for (j = 0; j < m_deferredLinks.GetCount(); j++)
+  {
+    wxPdfPageLink* pl = (wxPdfPageLink*) m_deferredLinks[j];
+    wxPdfLink* link = (*m_links)[pl->GetLinkRef()];
+    double y = link->GetPosition()*m_k;
+    if (m_yAxisOriginTop)
     {
-      wxZlibOutputStream q(mos);
-      wxMemoryInputStream tmp(*p);
-      q.Write(tmp);
-      p = &mos;
+      double h = hPt;
+      if ((*m_orientationChanges).find(link->GetPage()) != (*m_orientationChanges).end())
+      {
+        wxSize pageSize = (*m_pageSizes)[link->GetPage()];
+        h = pageSize.GetHeight() / 254. * 72.;
+      }
+      y = h - y;
     }
+    int destObjId = GetPageObjId(link->GetPage());
 
-    NewObj();
-    OutAscii(wxString(wxS("<<")) + filter + wxString(wxS("/Length ")) +
-             wxString::Format(wxS("%lu"), (unsigned long) CalculateStreamLength(p->TellO())) + wxString(wxS(">>")));
-    PutStream(*p);
+    int nSave = m_n;
+    m_n = m_deferredLinkIds[j];
+    NewObj(m_n);
+    wxString rect = wxPdfUtility::Double2String(pl->GetX(),2) + wxString(wxS(" ")) +
+                    wxPdfUtility::Double2String(pl->GetY(),2) + wxString(wxS(" ")) +
+                    wxPdfUtility::Double2String(pl->GetX()+pl->GetWidth(),2) + wxString(wxS(" ")) +
+                    wxPdfUtility::Double2String(pl->GetY()-pl->GetHeight(),2);
+    Out("<</Type /Annot /Subtype /Link /Rect [",false);
+    OutAscii(rect,false);
+    Out("] /Border [0 0 0] ",false);
+    OutAscii(wxString::Format(wxS("/Dest [%d 0 R /XYZ 0 "), destObjId) +
+             wxPdfUtility::Double2String(y,2) +
+             wxString(wxS(" null]>>")));
     Out("endobj");
+    m_n = nSave;
+    delete pl;
   }
-  // Pages root
-  (*m_offsets)[0] = m_buffer->TellO();
-  Out("1 0 obj");
-  Out("<</Type /Pages");
-  wxString kids = wxS("/Kids [");
-  int i;
-  for (i = 0; i < nb; i++)
-  {
-    kids += wxString::Format(wxS("%d"),(m_firstPageId+2*i)) + wxString(wxS(" 0 R "));
-  }
-  OutAscii(kids + wxString(wxS("]")));
-  OutAscii(wxString(wxS("/Count ")) + wxString::Format(wxS("%d"),nb));
-  OutAscii(wxString(wxS("/MediaBox [0 0 ")) +
-           wxPdfUtility::Double2String(wPt,3) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(hPt,3) + wxString(wxS("]")));
-  Out(">>");
-  Out("endobj");
+  m_deferredLinks.Clear();
+  m_deferredLinkIds.Clear();
 }
 
 static const wxStringCharType* gs_bms[] = {
@@ -1251,6 +2245,35 @@ wxPdfDocument::PutFonts()
   wxString type;
   wxString name;
   wxPdfFontHashMap::iterator fontIter = m_fonts->begin();
+
+  // Create font programs and maps in parallel, if requested.
+  // Fonts sharing the same font data are handled by the same job,
+  // fonts read via the operating system font API are handled sequentially.
+  wxPdfFontPool fontPool(m_compressionThreads);
+  if (m_compressionThreads > 1)
+  {
+    size_t numFonts = 0;
+    for (fontIter = m_fonts->begin(); fontIter != m_fonts->end(); fontIter++)
+    {
+      wxPdfFontExtended extFont = fontIter->second->GetFont();
+      if (!extFont.UsesSystemFont() && wxPdfFontStreams(fontIter->second).HasWork())
+      {
+        fontPool.Add(fontIter->second);
+        ++numFonts;
+      }
+    }
+    if (fontPool.GetJobCount() > 1)
+    {
+      fontPool.Execute();
+      m_compressionTimeSaved += fontPool.GetTimeSaved();
+    }
+    else if (numFonts > 0)
+    {
+      // Nothing to be gained, create the font streams sequentially
+      fontPool.GetJob(0)->Execute();
+    }
+  }
+
   for (fontIter = m_fonts->begin(); fontIter != m_fonts->end(); fontIter++)
   {
     wxPdfFontDetails* font = fontIter->second;
@@ -1262,8 +2285,10 @@ wxPdfDocument::PutFonts()
       NewObj();
       font->SetFileIndex(m_n);
 
-      wxMemoryOutputStream p;
-      size_t fontSize1 = font->WriteFontData(&p);
+      wxPdfFontStreams* streams = fontPool.Find(font);
+      wxMemoryOutputStream fontData;
+      wxMemoryOutputStream& p = (streams != NULL) ? streams->m_fontData : fontData;
+      size_t fontSize1 = (streams != NULL) ? streams->m_fontSize1 : font->WriteFontData(&p);
 
       size_t fontLen = CalculateStreamLength(p.TellO());
       OutAscii(wxString::Format(wxS("<</Length %lu"), (unsigned long) fontLen));
@@ -1383,8 +2408,13 @@ wxPdfDocument::PutFonts()
         // Embed ToUnicode Map
         // A specification of the mapping from CIDs to glyph indices
         NewObj();
-        wxMemoryOutputStream p;
-        /* size_t mapSize = */ font->WriteUnicodeMap(&p);
+        wxPdfFontStreams* streams = fontPool.Find(font);
+        wxMemoryOutputStream mapData;
+        wxMemoryOutputStream& p = (streams != NULL) ? streams->m_unicodeMapData : mapData;
+        if (streams == NULL)
+        {
+          /* size_t mapSize = */ font->WriteUnicodeMap(&p);
+        }
         size_t mapLen = CalculateStreamLength(p.TellO());
         OutAscii(wxString::Format(wxS("<</Length %lu"), (unsigned long) mapLen));
         Out("/Filter /FlateDecode");
@@ -1395,6 +2425,8 @@ wxPdfDocument::PutFonts()
     }
     else if (type == wxS("TrueTypeUnicode") || type == wxS("OpenTypeUnicode"))
     {
+      wxPdfFontStreams* streams = fontPool.Find(font);
+
       // Type0 Font
       // A composite font composed of other fonts, organized hierarchically
       NewObj();
@@ -1502,8 +2534,12 @@ wxPdfDocument::PutFonts()
       // even if this is done unconditionally.
       {
           NewObj();
-          wxMemoryOutputStream mos;
-          /* size_t mapSize = */ font->WriteUnicodeMap(&mos);
+          wxMemoryOutputStream mapData;
+          wxMemoryOutputStream& mos = (streams != NULL) ? streams->m_unicodeMapData : mapData;
+          if (streams == NULL)
+          {
+            /* size_t mapSize = */ font->WriteUnicodeMap(&mos);
+          }
           size_t mapLen = CalculateStreamLength(mos.TellO());
           OutAscii(wxString::Format(wxS("<</Length %lu"), (unsigned long) mapLen));
           // Decompresses data encoded using the public-domain zlib/deflate compression
@@ -1519,8 +2555,12 @@ wxPdfDocument::PutFonts()
         // Embed CIDToGIDMap
         // A specification of the mapping from CIDs to glyph indices
         NewObj();
-        wxMemoryOutputStream mos;
-        /* size_t mapSize = */ font->WriteCIDToGIDMap(&mos);
+        wxMemoryOutputStream mapData;
+        wxMemoryOutputStream& mos = (streams != NULL) ? streams->m_cidToGidMapData : mapData;
+        if (streams == NULL)
+        {
+          /* size_t mapSize = */ font->WriteCIDToGIDMap(&mos);
+        }
         size_t mapLen = CalculateStreamLength(mos.TellO());
         OutAscii(wxString::Format(wxS("<</Length %lu"), (unsigned long)mapLen));
         // Decompresses data encoded using the public-domain zlib/deflate compression
@@ -1535,8 +2575,12 @@ wxPdfDocument::PutFonts()
         // Embed CID set
         // A specification which CIDs are present in the subset
         NewObj();
-        wxMemoryOutputStream mos;
-        /* size_t mapSize = */ font->WriteCIDSet(&mos);
+        wxMemoryOutputStream setData;
+        wxMemoryOutputStream& mos = (streams != NULL) ? streams->m_cidSetData : setData;
+        if (streams == NULL)
+        {
+          /* size_t mapSize = */ font->WriteCIDSet(&mos);
+        }
         size_t setLen = CalculateStreamLength(mos.TellO());
         OutAscii(wxString::Format(wxS("<</Length %lu"), (unsigned long)setLen));
         // Decompresses data encoded using the public-domain zlib/deflate compression
@@ -1595,10 +2639,66 @@ wxPdfDocument::PutFonts()
   }
 }
 
+void
+wxPdfDocument::UpdateMaskPlacedSizes()
+{
+  // Soft masks and image masks are downsampled like the images using them
+  std::map<int, wxPdfImage*> imagesByIndex;
+  wxPdfImageHashMap::iterator image;
+  for (image = m_images->begin(); image != m_images->end(); image++)
+  {
+    imagesByIndex[image->second->GetIndex()] = image->second;
+  }
+  for (image = m_images->begin(); image != m_images->end(); image++)
+  {
+    wxPdfImage* currentImage = image->second;
+    if (currentImage->GetMaskImage() > 0)
+    {
+      std::map<int, wxPdfImage*>::iterator maskImage = imagesByIndex.find(currentImage->GetMaskImage());
+      if (maskImage != imagesByIndex.end())
+      {
+        maskImage->second->UpdatePlacedSize(currentImage->GetPlacedWidth(), currentImage->GetPlacedHeight());
+      }
+    }
+  }
+}
+
 void
 wxPdfDocument::PutImages()
 {
   wxString filter = (m_compress) ? wxS("/Filter /FlateDecode ") : wxS("");
+
+  bool imagePolicy = (m_imageTargetDpi > 0 || m_imageMaxPixels > 0 || m_imageDetectGreyscale);
+  if (imagePolicy)
+  {
+    UpdateMaskPlacedSizes();
+  }
+
+  // Compress the data of form objects in parallel, if requested
+  wxPdfCompressionPool compressor(m_compressionThreads);
+  std::map<wxPdfImage*, size_t> compressedForms;
+  if (m_compress && m_compressionThreads > 1)
+  {
+    wxPdfImageHashMap::iterator image;
+    for (image = m_images->begin(); image != m_images->end(); image++)
+    {
+      wxPdfImage* currentImage = image->second;
+      if (currentImage->IsFormObject())
+      {
+        compressedForms[currentImage] = compressor.Add(currentImage->GetData(), currentImage->GetDataSize());
+      }
+    }
+    if (compressor.GetJobCount() > 1)
+    {
+      compressor.Execute();
+      m_compressionTimeSaved += compressor.GetTimeSaved();
+    }
+    else
+    {
+      compressedForms.clear();
+    }
+  }
+
   int iter;
   for (iter = 0; iter < 2; iter++)
   {
@@ -1635,27 +2735,55 @@ wxPdfDocument::PutImages()
           Out("/Filter /FlateDecode");
         }
         size_t dataLen = currentImage->GetDataSize();
-        wxMemoryOutputStream p;
-        if (m_compress)
+        wxMemoryOutputStream mos;
+        wxMemoryOutputStream* p = &mos;
+        std::map<wxPdfImage*, size_t>::iterator compressedForm = compressedForms.find(currentImage);
+        if (compressedForm != compressedForms.end())
+        {
+          p = &compressor.GetResult(compressedForm->second);
+        }
+        else if (m_compress)
         {
-          wxZlibOutputStream q(p);
-          q.Write(currentImage->GetData(),currentImage->GetDataSize());
+          CompressBuffer(currentImage->GetData(), currentImage->GetDataSize(), mos);
         }
         else
         {
-          p.Write(currentImage->GetData(),currentImage->GetDataSize());
+          mos.Write(currentImage->GetData(),currentImage->GetDataSize());
         }
-        dataLen = CalculateStreamLength(p.TellO());
+        dataLen = CalculateStreamLength(p->TellO());
         OutAscii(wxString::Format(wxS("/Length %lu>>"), (unsigned long) dataLen));
-        PutStream(p);
+        PutStream(*p);
 
         Out("endobj");
       }
       else
       {
+        // The image policy is applied to a temporary copy, the image keeps its data for later documents
+        wxPdfImage* policyImage = (imagePolicy) ? currentImage->CreatePolicyImage(m_imageTargetDpi, m_imageMaxPixels,
+                                                                                   m_imageJpegQuality, m_imageDetectGreyscale)
+                                                : NULL;
+        wxPdfImage* outputImage = (policyImage != NULL) ? policyImage : currentImage;
+
+        // Image data whose loading was deferred are read from the image file now
+        wxMemoryOutputStream mos;
+        if (!outputImage->WriteData(mos))
+        {
+          // The image file was changed or removed, a blank image keeps the document valid
+          m_writeError = true;
+          unsigned char blank = 0xff;
+          wxMemoryOutputStream placeholder;
+          placeholder.Write(&blank, 1);
+          Out("/Subtype /Image /Width 1 /Height 1 /ColorSpace /DeviceGray /BitsPerComponent 8");
+          OutAscii(wxString::Format(wxS("/Length %lu>>"), (unsigned long) CalculateStreamLength(1)));
+          PutStream(placeholder);
+          Out("endobj");
+          delete policyImage;
+          continue;
+        }
+
         Out("/Subtype /Image");
-        OutAscii(wxString::Format(wxS("/Width %d"),currentImage->GetWidth()));
-        OutAscii(wxString::Format(wxS("/Height %d"),currentImage->GetHeight()));
+        OutAscii(wxString::Format(wxS("/Width %d"),outputImage->GetWidth()));
+        OutAscii(wxString::Format(wxS("/Height %d"),outputImage->GetHeight()));
 
         int maskImage = currentImage->GetMaskImage();
         if (maskImage > 0)
@@ -1676,33 +2804,33 @@ wxPdfDocument::PutImages()
           }
         }
 
-        if (currentImage->GetColourSpace() == wxS("Indexed"))
+        if (outputImage->GetColourSpace() == wxS("Indexed"))
         {
-          int palLen = currentImage->GetPaletteSize() / 3 - 1;
+          int palLen = outputImage->GetPaletteSize() / 3 - 1;
           OutAscii(wxString::Format(wxS("/ColorSpace [/Indexed /DeviceRGB %d %d 0 R]"),
                    palLen,(m_n+1)));
         }
         else
         {
-          OutAscii(wxString(wxS("/ColorSpace /")) + currentImage->GetColourSpace());
-          if (currentImage->GetColourSpace() == wxS("DeviceCMYK"))
+          OutAscii(wxString(wxS("/ColorSpace /")) + outputImage->GetColourSpace());
+          if (outputImage->GetColourSpace() == wxS("DeviceCMYK"))
           {
             Out("/Decode [1 0 1 0 1 0 1 0]");
           }
         }
-        OutAscii(wxString::Format(wxS("/BitsPerComponent %d"),currentImage->GetBitsPerComponent()));
-        wxString f = currentImage->GetF();
+        OutAscii(wxString::Format(wxS("/BitsPerComponent %d"),outputImage->GetBitsPerComponent()));
+        wxString f = outputImage->GetF();
         if (f.Length() > 0)
         {
           OutAscii(wxString(wxS("/Filter /")) + f);
         }
-        wxString parms = currentImage->GetParms();
+        wxString parms = outputImage->GetParms();
         if (parms.Length() > 0)
         {
           OutAscii(parms);
         }
-        int trnsSize = currentImage->GetTransparencySize();
-        unsigned char* trnsData = (unsigned char*) currentImage->GetTransparency();
+        int trnsSize = outputImage->GetTransparencySize();
+        unsigned char* trnsData = (unsigned char*) outputImage->GetTransparency();
         if (trnsSize > 0)
         {
           wxString trns = wxS("");;
@@ -1715,12 +2843,10 @@ wxPdfDocument::PutImages()
           OutAscii(wxString(wxS("/Mask [")) + trns + wxString(wxS("]")));
         }
 
-        OutAscii(wxString::Format(wxS("/Length %lu>>"), (unsigned long) CalculateStreamLength(currentImage->GetDataSize())));
-
-        wxMemoryOutputStream mos;
-        mos.Write(currentImage->GetData(),currentImage->GetDataSize());
+        OutAscii(wxString::Format(wxS("/Length %lu>>"), (unsigned long) CalculateStreamLength((size_t) mos.TellO())));
         PutStream(mos);
         Out("endobj");
+        delete policyImage;
 
         // Palette
         if (currentImage->GetColourSpace() == wxS("Indexed"))
@@ -1752,6 +2878,21 @@ wxPdfDocument::PutTemplates()
 {
   wxString filter = (m_compress) ? wxS("/Filter /FlateDecode ") : wxS("");
   wxPdfTemplatesMap::iterator templateIter = m_templates->begin();
+
+  // Compress template data in parallel, if requested
+  wxPdfCompressionPool compressor(m_compressionThreads);
+  bool compressParallel = m_compress && m_compressionThreads > 1 && m_templates->size() > 1;
+  if (compressParallel)
+  {
+    for (templateIter = m_templates->begin(); templateIter != m_templates->end(); templateIter++)
+    {
+      compressor.Add(templateIter->second->m_buffer);
+    }
+    compressor.Execute();
+    m_compressionTimeSaved += compressor.GetTimeSaved();
+  }
+
+  size_t templateIndex = 0;
   for (templateIter = m_templates->begin(); templateIter != m_templates->end(); templateIter++)
   {
     // Image objects
@@ -1834,15 +2975,14 @@ wxPdfDocument::PutTemplates()
 
     // Template data
     wxMemoryOutputStream mos, *p;
-    if (m_compress)
+    if (compressParallel)
+    {
+      p = &compressor.GetResult(templateIndex);
+    }
+    else if (m_compress)
     {
       p = &mos;
-      wxZlibOutputStream q(mos);
-      if (currentTemplate->m_buffer.GetLength() > 0)
-      {
-        wxMemoryInputStream tmp(currentTemplate->m_buffer);
-        q.Write(tmp);
-      }
+      CompressStream(currentTemplate->m_buffer, mos);
     }
     else
     {
@@ -1855,6 +2995,7 @@ wxPdfDocument::PutTemplates()
     PutStream(*p);
     Out("endobj");
     m_n = nSave;
+    ++templateIndex;
   }
 }
 
@@ -1876,6 +3017,11 @@ wxPdfDocument::PutImportedObjects()
         NewObj(entry->GetActualObjectId());
         WriteObjectValue(resolvedObject);
         Out("endobj");
+        if (resolvedObject->GetType() == OBJTYPE_STREAM)
+        {
+          // Stream data are not needed after writing the object
+          ((wxPdfStream*) resolvedObject)->ReleaseData();
+        }
         entry->SetObject(resolvedObject);
       }
     }
@@ -2055,7 +3201,7 @@ wxPdfDocument::PutBookmarks()
     {
       y = m_h - y;
     }
-    OutAscii(wxString::Format(wxS("/Dest [%d 0 R /XYZ 0 "), (m_firstPageId+2*(bookmark->GetPage()-1))) +
+    OutAscii(wxString::Format(wxS("/Dest [%d 0 R /XYZ 0 "), GetPageObjId(bookmark->GetPage())) +
              wxPdfUtility::Double2String(y*m_k,2) + wxString(wxS(" null]")));
     Out("/Count 0>>");
     Out("endobj");
@@ -2277,7 +3423,7 @@ wxPdfDocument::PutPatterns()
               wxString::Format(wxS("/I%d Do Q"), image->GetIndex());
             wxMemoryOutputStream mos;
             mos.Write(sdata.ToAscii(), sdata.Length());
-            OutAscii(wxString(wxS("/Length ")) + wxString::Format(wxS("%lu"), (unsigned long)CalculateStreamLength(mos.TellO())));
+            OutAscii(wxString(wxS("/Length ")) + wxString::Format(wxS("%lu"), (unsigned long)CalculateStreamLength((size_t) mos.TellO())));
             Out(">>");
             PutStream(mos);
           }
@@ -2306,7 +3452,7 @@ wxPdfDocument::PutPatterns()
               m_templatePrefix + wxString::Format(wxS("%d Do Q"), tpl->GetIndex());
             wxMemoryOutputStream mos;
             mos.Write(sdata.ToAscii(), sdata.Length());
-            OutAscii(wxString(wxS("/Length ")) + wxString::Format(wxS("%lu"), (unsigned long)CalculateStreamLength(mos.TellO())));
+            OutAscii(wxString(wxS("/Length ")) + wxString::Format(wxS("%lu"), (unsigned long)CalculateStreamLength((size_t) mos.TellO())));
             Out(">>");
             PutStream(mos);
           }
@@ -2534,7 +3680,7 @@ wxPdfDocument::PutPatterns()
             patternData + wxS(" S Q");
           wxMemoryOutputStream mos;
           mos.Write(sdata.ToAscii(), sdata.Length());
-          OutAscii(wxString(wxS("/Length ")) + wxString::Format(wxS("%lu"), (unsigned long)CalculateStreamLength(mos.TellO())));
+          OutAscii(wxString(wxS("/Length ")) + wxString::Format(wxS("%lu"), (unsigned long)CalculateStreamLength((size_t) mos.TellO())));
           Out(">>");
           PutStream(mos);
           Out("endobj");
@@ -2725,8 +3871,7 @@ wxPdfDocument::PutResources()
   PutLayers();
 
   // Resource dictionary
-  (*m_offsets)[2-1] = m_buffer->TellO();
-  Out("2 0 obj");
+  NewObj(2);
   Out("<<");
   PutResourceDict();
   Out(">>");
@@ -2818,6 +3963,79 @@ wxPdfDocument::ShowGlyph(wxUint32 glyph)
   }
 }
 
+// Append a byte string escaped for a PDF string literal to a buffer
+static void
+EscapeText(const char* s, size_t len, std::string& buffer)
+{
+  buffer.reserve(buffer.length() + len + len / 8);
+  size_t j;
+  for (j = 0; j < len; j++)
+  {
+    switch (s[j])
+    {
+      case '\b':
+        buffer.append("\\b");
+        break;
+      case '\f':
+        buffer.append("\\f");
+        break;
+      case '\n':
+        buffer.append("\\n");
+        break;
+      case '\r':
+        buffer.append("\\r");
+        break;
+      case '\t':
+        buffer.append("\\t");
+        break;
+      case '\\':
+      case '(':
+      case ')':
+        buffer.push_back('\\');
+        wxFALLTHROUGH;
+      default:
+        buffer.push_back(s[j]);
+        break;
+    }
+  }
+}
+
+wxPdfTextRun*
+wxPdfDocument::FindTextRun(const wxString& s)
+{
+  wxPdfTextRun* run = NULL;
+  if (m_currentFont != NULL && s.length() <= wxPDF_TEXTRUN_MAX_LENGTH)
+  {
+    wxString key = wxString::Format(wxS("%d:"), m_currentFont->GetIndex()) + s;
+    wxPdfTextRunMap::iterator textRun = m_textRuns->find(key);
+    if (textRun != m_textRuns->end())
+    {
+      run = textRun->second;
+    }
+    else
+    {
+      if (m_textRuns->size() >= wxPDF_TEXTRUN_CACHE_SIZE)
+      {
+        ClearTextRunCache();
+      }
+      run = new wxPdfTextRun();
+      (*m_textRuns)[key] = run;
+    }
+  }
+  return run;
+}
+
+void
+wxPdfDocument::ClearTextRunCache()
+{
+  wxPdfTextRunMap::iterator textRun;
+  for (textRun = m_textRuns->begin(); textRun != m_textRuns->end(); ++textRun)
+  {
+    delete textRun->second;
+  }
+  m_textRuns->clear();
+}
+
 void
 wxPdfDocument::ShowText(const wxString& txt)
 {
@@ -2827,7 +4045,20 @@ wxPdfDocument::ShowText(const wxString& txt)
     wxArrayInt kerning;
     if (m_kerning)
     {
-      kerning = m_currentFont->GetKerningWidthArray(txt);
+      wxPdfTextRun* run = FindTextRun(txt);
+      if (run == NULL)
+      {
+        kerning = m_currentFont->GetKerningWidthArray(txt);
+      }
+      else
+      {
+        if (!run->m_hasKerning)
+        {
+          run->m_kerning = m_currentFont->GetKerningWidthArray(txt);
+          run->m_hasKerning = true;
+        }
+        kerning = run->m_kerning;
+      }
     }
     if (m_wsApply)
     {
@@ -2891,29 +4122,48 @@ wxPdfDocument::TextEscape(const wxString& s, bool newline)
 {
   if (m_currentFont != NULL)
   {
-    wxString t = m_currentFont->ConvertCID2GID(s);
-#if wxUSE_UNICODE
-    size_t slen = t.length();
-    wxMBConv* conv = m_currentFont->GetEncodingConv();
-    size_t len = conv->FromWChar(NULL, 0, t.wc_str(), slen);
-    char* mbstr = new char[len+3];
-    len = conv->FromWChar(mbstr, len+3, t.wc_str(), slen);
-    if (len == wxCONV_FAILED)
+    size_t aliasPos = wxString::npos;
+    if (m_state == 2 && !m_inTemplate && m_aliasNbPages.Length() > 0)
     {
-      len = strlen(mbstr);
+      aliasPos = s.find(m_aliasNbPages);
+    }
+    if (aliasPos == wxString::npos)
+    {
+      OutTextEscaped(s);
+    }
+    else
+    {
+      // Record the positions of the page number alias for replacement on closing the document
+      wxMemoryOutputStream* page = (*m_pages)[m_page];
+      wxArrayInt*& positions = (*m_aliasNbPagesPositions)[m_page];
+      if (positions == NULL)
+      {
+        positions = new wxArrayInt();
+      }
+      size_t aliasLen = m_aliasNbPages.Length();
+      size_t start = 0;
+      while (aliasPos != wxString::npos)
+      {
+        if (aliasPos > start)
+        {
+          OutTextEscaped(s.substr(start, aliasPos - start));
+        }
+        int offset = (int) page->TellO();
+        OutTextEscaped(m_aliasNbPages);
+        positions->Add(offset);
+        positions->Add((int) page->TellO() - offset);
+        start = aliasPos + aliasLen;
+        aliasPos = s.find(m_aliasNbPages, start);
+      }
+      if (start < s.Length())
+      {
+        OutTextEscaped(s.substr(start));
+      }
     }
-#else
-    size_t len = t.Length();;
-    char* mbstr = new char[len+1];
-    strcpy(mbstr,t.c_str());
-#endif
-
-    OutEscape(mbstr,len);
     if (newline)
     {
       Out("\n",false);
     }
-    delete [] mbstr;
   }
   else
   {
@@ -2922,6 +4172,47 @@ wxPdfDocument::TextEscape(const wxString& s, bool newline)
   }
 }
 
+void
+wxPdfDocument::OutTextEscaped(const wxString& s)
+{
+  wxPdfTextRun* run = FindTextRun(s);
+  if (run != NULL && run->m_hasEscaped)
+  {
+    Out(run->m_escaped.data(), run->m_escaped.length(), false);
+    return;
+  }
+
+  wxString t = m_currentFont->ConvertCID2GID(s);
+#if wxUSE_UNICODE
+  size_t slen = t.length();
+  wxMBConv* conv = m_currentFont->GetEncodingConv();
+  size_t len = conv->FromWChar(NULL, 0, t.wc_str(), slen);
+  char* mbstr = new char[len+3];
+  len = conv->FromWChar(mbstr, len+3, t.wc_str(), slen);
+  if (len == wxCONV_FAILED)
+  {
+    len = strlen(mbstr);
+  }
+#else
+  size_t len = t.Length();;
+  char* mbstr = new char[len+1];
+  strcpy(mbstr,t.c_str());
+#endif
+
+  if (run != NULL)
+  {
+    run->m_escaped.clear();
+    EscapeText(mbstr, len, run->m_escaped);
+    run->m_hasEscaped = true;
+    Out(run->m_escaped.data(), run->m_escaped.length(), false);
+  }
+  else
+  {
+    OutEscape(mbstr,len);
+  }
+  delete [] mbstr;
+}
+
 size_t
 wxPdfDocument::CalculateStreamLength(size_t length)
 {
@@ -2947,42 +4238,29 @@ wxPdfDocument::CalculateStreamOffset()
 void
 wxPdfDocument::PutStream(wxMemoryOutputStream& s)
 {
+  PutStream((const char*) s.GetOutputStreamBuffer()->GetBufferStart(), (size_t) s.GetLength());
+}
+
+void
+wxPdfDocument::PutStream(const char* data, size_t len)
+{
+  m_objHasStream = true;
   Out("stream");
-  if (s.GetLength() != 0)
+  if (len != 0)
   {
     if (m_encrypted)
     {
-      wxMemoryInputStream instream(s);
-      size_t len = instream.GetSize();
       size_t lenbuf = CalculateStreamLength(len);
       size_t ofs = CalculateStreamOffset();
       char* buffer = new char[lenbuf];
-      instream.Read(&buffer[ofs],len);
+      memcpy(&buffer[ofs], data, len);
       m_encryptor->Encrypt(m_n, 0, (unsigned char*) buffer, (unsigned int) len);
       Out(buffer, lenbuf);
       delete [] buffer;
     }
     else
     {
-      wxMemoryInputStream tmp(s);
-      if(m_state==2)
-      {
-        if (!m_inTemplate)
-        {
-          (*m_pages)[m_page]->Write(tmp);
-          (*m_pages)[m_page]->Write("\n",1);
-        }
-        else
-        {
-          m_currentTemplate->m_buffer.Write(tmp);
-          m_currentTemplate->m_buffer.Write("\n",1);
-        }
-      }
-      else
-      {
-        m_buffer->Write(tmp);
-        m_buffer->Write("\n",1);
-      }
+      Out(data, len);
     }
   }
   Out("endstream");
@@ -3222,11 +4500,40 @@ wxPdfDocument::Out(const char* s, size_t len, bool newline)
   }
 }
 
+void
+wxPdfDocument::OutNumbers(const double* values, size_t count, int precision, const char* op, bool newline)
+{
+  // Assemble the numbers in a local buffer to avoid heap allocations
+  char line[256];
+  size_t len = 0;
+  size_t j;
+  for (j = 0; j < count; ++j)
+  {
+    if (len + wxPDF_DOUBLE_BUFFER_SIZE + 1 > sizeof(line))
+    {
+      Out(line, len, false);
+      len = 0;
+    }
+    size_t numLen = wxPdfUtility::Double2Ascii(values[j], precision, line + len);
+    if (numLen == 0)
+    {
+      // Value out of range of the fast formatter
+      Out(line, len, false);
+      len = 0;
+      OutAscii(wxPdfUtility::Double2String(values[j], precision), false);
+    }
+    len += numLen;
+    line[len++] = ' ';
+  }
+  Out(line, len, false);
+  Out(op, newline);
+}
+
 void
 wxPdfDocument::OutPoint(double x, double y)
 {
-  OutAscii(wxPdfUtility::Double2String(x * m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(y * m_k,2) + wxString(wxS(" m")));
+  double values[2] = { x * m_k, y * m_k };
+  OutNumbers(values, 2, 2, "m");
   m_x = x;
   m_y = y;
 }
@@ -3236,16 +4543,16 @@ wxPdfDocument::OutPointRelative(double dx, double dy)
 {
   m_x += dx;
   m_y += dy;
-  OutAscii(wxPdfUtility::Double2String(m_x * m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(m_y * m_k,2) + wxString(wxS(" m")));
+  double values[2] = { m_x * m_k, m_y * m_k };
+  OutNumbers(values, 2, 2, "m");
 }
 
 void
 wxPdfDocument::OutLine(double x, double y)
 {
   // Draws a line from last draw point
-  OutAscii(wxPdfUtility::Double2String(x * m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(y * m_k,2) + wxString(wxS(" l")));
+  double values[2] = { x * m_k, y * m_k };
+  OutNumbers(values, 2, 2, "l");
   m_x = x;
   m_y = y;
 }
@@ -3256,20 +4563,16 @@ wxPdfDocument::OutLineRelative(double dx, double dy)
   m_x += dx;
   m_y += dy;
   // Draws a line from last draw point
-  OutAscii(wxPdfUtility::Double2String(m_x * m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(m_y * m_k,2) + wxString(wxS(" l")));
+  double values[2] = { m_x * m_k, m_y * m_k };
+  OutNumbers(values, 2, 2, "l");
 }
 
 void
 wxPdfDocument::OutCurve(double x1, double y1, double x2, double y2, double x3, double y3)
 {
   // Draws a Bezier curve from last draw point
-  OutAscii(wxPdfUtility::Double2String(x1 * m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(y1 * m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(x2 * m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(y2 * m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(x3 * m_k,2) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String(y3 * m_k,2) + wxString(wxS(" c")));
+  double values[6] = { x1 * m_k, y1 * m_k, x2 * m_k, y2 * m_k, x3 * m_k, y3 * m_k };
+  OutNumbers(values, 6, 2, "c");
   m_x = x3;
   m_y = y3;
 }
@@ -3301,6 +4604,11 @@ wxPdfDocument::OutImage(wxPdfImage* currentImage,
   {
     h = (w * currentImage->GetHeight()) / currentImage->GetWidth();
   }
+  if (!currentImage->IsFormObject())
+  {
+    // Keep track of the largest placement for the image policy
+    currentImage->UpdatePlacedSize(w * m_k, h * m_k);
+  }
 
   double sw, sh, sx, sy;
   if (currentImage->IsFormObject())
@@ -3347,12 +4655,7 @@ wxPdfDocument::OutImage(wxPdfImage* currentImage,
 void
 wxPdfDocument::Transform(double tm[6])
 {
-  OutAscii(wxPdfUtility::Double2String( tm[0],3) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String( tm[1],3) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String( tm[2],3) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String( tm[3],3) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String( tm[4],3) + wxString(wxS(" ")) +
-           wxPdfUtility::Double2String( tm[5],3) + wxString(wxS(" cm")));
+  OutNumbers(tm, 6, 3, "cm");
 }
 
 void
@@ -286,6 +286,8 @@ wxPdfStream::wxPdfStream()
   m_offset     = 0;
   m_dictionary = NULL;
   m_buffer     = NULL;
+  m_viewData   = NULL;
+  m_viewLength = 0;
   m_hasObjOffsets = false;
 }
 
@@ -295,6 +297,8 @@ wxPdfStream::wxPdfStream(off_t offset)
   m_offset     = offset;
   m_dictionary = NULL;
   m_buffer     = NULL;
+  m_viewData   = NULL;
+  m_viewLength = 0;
   m_hasObjOffsets = false;
 }
 
@@ -311,6 +315,30 @@ wxPdfStream::~wxPdfStream()
   m_objOffsets.Clear();
 }
 
+wxMemoryOutputStream*
+wxPdfStream::GetBuffer()
+{
+  if (m_buffer == NULL && m_viewData != NULL)
+  {
+    m_buffer = new wxMemoryOutputStream();
+    m_buffer->Write(m_viewData, m_viewLength);
+    m_buffer->Close();
+  }
+  return m_buffer;
+}
+
+void
+wxPdfStream::ReleaseData()
+{
+  if (m_buffer != NULL)
+  {
+    delete m_buffer;
+    m_buffer = NULL;
+  }
+  m_viewData = NULL;
+  m_viewLength = 0;
+}
+
 wxPdfObject*
 wxPdfStream::Get(const wxString& key)
 {
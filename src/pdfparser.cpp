@@ -30,6 +30,7 @@
 #include "wx/pdfobjects.h"
 #include "wx/pdfparser.h"
 #include "wx/pdftemplate.h"
+#include "wx/pdfutility.h"
 
 #include <wx/arrimpl.cpp>
 WX_DEFINE_OBJARRAY(wxPdfXRef);
@@ -45,6 +46,138 @@ wxPdfXRefEntry::~wxPdfXRefEntry()
 {
 }
 
+wxPdfObjectCacheEntry::wxPdfObjectCacheEntry(long objNum, wxPdfObject* object, size_t size)
+{
+  m_objNum = objNum;
+  m_object = object;
+  m_size = size;
+  m_prev = NULL;
+  m_next = NULL;
+}
+
+wxPdfObjectCache::wxPdfObjectCache(size_t maxSize)
+{
+  m_maxSize = maxSize;
+  m_size = 0;
+  m_first = NULL;
+  m_last = NULL;
+}
+
+wxPdfObjectCache::~wxPdfObjectCache()
+{
+  Clear();
+}
+
+void
+wxPdfObjectCache::SetMaxSize(size_t maxSize)
+{
+  m_maxSize = maxSize;
+  Shrink();
+}
+
+void
+wxPdfObjectCache::Add(long objNum, wxPdfObject* object, size_t size)
+{
+  wxPdfObjectCacheMap::iterator entryIter = m_entries.find(objNum);
+  if (entryIter != m_entries.end())
+  {
+    wxPdfObjectCacheEntry* oldEntry = entryIter->second;
+    Unlink(oldEntry);
+    m_entries.erase(entryIter);
+    if (oldEntry->m_object != object)
+    {
+      delete oldEntry->m_object;
+    }
+    delete oldEntry;
+  }
+
+  wxPdfObjectCacheEntry* entry = new wxPdfObjectCacheEntry(objNum, object, size);
+  entry->m_next = m_first;
+  if (m_first != NULL)
+  {
+    m_first->m_prev = entry;
+  }
+  else
+  {
+    m_last = entry;
+  }
+  m_first = entry;
+  m_size += size;
+  m_entries[objNum] = entry;
+  Shrink();
+}
+
+wxPdfObject*
+wxPdfObjectCache::Detach(long objNum)
+{
+  wxPdfObject* object = NULL;
+  wxPdfObjectCacheMap::iterator entryIter = m_entries.find(objNum);
+  if (entryIter != m_entries.end())
+  {
+    wxPdfObjectCacheEntry* entry = entryIter->second;
+    object = entry->m_object;
+    Unlink(entry);
+    m_entries.erase(entryIter);
+    delete entry;
+  }
+  return object;
+}
+
+void
+wxPdfObjectCache::Clear()
+{
+  wxPdfObjectCacheEntry* entry = m_first;
+  while (entry != NULL)
+  {
+    wxPdfObjectCacheEntry* next = entry->m_next;
+    delete entry->m_object;
+    delete entry;
+    entry = next;
+  }
+  m_entries.clear();
+  m_first = NULL;
+  m_last = NULL;
+  m_size = 0;
+}
+
+void
+wxPdfObjectCache::Unlink(wxPdfObjectCacheEntry* entry)
+{
+  if (entry->m_prev != NULL)
+  {
+    entry->m_prev->m_next = entry->m_next;
+  }
+  else
+  {
+    m_first = entry->m_next;
+  }
+  if (entry->m_next != NULL)
+  {
+    entry->m_next->m_prev = entry->m_prev;
+  }
+  else
+  {
+    m_last = entry->m_prev;
+  }
+  entry->m_prev = NULL;
+  entry->m_next = NULL;
+  m_size -= entry->m_size;
+}
+
+void
+wxPdfObjectCache::Shrink()
+{
+  // The most recently used entry is kept in any case
+  while (m_size > m_maxSize && m_last != NULL && m_last != m_first)
+  {
+    wxPdfObjectCacheEntry* entry = m_last;
+    Unlink(entry);
+    m_entries.erase(entry->m_objNum);
+    delete entry->m_object;
+    delete entry;
+  }
+}
+
 void
 wxPdfParser::ReserveXRef(size_t count)
 {
@@ -73,7 +206,7 @@ wxPdfParser::wxPdfParser(const wxString& filename, const wxString& password)
   m_objectQueue     = new wxPdfObjectQueue();
   m_objectQueueLast = m_objectQueue;
   m_objectMap       = new wxPdfObjectMap();
-  m_objStmCache     = new wxPdfObjStmMap();
+  m_objStmCache     = new wxPdfObjectCache();
   m_tokens  = NULL;
   m_trailer = NULL;
   m_root    = NULL;
@@ -85,9 +218,35 @@ wxPdfParser::wxPdfParser(const wxString& filename, const wxString& password)
 
   m_filename = filename;
   m_password = password;
+  m_initialized = false;
+  m_pdfFile = NULL;
+  m_mappedFile = NULL;
 
-  wxString fileURL = filename;
+  // Local files are mapped into memory and scanned without copying
+  wxString localFileName;
   wxURI uri(filename);
+  if (wxFileExists(filename))
+  {
+    localFileName = filename;
+  }
+  else if (uri.GetScheme() == wxS("file"))
+  {
+    localFileName = wxFileSystem::URLToFileName(filename).GetFullPath();
+  }
+  if (!localFileName.IsEmpty())
+  {
+    m_mappedFile = new wxPdfMappedFile();
+    if (m_mappedFile->Open(localFileName))
+    {
+      m_tokens = new wxPdfTokenizer(m_mappedFile->GetData(), m_mappedFile->GetLength());
+      m_initialized = ParseDocument();
+      return;
+    }
+    delete m_mappedFile;
+    m_mappedFile = NULL;
+  }
+
+  wxString fileURL = filename;
   if (!uri.HasScheme())
   {
     fileURL = wxFileSystem::FileNameToURL(filename);
@@ -102,29 +261,10 @@ wxPdfParser::wxPdfParser(const wxString& filename, const wxString& password)
 
 wxPdfParser::~wxPdfParser()
 {
-  wxPdfObjectQueue* entry = m_objectQueue;
-  wxPdfObjectQueue* next;
-  while (entry != NULL)
-  {
-    wxPdfObject* object = entry->GetObject();
-    if (object != NULL && object->IsCreatedIndirect())
-    {
-      delete object;
-    }
-    next = entry->GetNext();
-    delete entry;
-    entry = next;
-  }
+  ClearObjectQueue();
+  delete m_objectQueue;
   delete m_objectMap;
 
-  wxPdfObjStmMap::iterator objStm = m_objStmCache->begin();
-  for (objStm = m_objStmCache->begin(); objStm != m_objStmCache->end(); objStm++)
-  {
-    if (objStm->second != NULL)
-    {
-      delete objStm->second;
-    }
-  }
   delete m_objStmCache;
 
   size_t j;
@@ -149,6 +289,10 @@ wxPdfParser::~wxPdfParser()
   {
     delete m_pdfFile;
   }
+  if (m_mappedFile != NULL)
+  {
+    delete m_mappedFile;
+  }
 
   if (m_decryptor != NULL)
   {
@@ -159,7 +303,7 @@ wxPdfParser::~wxPdfParser()
 bool
 wxPdfParser::IsOk() const
 {
-  return (m_pdfFile != NULL && m_initialized);
+  return ((m_pdfFile != NULL || m_mappedFile != NULL) && m_initialized);
 }
 
 void
@@ -171,6 +315,39 @@ wxPdfParser::AppendObject(int originalObjectId, int actualObjectId, wxPdfObject*
   (*m_objectMap)[originalObjectId] = newEntry;
 }
 
+void
+wxPdfParser::SetObjectCacheSize(size_t maxSize)
+{
+  m_objStmCache->SetMaxSize(maxSize);
+  m_cacheObjects = (maxSize > 0);
+  if (!m_cacheObjects)
+  {
+    m_objStmCache->Clear();
+  }
+}
+
+void
+wxPdfParser::ClearObjectQueue()
+{
+  // The first queue element is an empty anchor
+  wxPdfObjectQueue* entry = m_objectQueue->GetNext();
+  wxPdfObjectQueue* next;
+  while (entry != NULL)
+  {
+    wxPdfObject* object = entry->GetObject();
+    if (object != NULL && object->IsCreatedIndirect())
+    {
+      delete object;
+    }
+    next = entry->GetNext();
+    delete entry;
+    entry = next;
+  }
+  m_objectQueue->SetNext(NULL);
+  m_objectQueueLast = m_objectQueue;
+  m_objectMap->clear();
+}
+
 unsigned int
 wxPdfParser::GetPageCount() const
 {
@@ -606,6 +783,14 @@ wxPdfParser::GetPageContent(wxPdfObject* contentRef, wxArrayPtrVoid& contents)
     }
     else
     {
+      if (content->GetType() == OBJTYPE_STREAM)
+      {
+        // Content streams are always decoded
+        bool saveUseRawStream = m_useRawStream;
+        m_useRawStream = false;
+        GetStreamBytes((wxPdfStream*) content);
+        m_useRawStream = saveUseRawStream;
+      }
       contents.Add(content);
     }
   }
@@ -1248,10 +1433,11 @@ wxPdfParser::ParseDirectObject(int k)
   if (m_xref[k].m_type == 2)
   {
     objIndex = m_xref[k].m_gen_ref;
-    wxPdfObjStmMap::iterator objStm = m_objStmCache->find(objIndex);
-    if (objStm != m_objStmCache->end())
+    // The object stream is detached from the cache while in use,
+    // so that resolving nested objects can't evict it
+    obj = m_objStmCache->Detach(objIndex);
+    if (obj != NULL)
     {
-      obj = objStm->second;
       isCached = true;
     }
     else
@@ -1301,10 +1487,13 @@ wxPdfParser::ParseDirectObject(int k)
       obj = ParseObjectStream(objStream, m_xref[k].m_ofs_idx);
       if (m_cacheObjects)
       {
-        if (!isCached)
+        wxMemoryOutputStream* objStmBuffer = objStream->GetBuffer();
+        size_t objStmSize = sizeof(wxPdfStream) + objStream->GetObjOffsets()->GetCount() * sizeof(int);
+        if (objStmBuffer != NULL)
         {
-          (*m_objStmCache)[objIndex] = objStream;
+          objStmSize += (size_t) objStmBuffer->GetLength();
         }
+        m_objStmCache->Add(objIndex, objStream, objStmSize);
       }
       else
       {
@@ -1319,13 +1508,10 @@ wxPdfParser::ParseDirectObject(int k)
     }
   }
 
+  // Stream data are loaded on demand by GetStreamBytes
   if (obj != NULL)
   {
     obj->SetObjNum(m_objNum, m_objGen);
-    if (obj->GetType() == OBJTYPE_STREAM)
-    {
-      GetStreamBytes((wxPdfStream*) obj);
-    }
   }
   return obj;
 }
@@ -1348,8 +1534,9 @@ wxPdfParser::ParseObjectStream(wxPdfStream* objStm, int idx)
   bool saveEncrypted = m_encrypted;
   m_encrypted = false;
   wxPdfTokenizer* saveTokens = m_tokens;
-  wxMemoryInputStream objStream(*(objStm->GetBuffer()));
-  m_tokens = new wxPdfTokenizer(&objStream);
+  wxMemoryOutputStream* objStmBuffer = objStm->GetBuffer();
+  m_tokens = new wxPdfTokenizer((const char*) objStmBuffer->GetOutputStreamBuffer()->GetBufferStart(),
+                                (size_t) objStmBuffer->GetLength());
 
   int address = 0;
   bool ok = true;
@@ -1431,7 +1618,7 @@ wxPdfParser::GetStreamBytes(wxPdfStream* stream)
 
   // Check whether the stream buffer is empty
   wxMemoryOutputStream* osIn = stream->GetBuffer();
-  if (osIn->GetLength() == 0) return;
+  if (osIn == NULL || osIn->GetLength() == 0) return;
 
   size_t j;
   wxArrayPtrVoid filters;
@@ -1547,30 +1734,60 @@ wxPdfParser::GetStreamBytesRaw(wxPdfStream* stream)
   size_t size = streamLength->GetInt();
   m_tokens->Seek(stream->GetOffset());
   wxMemoryOutputStream* memoryBuffer = NULL;
-  wxMemoryOutputStream* streamBuffer = m_tokens->ReadBuffer(size);
+  const char* data = m_tokens->GetData(stream->GetOffset(), size);
 
-  if (m_encrypted && size > 0)
+  if (data != NULL && m_useRawStream && !m_encrypted)
+  {
+    // The raw stream data is used directly from the mapped document
+    stream->SetDataView(data, size);
+  }
+  else if (data != NULL)
   {
-    wxMemoryInputStream inData(*streamBuffer);
-    delete streamBuffer;
     memoryBuffer = new wxMemoryOutputStream();
-    unsigned char* buffer = new unsigned char[size];
-    inData.Read(buffer, size);
-    if (inData.LastRead() == size)
+    if (m_encrypted && size > 0)
     {
+      unsigned char* buffer = new unsigned char[size];
+      memcpy(buffer, data, size);
       int realLen = m_decryptor->Decrypt(stream->GetNumber(), stream->GetGeneration(), buffer, (unsigned int) size);
       size_t offset = m_decryptor->CalculateStreamOffset();
       memoryBuffer->Write(&buffer[offset], realLen);
+      delete [] buffer;
+    }
+    else
+    {
+      memoryBuffer->Write(data, size);
     }
-    delete [] buffer;
     memoryBuffer->Close();
+    stream->SetBuffer(memoryBuffer);
   }
   else
   {
-    memoryBuffer = streamBuffer;
+    wxMemoryOutputStream* streamBuffer = m_tokens->ReadBuffer(size);
+
+    if (m_encrypted && size > 0)
+    {
+      wxMemoryInputStream inData(*streamBuffer);
+      delete streamBuffer;
+      memoryBuffer = new wxMemoryOutputStream();
+      unsigned char* buffer = new unsigned char[size];
+      inData.Read(buffer, size);
+      if (inData.LastRead() == size)
+      {
+        int realLen = m_decryptor->Decrypt(stream->GetNumber(), stream->GetGeneration(), buffer, (unsigned int) size);
+        size_t offset = m_decryptor->CalculateStreamOffset();
+        memoryBuffer->Write(&buffer[offset], realLen);
+      }
+      delete [] buffer;
+      memoryBuffer->Close();
+    }
+    else
+    {
+      memoryBuffer = streamBuffer;
+    }
+
+    stream->SetBuffer(memoryBuffer);
   }
 
-  stream->SetBuffer(memoryBuffer);
   if (streamLength->IsCreatedIndirect())
   {
     delete streamLength;
@@ -1582,6 +1799,17 @@ wxPdfParser::GetStreamBytesRaw(wxPdfStream* stream)
 wxPdfTokenizer::wxPdfTokenizer(wxInputStream* inputStream)
 {
   m_inputStream = inputStream;
+  m_data = NULL;
+  m_dataLength = 0;
+  m_position = 0;
+}
+
+wxPdfTokenizer::wxPdfTokenizer(const char* data, size_t length)
+{
+  m_inputStream = NULL;
+  m_data = data;
+  m_dataLength = length;
+  m_position = 0;
 }
 
 wxPdfTokenizer::~wxPdfTokenizer()
@@ -1591,19 +1819,39 @@ wxPdfTokenizer::~wxPdfTokenizer()
 off_t
 wxPdfTokenizer::Seek(off_t pos)
 {
+  if (m_data != NULL)
+  {
+    if (pos < 0 || (size_t) pos > m_dataLength)
+    {
+      return wxInvalidOffset;
+    }
+    m_position = (size_t) pos;
+    return pos;
+  }
   return m_inputStream->SeekI(pos);
 }
 
 off_t
 wxPdfTokenizer::Tell()
 {
+  if (m_data != NULL)
+  {
+    return (off_t) m_position;
+  }
   return m_inputStream->TellI();
 }
 
 void
 wxPdfTokenizer::BackOnePosition(int ch)
 {
-  if (ch != -1)
+  if (m_data != NULL)
+  {
+    if (ch != -1 && m_position > 0)
+    {
+      --m_position;
+    }
+  }
+  else if (ch != -1)
   {
     off_t pos = Tell();
     if (pos > 0) pos--;
@@ -1614,23 +1862,70 @@ wxPdfTokenizer::BackOnePosition(int ch)
 off_t
 wxPdfTokenizer::GetLength()
 {
+  if (m_data != NULL)
+  {
+    return (off_t) m_dataLength;
+  }
   return m_inputStream->GetLength();
 }
 
 int
 wxPdfTokenizer::ReadChar()
 {
+  if (m_data != NULL)
+  {
+    return (m_position < m_dataLength) ? (unsigned char) m_data[m_position++] : -1;
+  }
   int readChar;
   char ch = m_inputStream->GetC();
   readChar = (m_inputStream->LastRead() > 0) ? (unsigned char) ch : -1;
   return readChar;
 }
 
+size_t
+wxPdfTokenizer::ReadBytes(char* buffer, size_t size)
+{
+  if (m_data != NULL)
+  {
+    size_t available = (m_position < m_dataLength) ? m_dataLength - m_position : 0;
+    size_t count = (size < available) ? size : available;
+    memcpy(buffer, m_data + m_position, count);
+    m_position += count;
+    return count;
+  }
+  m_inputStream->Read(buffer, size);
+  return m_inputStream->LastRead();
+}
+
+const char*
+wxPdfTokenizer::GetData(off_t pos, size_t size) const
+{
+  if (m_data != NULL && pos >= 0 && (size_t) pos <= m_dataLength && size <= m_dataLength - (size_t) pos)
+  {
+    return m_data + pos;
+  }
+  return NULL;
+}
+
 wxMemoryOutputStream*
 wxPdfTokenizer::ReadBuffer(size_t size)
 {
   wxMemoryOutputStream* memoryBuffer = new wxMemoryOutputStream();
-  if (size > 0)
+  if (m_data != NULL)
+  {
+    // Copy directly from the memory block
+    const char* data = GetData(Tell(), size);
+    if (data != NULL && size > 0)
+    {
+      memoryBuffer->Write(data, size);
+      m_position += size;
+    }
+    else
+    {
+      m_position = m_dataLength;
+    }
+  }
+  else if (size > 0)
   {
     char* buffer = new char[size];
     m_inputStream->Read(buffer, size);
@@ -1661,8 +1956,8 @@ wxPdfTokenizer::GetStartXRef()
   off_t pos = GetLength() - size;
   do
   {
-    m_inputStream->SeekI(pos);
-    m_inputStream->Read(buffer, size);
+    Seek(pos);
+    ReadBytes(buffer, size);
     idx = size - 9;
     do 
     {
@@ -1690,17 +1985,17 @@ wxString
 wxPdfTokenizer::CheckPdfHeader()
 {
   wxString version = wxEmptyString;
-  m_inputStream->SeekI(0);
+  Seek(0);
   wxString str = ReadString(1024);
   int idx = str.Find(wxS("%PDF-"));
   if (idx >= 0)
   {
-    m_inputStream->SeekI(idx);
+    Seek(idx);
     version = str.Mid(idx + 5, 3);
   }
   else
   {
-    m_inputStream->SeekI(0);
+    Seek(0);
     wxLogError(wxString(wxS("wxPdfTokenizer::GetStartXref: ")) +
                wxString(_("PDF header signature not found.")));
   }
@@ -1751,6 +2046,16 @@ wxPdfTokenizer::NextToken()
       m_type = TOKEN_NAME;
       // The slash is not part of the name
       // buffer += ch;
+      if (m_data != NULL)
+      {
+        size_t start = m_position;
+        while (m_position < m_dataLength && !IsDelimiterOrWhitespace((unsigned char) m_data[m_position]))
+        {
+          ++m_position;
+        }
+        buffer = wxString(m_data + start, wxConvISO8859_1, m_position - start);
+        break;
+      }
       while (true)
       {
         ch = ReadChar();
@@ -1936,6 +2241,30 @@ wxPdfTokenizer::NextToken()
     }
     default:
     {
+      if (m_data != NULL)
+      {
+        // Scan the token in the memory block, the first character was already read
+        size_t start = m_position - 1;
+        if (ch == '-' || ch == '+' || ch == '.' || (ch >= '0' && ch <= '9'))
+        {
+          m_type = TOKEN_NUMBER;
+          while (m_position < m_dataLength &&
+                 ((m_data[m_position] >= '0' && m_data[m_position] <= '9') || m_data[m_position] == '.'))
+          {
+            ++m_position;
+          }
+        }
+        else
+        {
+          m_type = TOKEN_OTHER;
+          while (m_position < m_dataLength && !IsDelimiterOrWhitespace((unsigned char) m_data[m_position]))
+          {
+            ++m_position;
+          }
+        }
+        buffer = wxString(m_data + start, wxConvISO8859_1, m_position - start);
+        break;
+      }
       if (ch == '-' || ch == '+' || ch == '.' || (ch >= '0' && ch <= '9'))
       {
         m_type = TOKEN_NUMBER;
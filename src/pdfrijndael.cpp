@@ -9,7 +9,7 @@
 **
 ** Class renamed to wxPdfRijndael for use in wxPdfDocument (U. Telle)
 ** Added wxWidgets specific includes (U. Telle)
-** Otherwise the code is unchanged
+** Added reuse of the expanded key and support for AES instructions of the CPU
 */
 
 /// \file pdfrijndael.cpp Implementation of the Rijndael cipher
@@ -64,6 +64,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <atomic>
+
 
 static UINT8 S[256]=
 {
@@ -981,6 +983,141 @@ static UINT32 rcon[30]=
 
 
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// HARDWARE SUPPORT
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The expanded key holds the round keys in the byte order expected by the AES instructions.
+// After keyEncToDec() it holds the round keys of the equivalent inverse cipher.
+
+#if !defined(WXPDF_NO_HARDWARE_AES)
+#if (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)) && \
+    (defined(__clang__) || defined(_MSC_VER) || \
+     (defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define WXPDF_HARDWARE_AES_X86 1
+#elif (defined(__aarch64__) || defined(_M_ARM64)) && \
+      (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#define WXPDF_HARDWARE_AES_ARM 1
+#endif
+#endif
+
+#if defined(WXPDF_HARDWARE_AES_X86)
+
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define WXPDF_AES_TARGET
+#else
+#include <cpuid.h>
+#define WXPDF_AES_TARGET __attribute__((target("aes,sse2")))
+#endif
+
+static bool
+CpuHasAes()
+{
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  return ((info[2] & (1 << 25)) != 0) && ((info[3] & (1 << 26)) != 0);
+#else
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+  {
+    return false;
+  }
+  return ((ecx & (1 << 25)) != 0) && ((edx & (1 << 26)) != 0);
+#endif
+}
+
+WXPDF_AES_TARGET static void
+HardwareEncrypt(UINT8 expandedKey[_MAX_ROUNDS+1][4][4], UINT32 rounds, const UINT8 a[16], UINT8 b[16])
+{
+  __m128i state = _mm_loadu_si128((const __m128i*) a);
+  state = _mm_xor_si128(state, _mm_loadu_si128((const __m128i*) expandedKey[0]));
+  for (UINT32 r = 1; r < rounds; r++)
+  {
+    state = _mm_aesenc_si128(state, _mm_loadu_si128((const __m128i*) expandedKey[r]));
+  }
+  state = _mm_aesenclast_si128(state, _mm_loadu_si128((const __m128i*) expandedKey[rounds]));
+  _mm_storeu_si128((__m128i*) b, state);
+}
+
+WXPDF_AES_TARGET static void
+HardwareDecrypt(UINT8 expandedKey[_MAX_ROUNDS+1][4][4], UINT32 rounds, const UINT8 a[16], UINT8 b[16])
+{
+  __m128i state = _mm_loadu_si128((const __m128i*) a);
+  state = _mm_xor_si128(state, _mm_loadu_si128((const __m128i*) expandedKey[rounds]));
+  for (UINT32 r = rounds - 1; r > 0; r--)
+  {
+    state = _mm_aesdec_si128(state, _mm_loadu_si128((const __m128i*) expandedKey[r]));
+  }
+  state = _mm_aesdeclast_si128(state, _mm_loadu_si128((const __m128i*) expandedKey[0]));
+  _mm_storeu_si128((__m128i*) b, state);
+}
+
+#elif defined(WXPDF_HARDWARE_AES_ARM)
+
+#include <arm_neon.h>
+
+static bool
+CpuHasAes()
+{
+  // The code was compiled for a CPU with the Cryptography Extensions
+  return true;
+}
+
+static void
+HardwareEncrypt(UINT8 expandedKey[_MAX_ROUNDS+1][4][4], UINT32 rounds, const UINT8 a[16], UINT8 b[16])
+{
+  uint8x16_t state = vld1q_u8(a);
+  for (UINT32 r = 0; r < rounds - 1; r++)
+  {
+    state = vaesmcq_u8(vaeseq_u8(state, vld1q_u8(expandedKey[r][0])));
+  }
+  state = vaeseq_u8(state, vld1q_u8(expandedKey[rounds-1][0]));
+  state = veorq_u8(state, vld1q_u8(expandedKey[rounds][0]));
+  vst1q_u8(b, state);
+}
+
+static void
+HardwareDecrypt(UINT8 expandedKey[_MAX_ROUNDS+1][4][4], UINT32 rounds, const UINT8 a[16], UINT8 b[16])
+{
+  uint8x16_t state = vld1q_u8(a);
+  state = vaesimcq_u8(vaesdq_u8(state, vld1q_u8(expandedKey[rounds][0])));
+  for (UINT32 r = rounds - 1; r > 1; r--)
+  {
+    state = vaesimcq_u8(vaesdq_u8(state, vld1q_u8(expandedKey[r][0])));
+  }
+  state = vaesdq_u8(state, vld1q_u8(expandedKey[1][0]));
+  state = veorq_u8(state, vld1q_u8(expandedKey[0][0]));
+  vst1q_u8(b, state);
+}
+
+#endif
+
+bool wxPdfRijndael::hasHardwareSupport()
+{
+#if defined(WXPDF_HARDWARE_AES_X86) || defined(WXPDF_HARDWARE_AES_ARM)
+  static const bool hasAes = CpuHasAes();
+  return hasAes;
+#else
+  return false;
+#endif
+}
+
+static std::atomic<bool> gs_hardwareEnabled(true);
+
+void wxPdfRijndael::setHardwareEnabled(bool enable)
+{
+  gs_hardwareEnabled = enable;
+}
+
+bool wxPdfRijndael::isHardwareEnabled()
+{
+  return gs_hardwareEnabled;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // API
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -991,11 +1128,19 @@ wxPdfRijndael::wxPdfRijndael()
   m_mode = ECB;
   m_direction = Encrypt;
   m_uRounds = 0;
+  m_keyLenInBytes = 0;
+  m_keyDirection = Encrypt;
+  m_hardware = isHardwareEnabled() && hasHardwareSupport();
 }
 
 wxPdfRijndael::~wxPdfRijndael()
 {
-  // nothing here
+  // Wipe the key and the round keys; the volatile access keeps the compiler from removing the stores
+  volatile UINT8* key = m_key;
+  for(UINT32 i = 0;i < sizeof(m_key);i++)key[i] = 0;
+  volatile UINT8* expandedKey = &m_expandedKey[0][0][0];
+  for(UINT32 i = 0;i < sizeof(m_expandedKey);i++)expandedKey[i] = 0;
+  m_keyLenInBytes = 0;
 }
 
 int wxPdfRijndael::init(Mode mode,Direction dir,const UINT8 * key,KeyLength keyLen,UINT8 * initVector)
@@ -1053,6 +1198,13 @@ int wxPdfRijndael::init(Mode mode,Direction dir,const UINT8 * key,KeyLength keyL
 
   if(!key)return RIJNDAEL_BAD_KEY;
 
+  // The expanded key is still valid if key and direction are unchanged
+  if((m_keyLenInBytes == uKeyLenInBytes) && (m_keyDirection == dir) && (memcmp(m_key, key, uKeyLenInBytes) == 0))
+  {
+    m_state = Valid;
+    return RIJNDAEL_SUCCESS;
+  }
+
   UINT8 keyMatrix[_MAX_KEY_COLUMNS][4];
 
   for(UINT32 i = 0;i < uKeyLenInBytes;i++)keyMatrix[i >> 2][i & 3] = key[i];
@@ -1061,6 +1213,10 @@ int wxPdfRijndael::init(Mode mode,Direction dir,const UINT8 * key,KeyLength keyL
 
   if(m_direction == Decrypt)keyEncToDec();
 
+  memcpy(m_key, key, uKeyLenInBytes);
+  m_keyLenInBytes = uKeyLenInBytes;
+  m_keyDirection = dir;
+
   m_state = Valid;
 
   return RIJNDAEL_SUCCESS;
@@ -1481,6 +1637,14 @@ void wxPdfRijndael::keyEncToDec()
 
 void wxPdfRijndael::encrypt(const UINT8 a[16], UINT8 b[16])
 {
+#if defined(WXPDF_HARDWARE_AES_X86) || defined(WXPDF_HARDWARE_AES_ARM)
+  if(m_hardware)
+  {
+    HardwareEncrypt(m_expandedKey, m_uRounds, a, b);
+    return;
+  }
+#endif
+
   UINT32 r = 0;
   UINT8 temp[4][4];
 
@@ -1556,6 +1720,14 @@ void wxPdfRijndael::encrypt(const UINT8 a[16], UINT8 b[16])
 
 void wxPdfRijndael::decrypt(const UINT8 a[16], UINT8 b[16])
 {
+#if defined(WXPDF_HARDWARE_AES_X86) || defined(WXPDF_HARDWARE_AES_ARM)
+  if(m_hardware)
+  {
+    HardwareDecrypt(m_expandedKey, m_uRounds, a, b);
+    return;
+  }
+#endif
+
   int r = 0;
   UINT8 temp[4][4];
 
@@ -321,6 +321,7 @@ wxPdfDocument::SetSourceFile(const wxString& filename, const wxString& password)
       m_currentParser = new wxPdfParser(filename, password);
       if (m_currentParser->IsOk())
       {
+        m_currentParser->SetObjectCacheSize(m_importCacheSize);
         (*m_parsers)[filename] = m_currentParser;
         pageCount = m_currentParser->GetPageCount();
       }
@@ -342,6 +343,20 @@ wxPdfDocument::SetSourceFile(const wxString& filename, const wxString& password)
   return pageCount;
 }
 
+void
+wxPdfDocument::SetImportCacheSize(size_t maxSize)
+{
+  m_importCacheSize = maxSize;
+  wxPdfParserMap::iterator parser = m_parsers->begin();
+  for (parser = m_parsers->begin(); parser != m_parsers->end(); parser++)
+  {
+    if (parser->second != NULL)
+    {
+      parser->second->SetObjectCacheSize(maxSize);
+    }
+  }
+}
+
 bool
 wxPdfDocument::GetSourceInfo(wxPdfInfo& info)
 {
@@ -460,7 +475,7 @@ wxPdfDocument::ImportPage(unsigned int pageno, wxPdfPageBox pageBox)
       {
         wxPdfStream* pageContent = (wxPdfStream*) contents[j];
         wxMemoryOutputStream* os = pageContent->GetBuffer();
-        if (os->TellO() > 0)
+        if (os != NULL && os->TellO() > 0)
         {
           wxMemoryInputStream is(*os);
           pageTemplate->m_buffer.Write(is);
@@ -583,14 +598,32 @@ wxPdfDocument::WriteObjectValue(wxPdfObject* obj, bool newline)
         // A stream. First, output the stream dictionary,
         // then the stream data itself.
         wxPdfStream* stream = (wxPdfStream*) obj;
-        wxMemoryOutputStream* buffer = stream->GetBuffer();
+        if (!stream->HasDataView() && stream->GetBuffer() == NULL && m_currentParser != NULL)
+        {
+          // Stream data of imported objects are loaded on demand
+          m_currentParser->GetStreamBytes(stream);
+        }
+        const char* data = NULL;
+        size_t dataLength = 0;
+        if (stream->HasDataView())
+        {
+          // Raw stream data are written directly from the source document
+          data = stream->GetDataView();
+          dataLength = stream->GetDataViewLength();
+        }
+        else if (stream->GetBuffer() != NULL)
+        {
+          wxMemoryOutputStream* buffer = stream->GetBuffer();
+          data = (const char*) buffer->GetOutputStreamBuffer()->GetBufferStart();
+          dataLength = (size_t) buffer->TellO();
+        }
 
         // Save the 'Length' entry of the stream dictionary
         wxPdfDictionary* dictionary = (wxPdfDictionary*) stream->GetDictionary();
         wxPdfObject* originalLength = dictionary->Get(wxS("Length"));
 
         // Calculate the actual stream length and update the stream dictionary
-        int streamLength = (int) CalculateStreamLength(buffer->TellO());
+        int streamLength = (int) CalculateStreamLength(dataLength);
         wxPdfNumber actualLength(streamLength);
         wxPdfName lengthKey(wxS("Length"));
         dictionary->Put(&lengthKey, &actualLength);
@@ -605,7 +638,7 @@ wxPdfDocument::WriteObjectValue(wxPdfObject* obj, bool newline)
         {
           m_n = actualId;
         }
-        PutStream(*buffer);
+        PutStream(data, dataLength);
         if (actualId != -1)
         {
           m_n = nSave;
@@ -21,7 +21,21 @@
 #endif
 
 // includes
+#include "wx/filename.h"
+#include "wx/hashmap.h"
 #include "wx/intl.h"
+#include "wx/thread.h"
+
+#include <cmath>
+
+#if defined(__WXMSW__)
+#include "wx/msw/wrapwin.h"
+#elif defined(__UNIX__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "wx/pdfutility.h"
 
@@ -71,6 +85,68 @@ wxPdfUtility::Double2String(double value, int precision)
   return number;
 }
 
+size_t
+wxPdfUtility::Double2Ascii(double value, int precision, char* buffer)
+{
+  static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+  if (precision < 0 || precision > 9)
+  {
+    return 0;
+  }
+  double scale = powers[precision];
+  double absValue = std::fabs(value);
+  double scaled = absValue * scale;
+  // Rejects NaN and infinity, too
+  if (!(scaled < 4503599627370496.0))
+  {
+    return 0;
+  }
+
+  // Round half to even based on the exact product, as printf does
+  double integral = std::floor(scaled);
+  double fraction = scaled - integral;
+  bool roundUp;
+  if (fraction != 0.5)
+  {
+    roundUp = fraction > 0.5;
+  }
+  else
+  {
+    double error = std::fma(absValue, scale, -scaled);
+    roundUp = (error > 0) || (error == 0 && std::fmod(integral, 2.0) != 0);
+  }
+  wxUint64 number = (wxUint64) integral + (roundUp ? 1 : 0);
+
+  // Build the digits from right to left
+  char digits[wxPDF_DOUBLE_BUFFER_SIZE];
+  char* p = digits + wxPDF_DOUBLE_BUFFER_SIZE;
+  int j;
+  for (j = 0; j < precision; ++j)
+  {
+    *--p = (char) ('0' + (number % 10));
+    number /= 10;
+  }
+  if (precision > 0)
+  {
+    *--p = '.';
+  }
+  do
+  {
+    *--p = (char) ('0' + (number % 10));
+    number /= 10;
+  }
+  while (number > 0);
+  if (std::signbit(value))
+  {
+    *--p = '-';
+  }
+
+  size_t len = (size_t) (digits + wxPDF_DOUBLE_BUFFER_SIZE - p);
+  memcpy(buffer, p, len);
+  buffer[len] = 0;
+  return len;
+}
+
 double
 wxPdfUtility::String2Double(const wxString& str)
 {
@@ -469,3 +545,147 @@ wxPdfUtility::MapFontStyle2String(int fontStyle)
   }
   return styleString;
 }
+
+// --- Memory mapped file
+
+wxPdfMappedFile::wxPdfMappedFile()
+  : m_data(NULL), m_length(0), m_refCount(0)
+{
+#ifdef __WXMSW__
+  m_mapping = NULL;
+#endif
+}
+
+wxPdfMappedFile::~wxPdfMappedFile()
+{
+  Close();
+}
+
+bool
+wxPdfMappedFile::Open(const wxString& fileName)
+{
+  Close();
+#if defined(__WXMSW__)
+  HANDLE file = ::CreateFileW(fileName.wc_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    return false;
+  }
+  LARGE_INTEGER fileSize;
+  if (::GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0 &&
+      (wxUint64) fileSize.QuadPart <= (wxUint64) ((size_t) -1))
+  {
+    HANDLE mapping = ::CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping != NULL)
+    {
+      void* data = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      if (data != NULL)
+      {
+        m_data = (const char*) data;
+        m_length = (size_t) fileSize.QuadPart;
+        m_mapping = mapping;
+      }
+      else
+      {
+        ::CloseHandle(mapping);
+      }
+    }
+  }
+  // The mapping keeps a reference to the file
+  ::CloseHandle(file);
+#elif defined(__UNIX__)
+  int fd = open(fileName.fn_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) == 0 && S_ISREG(fileStat.st_mode) && fileStat.st_size > 0)
+  {
+    void* data = mmap(NULL, (size_t) fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED)
+    {
+      m_data = (const char*) data;
+      m_length = (size_t) fileStat.st_size;
+    }
+  }
+  // The mapping keeps a reference to the file
+  close(fd);
+#else
+  wxUnusedVar(fileName);
+#endif
+  return m_data != NULL;
+}
+
+void
+wxPdfMappedFile::Close()
+{
+  if (m_data != NULL)
+  {
+#if defined(__WXMSW__)
+    ::UnmapViewOfFile(m_data);
+    ::CloseHandle((HANDLE) m_mapping);
+    m_mapping = NULL;
+#elif defined(__UNIX__)
+    munmap((void*) m_data, m_length);
+#endif
+    m_data = NULL;
+    m_length = 0;
+  }
+}
+
+WX_DECLARE_STRING_HASH_MAP(wxPdfMappedFile*, wxPdfMappedFileMap);
+
+#if wxUSE_THREADS
+static wxCriticalSection gs_csMappedFiles;
+#endif
+
+static wxPdfMappedFileMap gs_mappedFiles;
+
+wxPdfMappedFile*
+wxPdfMappedFile::Acquire(const wxString& fileName)
+{
+  wxFileName absFileName(fileName);
+  absFileName.MakeAbsolute();
+  wxString key = absFileName.GetFullPath();
+
+#if wxUSE_THREADS
+  wxCriticalSectionLocker locker(gs_csMappedFiles);
+#endif
+  wxPdfMappedFile* mappedFile = NULL;
+  wxPdfMappedFileMap::iterator fileIter = gs_mappedFiles.find(key);
+  if (fileIter != gs_mappedFiles.end())
+  {
+    mappedFile = fileIter->second;
+  }
+  else
+  {
+    mappedFile = new wxPdfMappedFile();
+    if (!mappedFile->Open(key))
+    {
+      delete mappedFile;
+      return NULL;
+    }
+    mappedFile->m_sharedName = key;
+    gs_mappedFiles[key] = mappedFile;
+  }
+  mappedFile->m_refCount++;
+  return mappedFile;
+}
+
+void
+wxPdfMappedFile::Release(wxPdfMappedFile* mappedFile)
+{
+  if (mappedFile != NULL)
+  {
+#if wxUSE_THREADS
+    wxCriticalSectionLocker locker(gs_csMappedFiles);
+#endif
+    if (--mappedFile->m_refCount <= 0)
+    {
+      gs_mappedFiles.erase(mappedFile->m_sharedName);
+      delete mappedFile;
+    }
+  }
+}
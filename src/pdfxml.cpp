@@ -1502,6 +1502,7 @@ wxPdfDocument::PrepareXmlCell(wxXmlNode* node, wxPdfCellContext& context)
         {
           --nb;
         }
+        wxPdfLineBreaker lineBreaker(m_currentFont, s, m_kerning, context.GetCharacterSpacing(), m_fontSize);
         int sep = -1;
         int i = 0;
         int j = 0;
@@ -1535,7 +1536,7 @@ wxPdfDocument::PrepareXmlCell(wxXmlNode* node, wxPdfCellContext& context)
             ns++;
           }
           double lastlen = len;
-          len = GetStringWidth(s.SubString(j, i), context.GetCharacterSpacing());
+          len = lineBreaker.GetWidth(j, i);
 
           if (len > wmax)
           {
@@ -2261,6 +2262,7 @@ wxPdfDocument::WriteXmlCell(wxXmlNode* node, wxPdfCellContext& context)
           --nb;
         }
 
+        wxPdfLineBreaker lineBreaker(m_currentFont, s, m_kerning, context.GetCharacterSpacing(), m_fontSize);
         int sep = -1;
         int i = 0;
         int j = 0;
@@ -2296,7 +2298,7 @@ wxPdfDocument::WriteXmlCell(wxXmlNode* node, wxPdfCellContext& context)
             sep = i;
             ns++;
           }
-          len = GetStringWidth(s.SubString(j, i), context.GetCharacterSpacing());
+          len = lineBreaker.GetWidth(j, i);
 
           if (len > wmax)
           {